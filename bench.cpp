@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <tiny_text_renderer.h>
+
+#include "glyph.h"
+#include "run.h"
+#include "scale.h"
+
+struct BenchText {
+    const char* script;
+    const char* length;
+    const char* text;
+};
+
+static const BenchText bench_texts[] = {
+    { "latin", "short", "Hello" },
+    { "latin", "medium", "The quick brown fox jumps over the lazy dog" },
+    { "latin", "long", "The quick brown fox jumps over the lazy dog. Pack my box with five dozen liquor jugs. How vexingly quick daft zebras jump! Sphinx of black quartz, judge my vow." },
+    { "devanagari", "short", "नमस्ते" },
+    { "devanagari", "medium", "हिन्दी विकिपीडिया एक मुक्त ज्ञानकोश है" },
+    { "devanagari", "long", "हिन्दी विकिपीडिया एक मुक्त ज्ञानकोश है जिसे कोई भी संपादित कर सकता है। यह विकिमीडिया फ़ाउंडेशन की एक परियोजना है और इसमें लाखों लेख उपलब्ध हैं।" },
+    { "arabic", "short", "مرحبا" },
+    { "arabic", "medium", "هذه جملة قصيرة باللغة العربية للاختبار" },
+    { "arabic", "long", "هذه جملة قصيرة باللغة العربية للاختبار. تحتوي ويكيبيديا العربية على أكثر من مليون مقالة يكتبها متطوعون من جميع أنحاء العالم." },
+};
+
+static const unsigned int bench_sizes[] = { 8, 12, 16, 24, 32, 48, 64, 128, 256 };
+
+// Size and number of strings drawn at once with `ttr_draw_text_batch`.
+static const unsigned int batch_size = 16;
+static const unsigned int batch_job_count = 512;
+
+static double min_time_ns = 20e6;
+
+// Runs `func` until at least `min_time_ns` have passed, and returns the mean time per run in nanoseconds.
+template <typename Func>
+double time_ns(Func func) {
+    typedef std::chrono::steady_clock clock;
+
+    // Warm up caches and lazily loaded font tables.
+    func();
+
+    unsigned long iterations = 0;
+    double elapsed = 0;
+    clock::time_point start = clock::now();
+    do {
+        func();
+        iterations++;
+        elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    } while (elapsed < min_time_ns);
+
+    return elapsed / iterations;
+}
+
+static void ignore_span(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data) {
+    // Keep the compiler from dropping the loop.
+    *(volatile unsigned int*)user_data += len;
+}
+
+static void bench_case(hb_font_t* font, const BenchText& bench_text, unsigned int size, bool* first) {
+    ttr_context_t* ctx = ttr_create_context();
+    hb_buffer_t* buffer = hb_buffer_create();
+    ttr_run_t* run = ttr_shape_text(font, bench_text.text);
+
+    unsigned int width, height, baseline;
+    ttr_run_measure(run, &width, &height, &baseline);
+    width += 2;
+    height += 2;
+    std::vector<uint8_t> pixels(width * height);
+
+    double shape_ns = time_ns([&] {
+        hb_buffer_clear_contents(buffer);
+        hb_buffer_add_utf8(buffer, bench_text.text, -1, 0, -1);
+        hb_buffer_guess_segment_properties(buffer);
+        hb_shape(font, buffer, NULL, 0);
+    });
+
+    double measure_ns = time_ns([&] {
+        unsigned int w, h, b;
+        ttr_measure_text(ctx, font, bench_text.text, &w, &h, &b);
+    });
+
+    // Glyphs on their own, at the same subpixel offsets they are drawn at.
+    volatile unsigned int pixel_count = 0;
+    double rasterize_ns = time_ns([&] {
+        int cursor_x = 0, cursor_y = 0;
+        for (unsigned int i = 0; i < run->glyph_count; i++) {
+            hb_glyph_extents_t extents = run->glyph_extents[i];
+            int glyph_start_x = cursor_x + run->glyph_pos[i].x_offset + extents.x_bearing;
+            int glyph_start_y = cursor_y - run->glyph_pos[i].y_offset - extents.y_bearing;
+
+            ttr_draw_glyph(ctx, font, run->glyph_info[i].codepoint, extents, ttr_fraction_scaled(glyph_start_x), ttr_fraction_scaled(glyph_start_y), ignore_span, (void*)&pixel_count);
+
+            cursor_x += run->glyph_pos[i].x_advance;
+            cursor_y += run->glyph_pos[i].y_advance;
+        }
+    });
+
+    // Drawing the shaped run, first discarding the spans and then adding them to a buffer.
+    // Both rasterize the same, so the difference is the time spent compositing.
+    double draw_spans_ns = time_ns([&] {
+        ttr_run_draw_with_span_callback(ctx, run, 1, 1, width, height, NULL, ignore_span, (void*)&pixel_count);
+    });
+    double draw_ns = time_ns([&] {
+        ttr_run_draw_on_buffer(ctx, run, 1, 1, width, height, NULL, pixels.data());
+    });
+
+    printf("%s\n    {\"script\": \"%s\", \"length\": \"%s\", \"size\": %u, \"bytes\": %zu, \"glyphs\": %u, \"width\": %u, \"height\": %u, "
+        "\"shape_ns\": %.0f, \"measure_ns\": %.0f, \"rasterize_ns\": %.0f, \"draw_ns\": %.0f, \"composite_ns\": %.0f}",
+        *first ? "" : ",",
+        bench_text.script, bench_text.length, size, strlen(bench_text.text), run->glyph_count, width, height,
+        shape_ns, measure_ns, rasterize_ns, draw_ns, draw_ns > draw_spans_ns ? draw_ns - draw_spans_ns : 0.0);
+    fflush(stdout);
+    *first = false;
+
+    ttr_destroy_run(run);
+    hb_buffer_destroy(buffer);
+    ttr_destroy_context(ctx);
+}
+
+// Draw many strings with `ttr_draw_text_batch` on 1, 2, 4... threads up to one per CPU, to see how throughput
+// scales with cores.
+static void bench_batch(hb_font_t* font, const char* script, bool* first) {
+    std::vector<const char*> texts;
+    for (unsigned int t = 0; t < sizeof(bench_texts) / sizeof(bench_texts[0]); t++) {
+        if (strcmp(bench_texts[t].script, script) == 0) {
+            texts.push_back(bench_texts[t].text);
+        }
+    }
+
+    std::vector<std::vector<uint8_t> > buffers(batch_job_count);
+    std::vector<ttr_text_job_t> jobs(batch_job_count);
+    for (unsigned int i = 0; i < batch_job_count; i++) {
+        const char* text = texts[i % texts.size()];
+
+        unsigned int width, height, baseline;
+        ttr_measure_text(NULL, font, text, &width, &height, &baseline);
+        width += 2;
+        height += 2;
+        buffers[i].resize(width * height);
+
+        ttr_text_job_t job = { font, text, 1, 1, width, height, buffers[i].data(), NULL };
+        jobs[i] = job;
+    }
+
+    unsigned int max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    double single_ns = 0;
+    for (unsigned int threads = 1;; threads = std::min(threads * 2, max_threads)) {
+        double batch_ns = time_ns([&] {
+            ttr_draw_text_batch(jobs.data(), batch_job_count, threads);
+        });
+        if (threads == 1) {
+            single_ns = batch_ns;
+        }
+
+        printf("%s\n    {\"script\": \"%s\", \"size\": %u, \"jobs\": %u, \"threads\": %u, "
+            "\"batch_ns\": %.0f, \"jobs_per_s\": %.0f, \"speedup\": %.2f}",
+            *first ? "" : ",",
+            script, batch_size, batch_job_count, threads,
+            batch_ns, batch_job_count * 1e9 / batch_ns, single_ns / batch_ns);
+        fflush(stdout);
+        *first = false;
+
+        if (threads >= max_threads) {
+            break;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s [--min-time-ms=<ms>] <script>=<font.ttf> ...\n", argv[0]);
+        fprintf(stderr, "Scripts: latin, devanagari, arabic. Results are written to stdout as JSON.\n");
+        return 1;
+    }
+
+    std::vector<const char*> scripts;
+    std::vector<const char*> font_files;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--min-time-ms=", 14) == 0) {
+            min_time_ns = atof(argv[i] + 14) * 1e6;
+            continue;
+        }
+
+        char* separator = strchr(argv[i], '=');
+        if (!separator) {
+            fprintf(stderr, "Expected <script>=<font.ttf>, got: %s\n", argv[i]);
+            return 1;
+        }
+        *separator = '\0';
+
+        bool known = false;
+        for (unsigned int t = 0; t < sizeof(bench_texts) / sizeof(bench_texts[0]); t++) {
+            known = known || strcmp(bench_texts[t].script, argv[i]) == 0;
+        }
+        if (!known) {
+            fprintf(stderr, "Unknown script: %s\n", argv[i]);
+            return 1;
+        }
+
+        scripts.push_back(argv[i]);
+        font_files.push_back(separator + 1);
+    }
+
+#ifdef TTR_FIXED_POINT
+    const char* rasterizer = "fixed";
+#else
+    const char* rasterizer = "float";
+#endif
+    printf("{\n  \"rasterizer\": \"%s\",\n  \"results\": [", rasterizer);
+
+    bool first = true;
+    for (size_t f = 0; f < scripts.size(); f++) {
+        hb_face_t* face = ttr_open_face_file(font_files[f], 0);
+        if (!face) {
+            fprintf(stderr, "Failed to read font file: %s\n", font_files[f]);
+            return 1;
+        }
+
+        for (unsigned int s = 0; s < sizeof(bench_sizes) / sizeof(bench_sizes[0]); s++) {
+            hb_font_t* font = ttr_create_font_for_face(face, bench_sizes[s]);
+
+            for (unsigned int t = 0; t < sizeof(bench_texts) / sizeof(bench_texts[0]); t++) {
+                if (strcmp(bench_texts[t].script, scripts[f]) == 0) {
+                    bench_case(font, bench_texts[t], bench_sizes[s], &first);
+                }
+            }
+
+            ttr_destroy_font(font);
+        }
+
+        ttr_destroy_face(face);
+    }
+
+    printf("\n  ],\n  \"batch\": [");
+
+    first = true;
+    for (size_t f = 0; f < scripts.size(); f++) {
+        hb_face_t* face = ttr_open_face_file(font_files[f], 0);
+        if (!face) {
+            fprintf(stderr, "Failed to read font file: %s\n", font_files[f]);
+            return 1;
+        }
+
+        hb_font_t* font = ttr_create_font_for_face(face, batch_size);
+        bench_batch(font, scripts[f], &first);
+        ttr_destroy_font(font);
+
+        ttr_destroy_face(face);
+    }
+
+    printf("\n  ]\n}\n");
+
+    return 0;
+}
@@ -5,30 +5,6 @@
 
 #include <tiny_text_renderer.h>
 
-long read_font_file(const char* file_name, char** buffer) {
-    FILE* file = fopen(file_name, "rb");
-    if (!file) {
-        fprintf(stderr, "Could not open file\n");
-        return -1;
-    }
-
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    *buffer = (char*)malloc(file_size);
-    if (!*buffer) {
-        fprintf(stderr, "Could not allocate buffer\n");
-        fclose(file);
-        return -1;
-    }
-
-    fread(*buffer, 1, file_size, file);
-    fclose(file);
-
-    return file_size;
-}
-
 void write_bitmap(const char* file_name, uint8_t* pixels, unsigned int width, unsigned int height) {
     #pragma pack(push,1)
     struct BmpHeader {
@@ -91,18 +67,18 @@ int main(int argc, char **argv) {
     unsigned int size = atoi(argv[2]);
     const char* text = argv[3];
 
-    char* font_data;
-    long file_data_size = read_font_file(file_name, &font_data);
-
-    if (file_data_size <= 0) {
+    hb_face_t* face = ttr_open_face_file(file_name, 0);
+    if (!face) {
         fprintf(stderr, "Failed to read font file: %s\n", file_name);
         return 1;
     }
 
-    hb_font_t* font = ttr_create_font(font_data, file_data_size, size);
+    hb_font_t* font = ttr_create_font_for_face(face, size);
+
+    ttr_run_t* run = ttr_shape_text(font, text);
 
     unsigned int width, height, baseline;
-    ttr_measure_text(font, text, &width, &height, &baseline);
+    ttr_run_measure(run, &width, &height, &baseline);
 
     unsigned int padding = 2;
     width += padding;
@@ -110,11 +86,15 @@ int main(int argc, char **argv) {
 
     uint8_t* pixels = (uint8_t*)malloc(width * height);
     memset(pixels, 0, width * height);
-    ttr_draw_text_on_buffer(font, text, padding / 2, padding / 2, width, height, pixels);
+    ttr_context_t* ctx = ttr_create_context();
+    ttr_run_draw_on_buffer(ctx, run, padding / 2, padding / 2, width, height, NULL, pixels);
 
     write_bitmap("/tmp/output.bmp", pixels, width, height);
 
+    ttr_destroy_context(ctx);
+    ttr_destroy_run(run);
     ttr_destroy_font(font);
+    ttr_destroy_face(face);
 
     printf("Width: %d, Height: %d, Baseline: %d\n", width, height, baseline);
 
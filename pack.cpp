@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <tiny_text_renderer.h>
+
+#include "glyph.h"
+#include "pack.h"
+#include "run.h"
+#include "scale.h"
+
+// Bytes of a pack being written, with offsets patched as sections are laid out.
+struct PackWriter {
+    std::vector<uint8_t> bytes;
+
+    uint32_t align() {
+        while (bytes.size() % 4 != 0) {
+            bytes.push_back(0);
+        }
+        return bytes.size();
+    }
+
+    template <typename T>
+    uint32_t append(const T* items, size_t count) {
+        uint32_t offset = align();
+        const uint8_t* data = (const uint8_t*)items;
+        bytes.insert(bytes.end(), data, data + count * sizeof(T));
+        return offset;
+    }
+
+    template <typename T>
+    void patch(uint32_t offset, const T& item) {
+        memcpy(&bytes[offset], &item, sizeof(T));
+    }
+};
+
+struct GlyphBitmap {
+    ttr_pack_glyph_t glyph;
+    std::vector<uint8_t> coverage;
+};
+
+struct DrawBitmapData {
+    uint8_t* pixels;
+    unsigned int width;
+};
+
+static void draw_span_on_bitmap(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data) {
+    DrawBitmapData* data = (DrawBitmapData*)user_data;
+    memcpy(&data->pixels[y * data->width + x_start], coverage, len);
+}
+
+// Rasterize a glyph with its pen on a whole pixel, as it is drawn from the pack.
+static GlyphBitmap rasterize_glyph(ttr_context_t* ctx, hb_font_t* font, hb_codepoint_t glyph_id) {
+    hb_glyph_extents_t extents;
+    if (!hb_font_get_glyph_extents(font, glyph_id, &extents)) {
+        extents = hb_glyph_extents_t();
+    }
+
+    unsigned int fraction_x = ttr_fraction_scaled(extents.x_bearing);
+    unsigned int fraction_y = ttr_fraction_scaled(-extents.y_bearing);
+
+    unsigned int width = 0, height = 0;
+    if (extents.width != 0 && extents.height != 0) {
+        ttr_glyph_bitmap_size(extents, fraction_x, fraction_y, &width, &height);
+    }
+
+    GlyphBitmap bitmap;
+    bitmap.glyph.glyph_id = glyph_id;
+    bitmap.glyph.x_advance = hb_font_get_glyph_h_advance(font, glyph_id);
+    bitmap.glyph.left = ttr_scale_down_floor(extents.x_bearing);
+    bitmap.glyph.top = ttr_scale_down_floor(-extents.y_bearing);
+    bitmap.glyph.width = width;
+    bitmap.glyph.height = height;
+    bitmap.glyph.bitmap_offset = 0;
+    bitmap.coverage.resize(width * height);
+
+    if (width > 0 && height > 0) {
+        DrawBitmapData data = { bitmap.coverage.data(), width };
+        ttr_draw_glyph(ctx, font, glyph_id, extents, fraction_x, fraction_y, draw_span_on_bitmap, &data);
+    }
+
+    return bitmap;
+}
+
+// Parse ranges such as `0x20-0x7e,0xa0`.
+static bool parse_codepoints(const char* ranges, std::vector<hb_codepoint_t>* codepoints) {
+    const char* next = ranges;
+    while (*next) {
+        char* end;
+        unsigned long first = strtoul(next, &end, 0);
+        if (end == next) {
+            return false;
+        }
+        unsigned long last = first;
+        if (*end == '-') {
+            next = end + 1;
+            last = strtoul(next, &end, 0);
+            if (end == next || last < first) {
+                return false;
+            }
+        }
+        for (unsigned long codepoint = first; codepoint <= last; codepoint++) {
+            codepoints->push_back(codepoint);
+        }
+        next = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool read_strings(const char* file_name, std::vector<std::string>* strings) {
+    FILE* file = fopen(file_name, "rb");
+    if (!file) {
+        return false;
+    }
+
+    std::string line;
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        if (c == '\n') {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty()) {
+                strings->push_back(line);
+            }
+            line.clear();
+        } else {
+            line.push_back(c);
+        }
+    }
+    if (!line.empty()) {
+        strings->push_back(line);
+    }
+
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <font.ttf> <output.pack> --sizes=<size>,... [--strings=<file>] [--codepoints=<first>-<last>,...]\n", argv[0]);
+        fprintf(stderr, "Strings are read one per line and shaped at each size; codepoints are mapped to glyphs one by one.\n");
+        return 1;
+    }
+
+    const uint32_t byte_order = 1;
+    if (*(const uint8_t*)&byte_order != 1) {
+        fprintf(stderr, "Packs can only be written on little endian hosts\n");
+        return 1;
+    }
+
+    const char* font_file = argv[1];
+    const char* output_file = argv[2];
+
+    std::vector<unsigned int> sizes;
+    std::vector<std::string> strings;
+    std::vector<hb_codepoint_t> codepoints;
+    for (int i = 3; i < argc; i++) {
+        if (strncmp(argv[i], "--sizes=", 8) == 0) {
+            for (const char* next = argv[i] + 8; *next;) {
+                char* end;
+                unsigned long size = strtoul(next, &end, 10);
+                if (end == next || size == 0) {
+                    fprintf(stderr, "Invalid sizes: %s\n", argv[i] + 8);
+                    return 1;
+                }
+                sizes.push_back(size);
+                next = *end == ',' ? end + 1 : end;
+            }
+        } else if (strncmp(argv[i], "--strings=", 10) == 0) {
+            if (!read_strings(argv[i] + 10, &strings)) {
+                fprintf(stderr, "Failed to read strings file: %s\n", argv[i] + 10);
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--codepoints=", 13) == 0) {
+            if (!parse_codepoints(argv[i] + 13, &codepoints)) {
+                fprintf(stderr, "Invalid codepoints: %s\n", argv[i] + 13);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (sizes.empty()) {
+        fprintf(stderr, "No sizes given\n");
+        return 1;
+    }
+
+    // Strings are looked up with a binary search.
+    std::sort(strings.begin(), strings.end(), [](const std::string& a, const std::string& b) {
+        return strcmp(a.c_str(), b.c_str()) < 0;
+    });
+    strings.erase(std::unique(strings.begin(), strings.end()), strings.end());
+
+    hb_face_t* face = ttr_open_face_file(font_file, 0);
+    if (!face) {
+        fprintf(stderr, "Failed to read font file: %s\n", font_file);
+        return 1;
+    }
+
+    ttr_context_t* ctx = ttr_create_context();
+
+    PackWriter writer;
+    ttr_pack_header_t header;
+    memcpy(header.magic, TTR_PACK_MAGIC, 4);
+    header.version = TTR_PACK_VERSION;
+    header.strike_count = sizes.size();
+    writer.append(&header, 1);
+
+    std::vector<ttr_pack_strike_t> strikes(sizes.size());
+    header.strikes_offset = writer.append(strikes.data(), strikes.size());
+    writer.patch(0, header);
+
+    size_t coverage_bytes = 0;
+    for (size_t s = 0; s < sizes.size(); s++) {
+        hb_font_t* font = ttr_create_font_for_face(face, sizes[s]);
+
+        // Glyph ids in order, mapped to their index in the strike once all are known.
+        std::map<hb_codepoint_t, uint32_t> glyph_ids;
+        std::map<hb_codepoint_t, hb_codepoint_t> cmap;
+        std::vector<ttr_run_t*> runs;
+
+        for (hb_codepoint_t codepoint : codepoints) {
+            hb_codepoint_t glyph_id;
+            if (hb_font_get_nominal_glyph(font, codepoint, &glyph_id)) {
+                cmap[codepoint] = glyph_id;
+                glyph_ids[glyph_id] = 0;
+            }
+        }
+        for (const std::string& string : strings) {
+            ttr_run_t* run = ttr_shape_text(font, string.c_str());
+            if (!run) {
+                fprintf(stderr, "Failed to shape string: %s\n", string.c_str());
+                for (ttr_run_t* shaped : runs) {
+                    ttr_destroy_run(shaped);
+                }
+                ttr_destroy_font(font);
+                ttr_destroy_context(ctx);
+                ttr_destroy_face(face);
+                return 1;
+            }
+            for (unsigned int i = 0; i < run->glyph_count; i++) {
+                glyph_ids[run->glyph_info[i].codepoint] = 0;
+            }
+            runs.push_back(run);
+        }
+
+        std::vector<GlyphBitmap> bitmaps;
+        for (auto& glyph_id : glyph_ids) {
+            glyph_id.second = bitmaps.size();
+            bitmaps.push_back(rasterize_glyph(ctx, font, glyph_id.first));
+        }
+
+        std::vector<ttr_pack_cmap_entry_t> cmap_entries;
+        for (const auto& entry : cmap) {
+            cmap_entries.push_back({ entry.first, glyph_ids[entry.second] });
+        }
+
+        std::vector<ttr_pack_string_t> pack_strings(strings.size());
+        for (size_t i = 0; i < strings.size(); i++) {
+            ttr_run_t* run = runs[i];
+
+            std::vector<ttr_pack_placement_t> placements;
+            int cursor_x = 0, cursor_y = 0;
+            for (unsigned int g = 0; g < run->glyph_count; g++) {
+                const hb_glyph_position_t& pos = run->glyph_pos[g];
+                placements.push_back({ glyph_ids[run->glyph_info[g].codepoint], cursor_x + pos.x_offset, cursor_y + pos.y_offset });
+                cursor_x += pos.x_advance;
+                cursor_y += pos.y_advance;
+            }
+
+            ttr_pack_string_t& pack_string = pack_strings[i];
+            pack_string.text_offset = writer.append(strings[i].c_str(), strings[i].size() + 1);
+            pack_string.placement_count = placements.size();
+            pack_string.placements_offset = writer.append(placements.data(), placements.size());
+            ttr_run_measure(run, &pack_string.width, &pack_string.height, &pack_string.baseline);
+
+            ttr_destroy_run(run);
+        }
+
+        for (GlyphBitmap& bitmap : bitmaps) {
+            bitmap.glyph.bitmap_offset = writer.bytes.size();
+            writer.bytes.insert(writer.bytes.end(), bitmap.coverage.begin(), bitmap.coverage.end());
+            coverage_bytes += bitmap.coverage.size();
+        }
+
+        std::vector<ttr_pack_glyph_t> glyphs;
+        for (const GlyphBitmap& bitmap : bitmaps) {
+            glyphs.push_back(bitmap.glyph);
+        }
+
+        hb_font_extents_t extents;
+        hb_font_get_h_extents(font, &extents);
+
+        ttr_pack_strike_t& strike = strikes[s];
+        strike.size = sizes[s];
+        strike.ascender = extents.ascender;
+        strike.descender = extents.descender;
+        strike.glyph_count = glyphs.size();
+        strike.glyphs_offset = writer.append(glyphs.data(), glyphs.size());
+        strike.cmap_count = cmap_entries.size();
+        strike.cmap_offset = writer.append(cmap_entries.data(), cmap_entries.size());
+        strike.string_count = pack_strings.size();
+        strike.strings_offset = writer.append(pack_strings.data(), pack_strings.size());
+        writer.patch(header.strikes_offset + s * sizeof(ttr_pack_strike_t), strike);
+
+        fprintf(stderr, "Size %u: %zu glyphs, %zu codepoints, %zu strings\n", sizes[s], glyphs.size(), cmap_entries.size(), pack_strings.size());
+
+        ttr_destroy_font(font);
+    }
+    writer.align();
+
+    ttr_destroy_context(ctx);
+    ttr_destroy_face(face);
+
+    FILE* file = fopen(output_file, "wb");
+    if (!file || fwrite(writer.bytes.data(), 1, writer.bytes.size(), file) != writer.bytes.size()) {
+        fprintf(stderr, "Failed to write pack: %s\n", output_file);
+        if (file) {
+            fclose(file);
+        }
+        return 1;
+    }
+    fclose(file);
+
+    fprintf(stderr, "Wrote %zu bytes, %zu of coverage\n", writer.bytes.size(), coverage_bytes);
+
+    return 0;
+}
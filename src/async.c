@@ -0,0 +1,634 @@
+#include "tiny_text_renderer.h"
+#include "run.h"
+#include "scale.h"
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef TTR_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define max(a, b) ({ \
+    typeof(a) _a = (a); \
+    typeof(b) _b = (b); \
+    _a > _b ? _a : _b; \
+})
+
+#define min(a, b) ({ \
+    typeof(a) _a = (a); \
+    typeof(b) _b = (b); \
+    _a < _b ? _a : _b; \
+})
+
+// Shaped lines and finished strips waiting between stages, for each rasterizing thread.
+#define ASYNC_QUEUE_PER_WORKER 2
+
+// Lines longer than this many bytes are cut into pieces at spaces, so that their pieces are rasterized in parallel.
+#define ASYNC_PIECE_LENGTH 256
+
+// A piece of a line of the text, shaped into a run of its own. Runs are reused from piece to piece.
+typedef struct async_chunk {
+    ttr_run_t run;
+    unsigned int line;
+} async_chunk;
+
+// Coverage of the rows of a piece within bounds, to be added to the destination.
+typedef struct async_strip {
+    int left;
+    int top;
+    unsigned int width;
+    unsigned int height;
+    uint8_t pixels[];
+} async_strip;
+
+#ifdef TTR_THREADS
+// Blocking queue of at most `capacity` items, NULL marking the end of the work of a stage.
+typedef struct async_queue {
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    void** items;
+    unsigned int capacity;
+    unsigned int head;
+    unsigned int count;
+} async_queue;
+#endif
+
+struct ttr_render_t {
+    hb_font_t* font;
+    const char* text;
+    unsigned int text_length;
+    unsigned int x_offset;
+    unsigned int y_offset;
+    unsigned int width;
+    uint8_t* pixels;
+
+    // Pixels of the destination that can be drawn, right and bottom edges excluded.
+    int left;
+    int top;
+    int right;
+    int bottom;
+
+    // In font scale, like a paragraph.
+    int ascender;
+    int line_height;
+
+    void (*done)(int result, void* user_data);
+    void* user_data;
+
+    // Set by any stage that couldn't draw a line.
+    int failed;
+
+#ifdef TTR_THREADS
+    async_chunk* chunks;
+    unsigned int chunk_count;
+
+    async_queue free_chunks;
+    async_queue shaped;
+    async_queue strips;
+
+    pthread_t shaper;
+    // Whether lines were shaped on the thread that started the render, as the shaping thread couldn't be.
+    bool shaped_inline;
+    pthread_t compositor;
+    pthread_t* workers;
+    unsigned int worker_count;
+
+    pthread_mutex_t mutex;
+    bool finished;
+    bool joined;
+#endif
+};
+
+#ifdef TTR_THREADS
+static int async_queue_init(async_queue* queue, unsigned int capacity) {
+    queue->items = malloc(capacity * sizeof(void*));
+    if (!queue->items) {
+        return -1;
+    }
+    if (pthread_mutex_init(&queue->mutex, NULL) != 0) {
+        free(queue->items);
+        return -1;
+    }
+    if (pthread_cond_init(&queue->not_empty, NULL) != 0) {
+        pthread_mutex_destroy(&queue->mutex);
+        free(queue->items);
+        return -1;
+    }
+    if (pthread_cond_init(&queue->not_full, NULL) != 0) {
+        pthread_cond_destroy(&queue->not_empty);
+        pthread_mutex_destroy(&queue->mutex);
+        free(queue->items);
+        return -1;
+    }
+
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    return 0;
+}
+
+static void async_queue_destroy(async_queue* queue) {
+    pthread_cond_destroy(&queue->not_full);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_mutex_destroy(&queue->mutex);
+    free(queue->items);
+}
+
+static void async_queue_push(async_queue* queue, void* item) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == queue->capacity) {
+        pthread_cond_wait(&queue->not_full, &queue->mutex);
+    }
+    queue->items[(queue->head + queue->count++) % queue->capacity] = item;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static void* async_queue_pop(async_queue* queue) {
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == 0) {
+        pthread_cond_wait(&queue->not_empty, &queue->mutex);
+    }
+    void* item = queue->items[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->mutex);
+    return item;
+}
+#endif
+
+static void async_set_failed(ttr_render_t* render) {
+    __atomic_store_n(&render->failed, 1, __ATOMIC_RELAXED);
+}
+
+static int async_result(ttr_render_t* render) {
+    return __atomic_load_n(&render->failed, __ATOMIC_RELAXED) ? -1 : 0;
+}
+
+// Shape the piece of a line from `start` up to `end` of the text, with the text around it as context, placed
+// `pen_x` from the start of the line in font scale.
+static bool async_shape(ttr_render_t* render, async_chunk* chunk, unsigned int line, unsigned int start, unsigned int end, int pen_x) {
+    ttr_run_t* run = &chunk->run;
+
+    chunk->line = line;
+    if (ttr_run_shape_segment(run, render->text, render->text_length, start, end - start) != 0) {
+        async_set_failed(render);
+        return false;
+    }
+
+    // Offsetting every glyph keeps the fractional position of the pen, as when drawing the line as a whole.
+    for (unsigned int i = 0; i < run->glyph_count; i++) {
+        run->glyph_pos[i].x_offset += pen_x;
+    }
+    run->x_min += pen_x;
+    run->x_max += pen_x;
+
+    return true;
+}
+
+// Rasterize the glyphs of a shaped line into a strip covering its ink, or return NULL if none of it is in bounds.
+static async_strip* async_rasterize(ttr_render_t* render, ttr_context_t* ctx, const async_chunk* chunk) {
+    const ttr_run_t* run = &chunk->run;
+    if (run->glyph_count == 0) {
+        return NULL;
+    }
+
+    unsigned int ink_width, ink_height, ink_baseline;
+    ttr_run_measure(run, &ink_width, &ink_height, &ink_baseline);
+
+    // The strip has a pixel of margin around the ink of the line for glyphs on fractional positions.
+    long long baseline = (long long)render->y_offset + (((long long)chunk->line * render->line_height + render->ascender + 32) >> 6);
+    long long strip_top = baseline - ink_baseline - 1;
+    long long strip_left = (long long)render->x_offset + ttr_scale_down_floor(run->x_min) - 1;
+
+    int left = max(strip_left, (long long)render->left);
+    int top = max(strip_top, (long long)render->top);
+    int right = min((long long)render->x_offset + ttr_scale_down_ceil(run->x_max) + 1, (long long)render->right);
+    int bottom = min(strip_top + ink_height + 2, (long long)render->bottom);
+    if (left >= right || top >= bottom) {
+        return NULL;
+    }
+
+    async_strip* strip = calloc(1, sizeof(async_strip) + (size_t)(right - left) * (bottom - top));
+    if (!strip) {
+        async_set_failed(render);
+        return NULL;
+    }
+    strip->left = left;
+    strip->top = top;
+    strip->width = right - left;
+    strip->height = bottom - top;
+
+    // Draw the line with its baseline a pixel below the top of the strip, only rasterizing the rows in bounds.
+    ttr_rect_t clip = { left, top - strip_top, strip->width, strip->height };
+    ttr_glyph_iterator_t iterator;
+    ttr_run_glyphs_begin(&iterator, ctx, run, render->x_offset, 1, 0, 0, &clip);
+
+    ttr_glyph_bitmap_t bitmap;
+    int result;
+    while ((result = ttr_run_glyphs_next(&iterator, &bitmap)) > 0) {
+        const uint8_t* coverage = bitmap.coverage;
+        uint8_t* row = strip->pixels + (size_t)(bitmap.y - clip.y) * strip->width + (bitmap.x - left);
+        for (unsigned int y = 0; y < bitmap.height; y++, coverage += bitmap.stride, row += strip->width) {
+            for (unsigned int x = 0; x < bitmap.width; x++) {
+                row[x] = min(row[x] + coverage[x], 255);
+            }
+        }
+    }
+    if (result < 0) {
+        async_set_failed(render);
+    }
+
+    return strip;
+}
+
+// Add the coverage of a strip to the destination, saturating like `ttr_draw_text_on_buffer`.
+static void async_composite(ttr_render_t* render, async_strip* strip) {
+    const uint8_t* coverage = strip->pixels;
+    for (unsigned int y = 0; y < strip->height; y++, coverage += strip->width) {
+        uint8_t* pixels = render->pixels + (size_t)(strip->top + y) * render->width + strip->left;
+        for (unsigned int x = 0; x < strip->width; x++) {
+            pixels[x] = min(pixels[x] + coverage[x], 255);
+        }
+    }
+}
+
+// Find the line from `start`, returning where it ends, excluding the newline.
+static unsigned int async_line_end(const ttr_render_t* render, unsigned int start) {
+    const char* newline = memchr(render->text + start, '\n', render->text_length - start);
+    return newline ? (unsigned int)(newline - render->text) : render->text_length;
+}
+
+// Find the piece of a line from `start`, returning where it ends, after the first space past `ASYNC_PIECE_LENGTH`
+// bytes or at the end of the line.
+static unsigned int async_piece_end(const ttr_render_t* render, unsigned int start, unsigned int line_end) {
+    if (line_end - start <= ASYNC_PIECE_LENGTH) {
+        return line_end;
+    }
+    const char* space = memchr(render->text + start + ASYNC_PIECE_LENGTH, ' ', line_end - start - ASYNC_PIECE_LENGTH);
+    return space ? (unsigned int)(space - render->text) + 1 : line_end;
+}
+
+// Shape the text piece by piece, shaping each into a chunk from `take_chunk` and then giving it to `hand_over`,
+// with whether it could be shaped.
+static void async_shape_pieces(
+    ttr_render_t* render,
+    async_chunk* (*take_chunk)(void* user_data),
+    void (*hand_over)(async_chunk* chunk, bool shaped, void* user_data),
+    void* user_data)
+{
+    unsigned int line = 0;
+    for (unsigned int line_start = 0;; line++) {
+        unsigned int line_end = async_line_end(render, line_start);
+
+        int pen_x = 0;
+        for (unsigned int start = line_start; start < line_end;) {
+            unsigned int end = async_piece_end(render, start, line_end);
+
+            async_chunk* chunk = take_chunk(user_data);
+            bool shaped = async_shape(render, chunk, line, start, end, pen_x);
+            if (shaped && start == line_start && end < line_end && HB_DIRECTION_IS_BACKWARD(chunk->run.direction)) {
+                // Pieces are placed from left to right, so right to left lines are shaped whole instead.
+                end = line_end;
+                shaped = async_shape(render, chunk, line, start, end, 0);
+            }
+
+            if (shaped) {
+                for (unsigned int i = 0; i < chunk->run.glyph_count; i++) {
+                    pen_x += chunk->run.glyph_pos[i].x_advance;
+                }
+            }
+            hand_over(chunk, shaped, user_data);
+
+            start = end;
+        }
+
+        if (line_end == render->text_length) {
+            break;
+        }
+        line_start = line_end + 1;
+    }
+}
+
+typedef struct async_inline_data {
+    ttr_render_t* render;
+    ttr_context_t* ctx;
+    async_chunk chunk;
+} async_inline_data;
+
+static async_chunk* async_take_inline_chunk(void* user_data) {
+    return &((async_inline_data*)user_data)->chunk;
+}
+
+static void async_draw_inline_chunk(async_chunk* chunk, bool shaped, void* user_data) {
+    async_inline_data* data = (async_inline_data*)user_data;
+
+    async_strip* strip = shaped ? async_rasterize(data->render, data->ctx, chunk) : NULL;
+    if (strip) {
+        async_composite(data->render, strip);
+        free(strip);
+    }
+}
+
+// Draw every piece on the calling thread, one stage after the other.
+static void async_draw_lines(ttr_render_t* render) {
+    async_inline_data data = {
+        .render = render,
+        .ctx = ttr_create_context(),
+        .chunk = { .run = { .font = render->font, .buffer = hb_buffer_create() } },
+    };
+
+    if (!data.ctx) {
+        async_set_failed(render);
+    } else {
+        async_shape_pieces(render, async_take_inline_chunk, async_draw_inline_chunk, &data);
+    }
+
+    free(data.chunk.run.glyph_extents);
+    hb_buffer_destroy(data.chunk.run.buffer);
+    ttr_destroy_context(data.ctx);
+}
+
+#ifdef TTR_THREADS
+static async_chunk* async_take_free_chunk(void* user_data) {
+    ttr_render_t* render = (ttr_render_t*)user_data;
+
+    // Waits for a worker to be done with a piece when all chunks are in flight.
+    return async_queue_pop(&render->free_chunks);
+}
+
+static void async_hand_over_chunk(async_chunk* chunk, bool shaped, void* user_data) {
+    ttr_render_t* render = (ttr_render_t*)user_data;
+
+    async_queue_push(shaped ? &render->shaped : &render->free_chunks, chunk);
+}
+
+static void* async_shape_lines(void* user_data) {
+    ttr_render_t* render = (ttr_render_t*)user_data;
+
+    async_shape_pieces(render, async_take_free_chunk, async_hand_over_chunk, render);
+
+    for (unsigned int i = 0; i < render->worker_count; i++) {
+        async_queue_push(&render->shaped, NULL);
+    }
+
+    return NULL;
+}
+
+static void* async_rasterize_lines(void* user_data) {
+    ttr_render_t* render = (ttr_render_t*)user_data;
+
+    ttr_context_t* ctx = ttr_create_context();
+
+    async_chunk* chunk;
+    while ((chunk = async_queue_pop(&render->shaped))) {
+        async_strip* strip = ctx ? async_rasterize(render, ctx, chunk) : NULL;
+        if (!ctx) {
+            async_set_failed(render);
+        }
+        async_queue_push(&render->free_chunks, chunk);
+
+        if (strip) {
+            async_queue_push(&render->strips, strip);
+        }
+    }
+
+    ttr_destroy_context(ctx);
+
+    async_queue_push(&render->strips, NULL);
+    return NULL;
+}
+
+static void* async_composite_lines(void* user_data) {
+    ttr_render_t* render = (ttr_render_t*)user_data;
+
+    // Strips come in whatever order workers finish them, which doesn't matter as coverage is added.
+    unsigned int workers_left = render->worker_count;
+    while (workers_left > 0) {
+        async_strip* strip = async_queue_pop(&render->strips);
+        if (strip) {
+            async_composite(render, strip);
+            free(strip);
+        } else {
+            workers_left--;
+        }
+    }
+
+    if (render->done) {
+        render->done(async_result(render), render->user_data);
+    }
+
+    pthread_mutex_lock(&render->mutex);
+    render->finished = true;
+    pthread_mutex_unlock(&render->mutex);
+
+    return NULL;
+}
+
+static unsigned int async_default_thread_count(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (unsigned int)cpus : 1;
+}
+
+static void async_free_pipeline(ttr_render_t* render) {
+    for (unsigned int i = 0; i < render->chunk_count; i++) {
+        free(render->chunks[i].run.glyph_extents);
+        hb_buffer_destroy(render->chunks[i].run.buffer);
+    }
+    free(render->chunks);
+    free(render->workers);
+    render->chunks = NULL;
+    render->workers = NULL;
+    render->chunk_count = 0;
+}
+
+// Start the threads of the pipeline, returning -1 if it couldn't be, in which case the text is yet to be drawn.
+static int async_start(ttr_render_t* render, unsigned int thread_count) {
+    unsigned int queue_capacity = thread_count * ASYNC_QUEUE_PER_WORKER;
+
+    // Lines waiting to be rasterized and lines being rasterized each hold a chunk.
+    render->chunk_count = queue_capacity + thread_count;
+    render->chunks = calloc(render->chunk_count, sizeof(async_chunk));
+    render->workers = calloc(thread_count, sizeof(pthread_t));
+    if (!render->chunks || !render->workers) {
+        async_free_pipeline(render);
+        return -1;
+    }
+    for (unsigned int i = 0; i < render->chunk_count; i++) {
+        render->chunks[i].run.font = render->font;
+        render->chunks[i].run.buffer = hb_buffer_create();
+    }
+
+    if (async_queue_init(&render->free_chunks, render->chunk_count) != 0) {
+        async_free_pipeline(render);
+        return -1;
+    }
+    if (async_queue_init(&render->shaped, queue_capacity) != 0) {
+        async_queue_destroy(&render->free_chunks);
+        async_free_pipeline(render);
+        return -1;
+    }
+    // Room for the end of each worker too, so that workers never wait on a compositor that isn't running.
+    if (async_queue_init(&render->strips, queue_capacity + thread_count) != 0) {
+        async_queue_destroy(&render->shaped);
+        async_queue_destroy(&render->free_chunks);
+        async_free_pipeline(render);
+        return -1;
+    }
+    for (unsigned int i = 0; i < render->chunk_count; i++) {
+        async_queue_push(&render->free_chunks, &render->chunks[i]);
+    }
+
+    while (render->worker_count < thread_count && pthread_create(&render->workers[render->worker_count], NULL, async_rasterize_lines, render) == 0) {
+        render->worker_count++;
+    }
+
+    bool compositing = render->worker_count > 0 && pthread_create(&render->compositor, NULL, async_composite_lines, render) == 0;
+    if (compositing && pthread_create(&render->shaper, NULL, async_shape_lines, render) == 0) {
+        return 0;
+    }
+
+    if (compositing) {
+        // Shape on the calling thread instead, while the other stages run.
+        async_shape_lines(render);
+        render->shaped_inline = true;
+        return 0;
+    }
+
+    // Stop the workers that were started, which have nothing to hand over.
+    for (unsigned int i = 0; i < render->worker_count; i++) {
+        async_queue_push(&render->shaped, NULL);
+    }
+    for (unsigned int i = 0; i < render->worker_count; i++) {
+        pthread_join(render->workers[i], NULL);
+    }
+    render->worker_count = 0;
+
+    async_queue_destroy(&render->strips);
+    async_queue_destroy(&render->shaped);
+    async_queue_destroy(&render->free_chunks);
+    async_free_pipeline(render);
+    return -1;
+}
+#endif
+
+ttr_render_t* ttr_draw_text_async(
+    hb_font_t* font,
+    const char *text,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    const ttr_rect_t* clip,
+    uint8_t* pixels,
+    unsigned int thread_count,
+    void (*done)(int result, void* user_data),
+    void* user_data)
+{
+    ttr_render_t* render = calloc(1, sizeof(ttr_render_t));
+    if (!render) {
+        return NULL;
+    }
+
+    render->font = hb_font_reference(font);
+    render->text = text;
+    render->text_length = strlen(text);
+    render->x_offset = x_offset;
+    render->y_offset = y_offset;
+    render->width = width;
+    render->pixels = pixels;
+    render->done = done;
+    render->user_data = user_data;
+
+    // A width or height of 0 doesn't limit drawing along that axis.
+    render->right = width > 0 ? (int)width : INT_MAX;
+    render->bottom = height > 0 ? (int)height : INT_MAX;
+    if (clip) {
+        render->left = min(clip->x, (unsigned int)INT_MAX);
+        render->top = min(clip->y, (unsigned int)INT_MAX);
+        render->right = min(render->right, (int)min((unsigned long long)clip->x + clip->width, (unsigned long long)INT_MAX));
+        render->bottom = min(render->bottom, (int)min((unsigned long long)clip->y + clip->height, (unsigned long long)INT_MAX));
+    }
+
+    hb_font_extents_t extents;
+    hb_font_get_h_extents(font, &extents);
+    render->ascender = extents.ascender;
+    render->line_height = extents.ascender - extents.descender + extents.line_gap;
+
+#ifdef TTR_THREADS
+    if (pthread_mutex_init(&render->mutex, NULL) != 0) {
+        hb_font_destroy(render->font);
+        free(render);
+        return NULL;
+    }
+
+    if (async_start(render, thread_count > 0 ? thread_count : async_default_thread_count()) == 0) {
+        return render;
+    }
+
+    render->finished = true;
+    render->joined = true;
+#endif
+
+    // Without threads, or if they couldn't be started, the text is drawn before returning.
+    async_draw_lines(render);
+    if (render->done) {
+        render->done(async_result(render), render->user_data);
+    }
+
+    return render;
+}
+
+int ttr_render_is_done(ttr_render_t* render) {
+#ifdef TTR_THREADS
+    pthread_mutex_lock(&render->mutex);
+    bool finished = render->finished;
+    pthread_mutex_unlock(&render->mutex);
+    return finished;
+#else
+    return 1;
+#endif
+}
+
+int ttr_render_wait(ttr_render_t* render) {
+#ifdef TTR_THREADS
+    if (!render->joined) {
+        if (!render->shaped_inline) {
+            pthread_join(render->shaper, NULL);
+        }
+        for (unsigned int i = 0; i < render->worker_count; i++) {
+            pthread_join(render->workers[i], NULL);
+        }
+        pthread_join(render->compositor, NULL);
+
+        async_queue_destroy(&render->strips);
+        async_queue_destroy(&render->shaped);
+        async_queue_destroy(&render->free_chunks);
+        async_free_pipeline(render);
+        render->joined = true;
+    }
+#endif
+
+    return async_result(render);
+}
+
+void ttr_destroy_render(ttr_render_t* render) {
+    if (!render) {
+        return;
+    }
+
+    ttr_render_wait(render);
+
+#ifdef TTR_THREADS
+    pthread_mutex_destroy(&render->mutex);
+#endif
+    hb_font_destroy(render->font);
+    free(render);
+}
@@ -0,0 +1,398 @@
+#include "atlas.h"
+#include "face.h"
+#include "glyph.h"
+#include "mutex.h"
+#include "stats.h"
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define max(a, b) ({ \
+    typeof(a) _a = (a); \
+    typeof(b) _b = (b); \
+    _a > _b ? _a : _b; \
+})
+
+// Empty pixels kept to the right of and below each glyph, so that glyphs don't bleed into each other when
+// the atlas is sampled with filtering.
+#define ATLAS_PADDING 1
+
+typedef struct atlas_entry {
+    // Index of the next entry in the same bucket, or -1.
+    int hash_next;
+
+    // Id of the face rather than its address, which a face created after it is destroyed can get.
+    uintptr_t face_id;
+    hb_codepoint_t glyph;
+    int x_scale;
+    int y_scale;
+    unsigned int offset_x;
+    unsigned int offset_y;
+
+    // Rectangle of the glyph in the atlas.
+    unsigned int x;
+    unsigned int y;
+    unsigned int width;
+    unsigned int height;
+} atlas_entry;
+
+// A horizontal segment of the skyline, the top of the space used so far.
+typedef struct skyline_node {
+    unsigned int x;
+    unsigned int y;
+    unsigned int width;
+} skyline_node;
+
+struct ttr_atlas_t {
+    ttr_mutex_t mutex;
+
+    unsigned int width;
+    unsigned int height;
+    uint8_t* pixels;
+
+    // Segments ordered by x, covering the whole width. There can't be more segments than columns.
+    skyline_node* nodes;
+    unsigned int node_count;
+
+    atlas_entry* entries;
+    unsigned int entry_count;
+    unsigned int entry_capacity;
+
+    int* buckets;
+    unsigned int bucket_mask;
+
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long resets;
+};
+
+static void atlas_reset(ttr_atlas_t* atlas) {
+    atlas->nodes[0] = (skyline_node) { 0, 0, atlas->width };
+    atlas->node_count = 1;
+
+    atlas->entry_count = 0;
+    memset(atlas->buckets, 0xff, (atlas->bucket_mask + 1) * sizeof(int));
+}
+
+ttr_atlas_t* ttr_create_atlas(unsigned int width, unsigned int height) {
+    if (width == 0 || height == 0) {
+        return NULL;
+    }
+
+    ttr_atlas_t* atlas = calloc(1, sizeof(ttr_atlas_t));
+    if (!atlas) {
+        return NULL;
+    }
+
+    // Roughly one bucket per 16x16 glyph the atlas can hold.
+    unsigned int bucket_count = 16;
+    while (bucket_count < 65536 && (size_t)bucket_count * 256 < (size_t)width * height) {
+        bucket_count <<= 1;
+    }
+
+    atlas->width = width;
+    atlas->height = height;
+    atlas->bucket_mask = bucket_count - 1;
+
+    atlas->pixels = malloc((size_t)width * height);
+    atlas->nodes = malloc((width + 1) * sizeof(skyline_node));
+    atlas->buckets = malloc(bucket_count * sizeof(int));
+    if (!atlas->pixels || !atlas->nodes || !atlas->buckets || ttr_mutex_init(&atlas->mutex) != 0) {
+        free(atlas->pixels);
+        free(atlas->nodes);
+        free(atlas->buckets);
+        free(atlas);
+        return NULL;
+    }
+
+    atlas_reset(atlas);
+
+    return atlas;
+}
+
+void ttr_destroy_atlas(ttr_atlas_t* atlas) {
+    if (!atlas) {
+        return;
+    }
+
+    ttr_mutex_destroy(&atlas->mutex);
+    free(atlas->pixels);
+    free(atlas->nodes);
+    free(atlas->entries);
+    free(atlas->buckets);
+    free(atlas);
+}
+
+void ttr_atlas_get_stats(ttr_atlas_t* atlas, unsigned long* hits, unsigned long* misses, unsigned long* resets) {
+    ttr_mutex_lock(&atlas->mutex);
+    if (hits != NULL) {
+        *hits = atlas->hits;
+    }
+    if (misses != NULL) {
+        *misses = atlas->misses;
+    }
+    if (resets != NULL) {
+        *resets = atlas->resets;
+    }
+    ttr_mutex_unlock(&atlas->mutex);
+}
+
+static unsigned int atlas_hash(uintptr_t face_id, hb_codepoint_t glyph, int x_scale, int y_scale, unsigned int offset_x, unsigned int offset_y) {
+    uint32_t hash = (uint32_t)face_id;
+    hash = (hash ^ glyph) * 0x9E3779B1u;
+    hash = (hash ^ (uint32_t)x_scale) * 0x9E3779B1u;
+    hash = (hash ^ (uint32_t)y_scale) * 0x9E3779B1u;
+    hash = (hash ^ (offset_x << 8) ^ offset_y) * 0x9E3779B1u;
+    return hash ^ (hash >> 16);
+}
+
+// Height at which a rectangle starting at node `i` would rest on the skyline, or -1 if it doesn't fit there.
+static int skyline_fit(const ttr_atlas_t* atlas, unsigned int i, unsigned int width, unsigned int height) {
+    if (atlas->nodes[i].x + width > atlas->width) {
+        return -1;
+    }
+
+    unsigned int y = 0;
+    int remaining = width;
+    while (remaining > 0) {
+        y = max(y, atlas->nodes[i].y);
+        if (y + height > atlas->height) {
+            return -1;
+        }
+        remaining -= atlas->nodes[i].width;
+        i++;
+    }
+
+    return y;
+}
+
+static void skyline_remove(ttr_atlas_t* atlas, unsigned int i) {
+    memmove(&atlas->nodes[i], &atlas->nodes[i + 1], (atlas->node_count - i - 1) * sizeof(skyline_node));
+    atlas->node_count--;
+}
+
+// Find room for a rectangle, the lowest first and then the one leaving the narrowest gap, and raise the skyline over it.
+static bool skyline_pack(ttr_atlas_t* atlas, unsigned int width, unsigned int height, unsigned int* x, unsigned int* y) {
+    int best = -1;
+    unsigned int best_top = UINT_MAX;
+    unsigned int best_width = UINT_MAX;
+    unsigned int best_y = 0;
+
+    for (unsigned int i = 0; i < atlas->node_count; i++) {
+        int fit_y = skyline_fit(atlas, i, width, height);
+        if (fit_y < 0) {
+            continue;
+        }
+
+        unsigned int top = fit_y + height;
+        if (top < best_top || (top == best_top && atlas->nodes[i].width < best_width)) {
+            best = i;
+            best_top = top;
+            best_width = atlas->nodes[i].width;
+            best_y = fit_y;
+        }
+    }
+
+    if (best < 0) {
+        return false;
+    }
+
+    *x = atlas->nodes[best].x;
+    *y = best_y;
+
+    memmove(&atlas->nodes[best + 1], &atlas->nodes[best], (atlas->node_count - best) * sizeof(skyline_node));
+    atlas->nodes[best] = (skyline_node) { *x, best_top, width };
+    atlas->node_count++;
+
+    // Shrink or remove the segments now under the rectangle.
+    for (unsigned int i = best + 1; i < atlas->node_count; i++) {
+        skyline_node* prev = &atlas->nodes[i - 1];
+        skyline_node* node = &atlas->nodes[i];
+
+        unsigned int prev_end = prev->x + prev->width;
+        if (node->x >= prev_end) {
+            break;
+        }
+
+        unsigned int shrink = prev_end - node->x;
+        if (node->width > shrink) {
+            node->x += shrink;
+            node->width -= shrink;
+            break;
+        }
+
+        skyline_remove(atlas, i);
+        i--;
+    }
+
+    // Merge neighbouring segments at the same height.
+    for (unsigned int i = 0; i + 1 < atlas->node_count;) {
+        if (atlas->nodes[i].y == atlas->nodes[i + 1].y) {
+            atlas->nodes[i].width += atlas->nodes[i + 1].width;
+            skyline_remove(atlas, i + 1);
+        } else {
+            i++;
+        }
+    }
+
+    return true;
+}
+
+static atlas_entry* atlas_find(ttr_atlas_t* atlas, unsigned int bucket, uintptr_t face_id, hb_codepoint_t glyph, int x_scale, int y_scale, unsigned int offset_x, unsigned int offset_y) {
+    for (int i = atlas->buckets[bucket]; i >= 0; i = atlas->entries[i].hash_next) {
+        atlas_entry* entry = &atlas->entries[i];
+        if (entry->face_id == face_id && entry->glyph == glyph
+            && entry->x_scale == x_scale && entry->y_scale == y_scale
+            && entry->offset_x == offset_x && entry->offset_y == offset_y) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+typedef struct atlas_store_span_data {
+    uint8_t* pixels;
+    unsigned int stride;
+} atlas_store_span_data;
+
+static void atlas_store_span(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data) {
+    atlas_store_span_data* data = (atlas_store_span_data*)user_data;
+
+    memcpy(&data->pixels[y * data->stride + x_start], coverage, len);
+}
+
+// Rasterize a glyph into a new rectangle of the atlas, starting over with an empty atlas when it is full.
+static atlas_entry* atlas_insert(
+    ttr_atlas_t* atlas,
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    uintptr_t face_id,
+    hb_codepoint_t glyph,
+    hb_glyph_extents_t extents,
+    unsigned int offset_x,
+    unsigned int offset_y,
+    unsigned int width,
+    unsigned int height
+) {
+    if (atlas->entry_count == atlas->entry_capacity) {
+        unsigned int capacity = atlas->entry_capacity ? atlas->entry_capacity * 2 : 64;
+        atlas_entry* entries = realloc(atlas->entries, capacity * sizeof(atlas_entry));
+        if (!entries) {
+            return NULL;
+        }
+        atlas->entries = entries;
+        atlas->entry_capacity = capacity;
+    }
+
+    unsigned int x, y;
+    if (!skyline_pack(atlas, width + ATLAS_PADDING, height + ATLAS_PADDING, &x, &y)) {
+        atlas_reset(atlas);
+        atlas->resets++;
+
+        if (!skyline_pack(atlas, width + ATLAS_PADDING, height + ATLAS_PADDING, &x, &y)) {
+            return NULL;
+        }
+    }
+
+    uint8_t* pixels = &atlas->pixels[(size_t)y * atlas->width + x];
+    for (unsigned int row = 0; row < height + ATLAS_PADDING; row++) {
+        memset(&pixels[(size_t)row * atlas->width], 0, width + ATLAS_PADDING);
+    }
+
+    atlas_store_span_data data = { pixels, atlas->width };
+    if (ttr_draw_glyph(ctx, font, glyph, extents, offset_x, offset_y, atlas_store_span, &data) != 0) {
+        return NULL;
+    }
+
+    atlas_entry* entry = &atlas->entries[atlas->entry_count++];
+    *entry = (atlas_entry) {
+        .face_id = face_id,
+        .glyph = glyph,
+        .offset_x = offset_x,
+        .offset_y = offset_y,
+        .x = x,
+        .y = y,
+        .width = width,
+        .height = height
+    };
+    hb_font_get_scale(font, &entry->x_scale, &entry->y_scale);
+
+    return entry;
+}
+
+int ttr_draw_atlas_glyph(
+    ttr_atlas_t* atlas,
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    hb_codepoint_t glyph,
+    hb_glyph_extents_t extents,
+    unsigned int offset_x,
+    unsigned int offset_y,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data
+) {
+    if (extents.width == 0 || extents.height == 0) {
+        // Nothing to be done
+        return 0;
+    }
+
+    // Entries aren't keyed on variations.
+    unsigned int coords_length;
+    hb_font_get_var_coords_normalized(font, &coords_length);
+
+    uintptr_t face_id = coords_length == 0 ? ttr_face_get_id(hb_font_get_face(font)) : 0;
+    if (face_id == 0) {
+        return ttr_draw_glyph(ctx, font, glyph, extents, offset_x, offset_y, draw_span, user_data);
+    }
+
+    int x_scale, y_scale;
+    hb_font_get_scale(font, &x_scale, &y_scale);
+
+    unsigned int bucket = atlas_hash(face_id, glyph, x_scale, y_scale, offset_x, offset_y) & atlas->bucket_mask;
+
+    // Held while copying out too, as a miss on another thread could reuse the rectangle.
+    ttr_mutex_lock(&atlas->mutex);
+
+    atlas_entry* entry = atlas_find(atlas, bucket, face_id, glyph, x_scale, y_scale, offset_x, offset_y);
+    if (entry) {
+        atlas->hits++;
+        ttr_stats_add(atlas_hits, 1);
+    } else {
+        atlas->misses++;
+        ttr_stats_add(atlas_misses, 1);
+
+        unsigned int width, height;
+        ttr_glyph_bitmap_size(extents, offset_x, offset_y, &width, &height);
+
+        if (width + ATLAS_PADDING > atlas->width || height + ATLAS_PADDING > atlas->height) {
+            // Would never fit, draw directly.
+            ttr_mutex_unlock(&atlas->mutex);
+            return ttr_draw_glyph(ctx, font, glyph, extents, offset_x, offset_y, draw_span, user_data);
+        }
+
+        entry = atlas_insert(atlas, ctx, font, face_id, glyph, extents, offset_x, offset_y, width, height);
+        if (!entry) {
+            ttr_mutex_unlock(&atlas->mutex);
+            return -1;
+        }
+
+        entry->hash_next = atlas->buckets[bucket];
+        atlas->buckets[bucket] = entry - atlas->entries;
+    }
+
+    ttr_stats_timer(copy_start);
+
+    const uint8_t* pixels = &atlas->pixels[(size_t)entry->y * atlas->width + entry->x];
+    for (unsigned int y = 0; y < entry->height; y++) {
+        ttr_draw_coverage_row(y, &pixels[(size_t)y * atlas->width], entry->width, draw_span, user_data);
+    }
+
+    ttr_stats_add_time(composite_ns, copy_start);
+
+    ttr_mutex_unlock(&atlas->mutex);
+
+    return 0;
+}
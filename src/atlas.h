@@ -0,0 +1,35 @@
+#ifndef TTR_ATLAS_H
+#define TTR_ATLAS_H 1
+
+#include <hb.h>
+
+#include "tiny_text_renderer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Draw a glyph by copying its coverage from the atlas, rasterizing it into the atlas first if it isn't there yet.
+ * Each row of the glyph is handed to `draw_span` whole, including pixels with zero coverage.
+ *
+ * Takes the same parameters as `ttr_draw_glyph`, plus the atlas to use.
+ * Offsets are expected to be already rounded with `ttr_round_scaled_to_phase`.
+ */
+int ttr_draw_atlas_glyph(
+    ttr_atlas_t* atlas,
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    hb_codepoint_t glyph,
+    hb_glyph_extents_t extents,
+    unsigned int offset_x,
+    unsigned int offset_y,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_ATLAS_H */
@@ -0,0 +1,173 @@
+#include "tiny_text_renderer.h"
+#include "mutex.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifdef TTR_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+typedef struct batch_state batch_state;
+typedef struct batch_worker batch_worker;
+
+struct batch_worker {
+    batch_state* batch;
+    ttr_context_t* ctx;
+
+    // Jobs not taken yet, from `next` up to `end`. The worker takes them from the front, others steal from the back.
+    ttr_mutex_t mutex;
+    unsigned int next;
+    unsigned int end;
+
+#ifdef TTR_THREADS
+    pthread_t thread;
+#endif
+};
+
+struct batch_state {
+    const ttr_text_job_t* jobs;
+    batch_worker* workers;
+    unsigned int worker_count;
+};
+
+static bool batch_take(batch_worker* worker, unsigned int* job) {
+    bool taken = false;
+
+    ttr_mutex_lock(&worker->mutex);
+    if (worker->next < worker->end) {
+        *job = worker->next++;
+        taken = true;
+    }
+    ttr_mutex_unlock(&worker->mutex);
+
+    return taken;
+}
+
+// Move the back half of the jobs left to another worker over to this one, which has run out.
+static bool batch_steal(batch_worker* thief) {
+    batch_state* batch = thief->batch;
+    unsigned int self = thief - batch->workers;
+
+    for (unsigned int i = 1; i < batch->worker_count; i++) {
+        batch_worker* victim = &batch->workers[(self + i) % batch->worker_count];
+
+        ttr_mutex_lock(&victim->mutex);
+        unsigned int left = victim->end - victim->next;
+        unsigned int stolen = (left + 1) / 2;
+        victim->end -= stolen;
+        unsigned int start = victim->end;
+        ttr_mutex_unlock(&victim->mutex);
+
+        if (stolen > 0) {
+            ttr_mutex_lock(&thief->mutex);
+            thief->next = start;
+            thief->end = start + stolen;
+            ttr_mutex_unlock(&thief->mutex);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void* batch_work(void* user_data) {
+    batch_worker* worker = (batch_worker*)user_data;
+
+    unsigned int index;
+    for (;;) {
+        if (!batch_take(worker, &index)) {
+            if (!batch_steal(worker)) {
+                break;
+            }
+            continue;
+        }
+
+        const ttr_text_job_t* job = &worker->batch->jobs[index];
+        ttr_draw_text_on_buffer(worker->ctx, job->font, job->text, job->x_offset, job->y_offset, job->width, job->height, job->clip, job->pixels);
+    }
+
+    return NULL;
+}
+
+// Draw every job on the calling thread, when workers can't be set up.
+static void batch_draw_serially(const ttr_text_job_t* jobs, unsigned int job_count) {
+    for (unsigned int i = 0; i < job_count; i++) {
+        ttr_draw_text_on_buffer(NULL, jobs[i].font, jobs[i].text, jobs[i].x_offset, jobs[i].y_offset, jobs[i].width, jobs[i].height, jobs[i].clip, jobs[i].pixels);
+    }
+}
+
+static unsigned int batch_default_thread_count(void) {
+#ifdef TTR_THREADS
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (unsigned int)cpus : 1;
+#else
+    return 1;
+#endif
+}
+
+void ttr_draw_text_batch(const ttr_text_job_t* jobs, unsigned int job_count, unsigned int thread_count) {
+#ifdef TTR_THREADS
+    if (thread_count == 0) {
+        thread_count = batch_default_thread_count();
+    }
+#else
+    thread_count = batch_default_thread_count();
+#endif
+    if (thread_count > job_count) {
+        thread_count = job_count;
+    }
+    if (thread_count == 0) {
+        return;
+    }
+
+    batch_worker* workers = calloc(thread_count, sizeof(batch_worker));
+    if (!workers) {
+        batch_draw_serially(jobs, job_count);
+        return;
+    }
+
+    unsigned int worker_count = 0;
+    while (worker_count < thread_count && ttr_mutex_init(&workers[worker_count].mutex) == 0) {
+        worker_count++;
+    }
+    if (worker_count == 0) {
+        free(workers);
+        batch_draw_serially(jobs, job_count);
+        return;
+    }
+
+    batch_state batch = { jobs, workers, worker_count };
+
+    for (unsigned int i = 0; i < worker_count; i++) {
+        workers[i].batch = &batch;
+        // Without a context of its own the worker falls back to temporary ones.
+        workers[i].ctx = ttr_create_context();
+        workers[i].next = (unsigned long)job_count * i / worker_count;
+        workers[i].end = (unsigned long)job_count * (i + 1) / worker_count;
+    }
+
+    // The calling thread works too. Jobs of workers that could not be started get stolen by the others.
+#ifdef TTR_THREADS
+    unsigned int started = 1;
+    while (started < worker_count && pthread_create(&workers[started].thread, NULL, batch_work, &workers[started]) == 0) {
+        started++;
+    }
+#endif
+
+    batch_work(&workers[0]);
+
+#ifdef TTR_THREADS
+    for (unsigned int i = 1; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+#endif
+
+    for (unsigned int i = 0; i < worker_count; i++) {
+        ttr_destroy_context(workers[i].ctx);
+        ttr_mutex_destroy(&workers[i].mutex);
+    }
+    free(workers);
+}
@@ -0,0 +1,330 @@
+#include "blit.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if !defined(TTR_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__))
+#define TTR_BLIT_SSE2 1
+#include <emmintrin.h>
+#elif !defined(TTR_NO_SIMD) && defined(__ARM_NEON)
+#define TTR_BLIT_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Every channel is blended as `src * coverage / 255 + dst * (255 - alpha * coverage / 255) / 255`, with `src`
+// premultiplied by alpha. Each product fits in 16 bits and the sum can't exceed 255, so vector variants can do
+// the same arithmetic in 16-bit lanes and match the scalar one exactly.
+
+// x / 255 rounded to nearest, for x up to 255 * 255.
+static inline unsigned int div255(unsigned int x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static inline uint8_t blend_channel(unsigned int src, unsigned int dst, unsigned int coverage, unsigned int inverse) {
+    return div255(src * coverage) + div255(dst * inverse);
+}
+
+static inline unsigned int inverse_alpha(const ttr_blit_t* blit, unsigned int coverage) {
+    return 255 - div255(blit->alpha * coverage);
+}
+
+static void blend_row_rgb565_scalar(const ttr_blit_t* blit, uint8_t* row, unsigned int x, const uint8_t* coverage, unsigned int len) {
+    uint16_t* pixels = (uint16_t*)row + x;
+
+    for (unsigned int i = 0; i < len; i++) {
+        unsigned int c = coverage[i];
+        unsigned int inverse = inverse_alpha(blit, c);
+
+        unsigned int p = pixels[i];
+        unsigned int r = p >> 11, g = (p >> 5) & 0x3f, b = p & 0x1f;
+        r = (r << 3) | (r >> 2);
+        g = (g << 2) | (g >> 4);
+        b = (b << 3) | (b >> 2);
+
+        r = blend_channel(blit->red, r, c, inverse);
+        g = blend_channel(blit->green, g, c, inverse);
+        b = blend_channel(blit->blue, b, c, inverse);
+
+        pixels[i] = (div255(r * 31) << 11) | (div255(g * 63) << 5) | div255(b * 31);
+    }
+}
+
+static void blend_row_rgb888(const ttr_blit_t* blit, uint8_t* row, unsigned int x, const uint8_t* coverage, unsigned int len) {
+    uint8_t* pixels = row + x * 3;
+
+    for (unsigned int i = 0; i < len; i++, pixels += 3) {
+        unsigned int c = coverage[i];
+        unsigned int inverse = inverse_alpha(blit, c);
+
+        pixels[0] = blend_channel(blit->red, pixels[0], c, inverse);
+        pixels[1] = blend_channel(blit->green, pixels[1], c, inverse);
+        pixels[2] = blend_channel(blit->blue, pixels[2], c, inverse);
+    }
+}
+
+static void blend_row_rgba8888_scalar(const ttr_blit_t* blit, uint8_t* row, unsigned int x, const uint8_t* coverage, unsigned int len) {
+    uint8_t* pixels = row + x * 4;
+
+    for (unsigned int i = 0; i < len; i++, pixels += 4) {
+        unsigned int c = coverage[i];
+        unsigned int inverse = inverse_alpha(blit, c);
+
+        pixels[0] = blend_channel(blit->red, pixels[0], c, inverse);
+        pixels[1] = blend_channel(blit->green, pixels[1], c, inverse);
+        pixels[2] = blend_channel(blit->blue, pixels[2], c, inverse);
+        pixels[3] = blend_channel(blit->alpha, pixels[3], c, inverse);
+    }
+}
+
+static void blend_row_mono1(const ttr_blit_t* blit, uint8_t* row, unsigned int x, const uint8_t* coverage, unsigned int len) {
+    bool ink = blit->luminance >= 128;
+
+    for (unsigned int i = 0; i < len; i++) {
+        if (div255(blit->alpha * coverage[i]) < 128) {
+            continue;
+        }
+
+        unsigned int column = x + i;
+        uint8_t mask = 0x80 >> (column & 7);
+        if (ink) {
+            row[column >> 3] |= mask;
+        } else {
+            row[column >> 3] &= ~mask;
+        }
+    }
+}
+
+static void blend_row_gray4(const ttr_blit_t* blit, uint8_t* row, unsigned int x, const uint8_t* coverage, unsigned int len) {
+    unsigned int gray = div255(blit->luminance * blit->alpha);
+
+    for (unsigned int i = 0; i < len; i++) {
+        unsigned int c = coverage[i];
+        unsigned int column = x + i;
+        unsigned int shift = column & 1 ? 0 : 4;
+        uint8_t* byte = &row[column >> 1];
+
+        unsigned int value = ((*byte >> shift) & 0xf) * 17;
+        value = div255(blend_channel(gray, value, c, inverse_alpha(blit, c)) * 15);
+
+        *byte = (*byte & ~(0xf << shift)) | (value << shift);
+    }
+}
+
+#if TTR_BLIT_SSE2
+static inline __m128i div255_sse2(__m128i x) {
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+static inline __m128i blend_channel_sse2(__m128i src, __m128i dst, __m128i coverage, __m128i inverse) {
+    return _mm_add_epi16(div255_sse2(_mm_mullo_epi16(src, coverage)), div255_sse2(_mm_mullo_epi16(dst, inverse)));
+}
+
+static void blend_row_rgb565_sse2(const ttr_blit_t* blit, uint8_t* row, unsigned int x, const uint8_t* coverage, unsigned int len) {
+    uint16_t* pixels = (uint16_t*)row + x;
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i red = _mm_set1_epi16(blit->red);
+    const __m128i green = _mm_set1_epi16(blit->green);
+    const __m128i blue = _mm_set1_epi16(blit->blue);
+    const __m128i alpha = _mm_set1_epi16(blit->alpha);
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    const __m128i mask6 = _mm_set1_epi16(0x3f);
+
+    unsigned int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(coverage + i)), zero);
+        __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), div255_sse2(_mm_mullo_epi16(alpha, c)));
+
+        __m128i p = _mm_loadu_si128((const __m128i*)(pixels + i));
+        __m128i r = _mm_srli_epi16(p, 11);
+        __m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mask6);
+        __m128i b = _mm_and_si128(p, mask5);
+        r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+        g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+        b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+        r = blend_channel_sse2(red, r, c, inverse);
+        g = blend_channel_sse2(green, g, c, inverse);
+        b = blend_channel_sse2(blue, b, c, inverse);
+
+        // The masks double as the largest value of each channel.
+        r = _mm_slli_epi16(div255_sse2(_mm_mullo_epi16(r, mask5)), 11);
+        g = _mm_slli_epi16(div255_sse2(_mm_mullo_epi16(g, mask6)), 5);
+        b = div255_sse2(_mm_mullo_epi16(b, mask5));
+        _mm_storeu_si128((__m128i*)(pixels + i), _mm_or_si128(_mm_or_si128(r, g), b));
+    }
+
+    blend_row_rgb565_scalar(blit, row, x + i, coverage + i, len - i);
+}
+
+static void blend_row_rgba8888_sse2(const ttr_blit_t* blit, uint8_t* row, unsigned int x, const uint8_t* coverage, unsigned int len) {
+    uint8_t* pixels = row + x * 4;
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i color = _mm_setr_epi16(blit->red, blit->green, blit->blue, blit->alpha, blit->red, blit->green, blit->blue, blit->alpha);
+    const __m128i alpha = _mm_set1_epi16(blit->alpha);
+
+    unsigned int i = 0;
+    for (; i + 4 <= len; i += 4) {
+        uint32_t four;
+        memcpy(&four, coverage + i, 4);
+
+        // Coverage of each pixel repeated for its four channels.
+        __m128i c = _mm_unpacklo_epi8(_mm_cvtsi32_si128(four), zero);
+        c = _mm_unpacklo_epi16(c, c);
+        __m128i c_lo = _mm_unpacklo_epi32(c, c);
+        __m128i c_hi = _mm_unpackhi_epi32(c, c);
+        __m128i inverse_lo = _mm_sub_epi16(_mm_set1_epi16(255), div255_sse2(_mm_mullo_epi16(alpha, c_lo)));
+        __m128i inverse_hi = _mm_sub_epi16(_mm_set1_epi16(255), div255_sse2(_mm_mullo_epi16(alpha, c_hi)));
+
+        __m128i p = _mm_loadu_si128((const __m128i*)(pixels + i * 4));
+        __m128i lo = blend_channel_sse2(color, _mm_unpacklo_epi8(p, zero), c_lo, inverse_lo);
+        __m128i hi = blend_channel_sse2(color, _mm_unpackhi_epi8(p, zero), c_hi, inverse_hi);
+        _mm_storeu_si128((__m128i*)(pixels + i * 4), _mm_packus_epi16(lo, hi));
+    }
+
+    blend_row_rgba8888_scalar(blit, row, x + i, coverage + i, len - i);
+}
+#endif
+
+#if TTR_BLIT_NEON
+static inline uint16x8_t div255_neon(uint16x8_t x) {
+    x = vaddq_u16(x, vdupq_n_u16(128));
+    return vshrq_n_u16(vsraq_n_u16(x, x, 8), 8);
+}
+
+static inline uint16x8_t blend_channel_neon(uint16x8_t src, uint16x8_t dst, uint16x8_t coverage, uint16x8_t inverse) {
+    return vaddq_u16(div255_neon(vmulq_u16(src, coverage)), div255_neon(vmulq_u16(dst, inverse)));
+}
+
+static void blend_row_rgb565_neon(const ttr_blit_t* blit, uint8_t* row, unsigned int x, const uint8_t* coverage, unsigned int len) {
+    uint16_t* pixels = (uint16_t*)row + x;
+
+    const uint16x8_t red = vdupq_n_u16(blit->red);
+    const uint16x8_t green = vdupq_n_u16(blit->green);
+    const uint16x8_t blue = vdupq_n_u16(blit->blue);
+    const uint16x8_t alpha = vdupq_n_u16(blit->alpha);
+    const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+    const uint16x8_t mask6 = vdupq_n_u16(0x3f);
+
+    unsigned int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint16x8_t c = vmovl_u8(vld1_u8(coverage + i));
+        uint16x8_t inverse = vsubq_u16(vdupq_n_u16(255), div255_neon(vmulq_u16(alpha, c)));
+
+        uint16x8_t p = vld1q_u16(pixels + i);
+        uint16x8_t r = vshrq_n_u16(p, 11);
+        uint16x8_t g = vandq_u16(vshrq_n_u16(p, 5), mask6);
+        uint16x8_t b = vandq_u16(p, mask5);
+        r = vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2));
+        g = vorrq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(g, 4));
+        b = vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2));
+
+        r = blend_channel_neon(red, r, c, inverse);
+        g = blend_channel_neon(green, g, c, inverse);
+        b = blend_channel_neon(blue, b, c, inverse);
+
+        // The masks double as the largest value of each channel.
+        r = vshlq_n_u16(div255_neon(vmulq_u16(r, mask5)), 11);
+        g = vshlq_n_u16(div255_neon(vmulq_u16(g, mask6)), 5);
+        b = div255_neon(vmulq_u16(b, mask5));
+        vst1q_u16(pixels + i, vorrq_u16(vorrq_u16(r, g), b));
+    }
+
+    blend_row_rgb565_scalar(blit, row, x + i, coverage + i, len - i);
+}
+
+static void blend_row_rgba8888_neon(const ttr_blit_t* blit, uint8_t* row, unsigned int x, const uint8_t* coverage, unsigned int len) {
+    uint8_t* pixels = row + x * 4;
+
+    const uint16x8_t red = vdupq_n_u16(blit->red);
+    const uint16x8_t green = vdupq_n_u16(blit->green);
+    const uint16x8_t blue = vdupq_n_u16(blit->blue);
+    const uint16x8_t alpha = vdupq_n_u16(blit->alpha);
+
+    unsigned int i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint16x8_t c = vmovl_u8(vld1_u8(coverage + i));
+        uint16x8_t inverse = vsubq_u16(vdupq_n_u16(255), div255_neon(vmulq_u16(alpha, c)));
+
+        uint8x8x4_t p = vld4_u8(pixels + i * 4);
+        p.val[0] = vmovn_u16(blend_channel_neon(red, vmovl_u8(p.val[0]), c, inverse));
+        p.val[1] = vmovn_u16(blend_channel_neon(green, vmovl_u8(p.val[1]), c, inverse));
+        p.val[2] = vmovn_u16(blend_channel_neon(blue, vmovl_u8(p.val[2]), c, inverse));
+        p.val[3] = vmovn_u16(blend_channel_neon(alpha, vmovl_u8(p.val[3]), c, inverse));
+        vst4_u8(pixels + i * 4, p);
+    }
+
+    blend_row_rgba8888_scalar(blit, row, x + i, coverage + i, len - i);
+}
+#endif
+
+int ttr_blit_init(ttr_blit_t* blit, const ttr_surface_t* surface) {
+    unsigned int alpha = (surface->color >> 24) & 0xff;
+    unsigned int red = (surface->color >> 16) & 0xff;
+    unsigned int green = (surface->color >> 8) & 0xff;
+    unsigned int blue = surface->color & 0xff;
+
+    *blit = (ttr_blit_t) {
+        .pixels = surface->pixels,
+        .stride = surface->stride,
+        .red = div255(red * alpha),
+        .green = div255(green * alpha),
+        .blue = div255(blue * alpha),
+        .alpha = alpha,
+        .luminance = (red * 77 + green * 150 + blue * 29) >> 8
+    };
+
+    unsigned int stride;
+    switch (surface->format) {
+    case TTR_PIXEL_FORMAT_RGB565:
+#if TTR_BLIT_SSE2
+        blit->blend_row = blend_row_rgb565_sse2;
+#elif TTR_BLIT_NEON
+        blit->blend_row = blend_row_rgb565_neon;
+#else
+        blit->blend_row = blend_row_rgb565_scalar;
+#endif
+        stride = surface->width * 2;
+        break;
+    case TTR_PIXEL_FORMAT_RGB888:
+        blit->blend_row = blend_row_rgb888;
+        stride = surface->width * 3;
+        break;
+    case TTR_PIXEL_FORMAT_RGBA8888:
+#if TTR_BLIT_SSE2
+        blit->blend_row = blend_row_rgba8888_sse2;
+#elif TTR_BLIT_NEON
+        blit->blend_row = blend_row_rgba8888_neon;
+#else
+        blit->blend_row = blend_row_rgba8888_scalar;
+#endif
+        stride = surface->width * 4;
+        break;
+    case TTR_PIXEL_FORMAT_MONO1:
+        blit->blend_row = blend_row_mono1;
+        stride = (surface->width + 7) / 8;
+        break;
+    case TTR_PIXEL_FORMAT_GRAY4:
+        blit->blend_row = blend_row_gray4;
+        stride = (surface->width + 1) / 2;
+        break;
+    default:
+        return -1;
+    }
+
+    if (blit->stride == 0) {
+        blit->stride = stride;
+    }
+
+    return 0;
+}
+
+void ttr_blit_span(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data) {
+    const ttr_blit_t* blit = (const ttr_blit_t*)user_data;
+
+    blit->blend_row(blit, &blit->pixels[(size_t)y * blit->stride], x_start, coverage, len);
+}
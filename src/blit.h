@@ -0,0 +1,53 @@
+#ifndef TTR_BLIT_H
+#define TTR_BLIT_H 1
+
+#include <stdint.h>
+
+#include "tiny_text_renderer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ttr_blit_t ttr_blit_t;
+
+/**
+ * State for blending spans of coverage on a surface, with the color already converted for its format.
+ */
+struct ttr_blit_t {
+    uint8_t* pixels;
+    unsigned int stride;
+
+    // Color premultiplied by its alpha.
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t alpha;
+    // Luminance of the color, not premultiplied, for gray formats.
+    uint8_t luminance;
+
+    void (*blend_row)(const ttr_blit_t* blit, uint8_t* row, unsigned int x, const uint8_t* coverage, unsigned int len);
+};
+
+/**
+ * Prepare blending on a surface.
+ *
+ * @param blit The state to initialize.
+ * @param surface The surface to blend on.
+ * @return 0 on success, -1 if the pixel format is not supported.
+ */
+int ttr_blit_init(ttr_blit_t* blit, const ttr_surface_t* surface);
+
+/**
+ * Span callback blending a span of coverage on the surface of the `ttr_blit_t` passed as user data.
+ *
+ * Rows are blended with SSE2 or NEON when available, chosen at compile time, for the RGB565 and RGBA8888 formats.
+ * All variants produce exactly the same output. Define `TTR_NO_SIMD` to always use the scalar variant.
+ */
+void ttr_blit_span(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_BLIT_H */
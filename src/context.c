@@ -0,0 +1,45 @@
+#include "context.h"
+#include "glyph.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+ttr_context_t* ttr_create_context(void) {
+    ttr_context_t* ctx = calloc(1, sizeof(ttr_context_t));
+    if (!ctx) {
+        return NULL;
+    }
+
+    if (sft_init_outline(&ctx->outline) != 0) {
+        sft_free_outline(&ctx->outline);
+        free(ctx);
+        return NULL;
+    }
+
+    ctx->draw_funcs = ttr_create_draw_funcs();
+    ctx->run.buffer = hb_buffer_create();
+
+    return ctx;
+}
+
+void ttr_destroy_context(ttr_context_t* ctx) {
+    if (!ctx) {
+        return;
+    }
+
+    free(ctx->run.glyph_extents);
+    hb_buffer_destroy(ctx->run.buffer);
+
+    for (unsigned int i = 0; i < ctx->chain_run_capacity; i++) {
+        free(ctx->chain_runs[i].glyph_extents);
+        hb_buffer_destroy(ctx->chain_runs[i].buffer);
+    }
+    free(ctx->chain_runs);
+    free(ctx->glyph_bitmap);
+
+    sft_free_scratch(&ctx->scratch);
+    sft_free_outline(&ctx->outline);
+    hb_draw_funcs_destroy(ctx->draw_funcs);
+
+    free(ctx);
+}
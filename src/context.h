@@ -0,0 +1,35 @@
+#ifndef TTR_CONTEXT_H
+#define TTR_CONTEXT_H 1
+
+#include <hb.h>
+
+#include "tiny_text_renderer.h"
+#include "run.h"
+#include "schrift.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ttr_context_t {
+    hb_draw_funcs_t* draw_funcs;
+    SFT_Outline outline;
+    SFT_Scratch scratch;
+
+    // Run used by the methods taking text, shaped again on each call.
+    ttr_run_t run;
+
+    // Runs used by the methods taking a font chain, one for each font change in the text.
+    ttr_run_t* chain_runs;
+    unsigned int chain_run_capacity;
+
+    // Coverage of the last glyph rasterized by `ttr_run_glyphs_next`.
+    uint8_t* glyph_bitmap;
+    size_t glyph_bitmap_capacity;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_CONTEXT_H */
@@ -0,0 +1,170 @@
+#include "coverage.h"
+
+#include <math.h>
+
+// Note: This file must be built without floating-point contraction (-ffp-contract=off), otherwise the compiler is free
+// to fuse the multiply and add of the scalar variant, which would then no longer match the vector variants exactly.
+
+#if !defined(TTR_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__))
+#define TTR_COVERAGE_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) && !defined(__AVX2__)
+#define TTR_COVERAGE_AVX2_RUNTIME 1
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define TTR_COVERAGE_AVX2 1
+#include <immintrin.h>
+#endif
+#elif !defined(TTR_NO_SIMD) && defined(__ARM_NEON)
+#define TTR_COVERAGE_NEON 1
+#include <arm_neon.h>
+#endif
+
+static inline uint8_t coverage_from_area(float area) {
+    float value = fabsf(area);
+    value = value < 1.0f ? value : 1.0f;
+    value = value * 255.0f + 0.5f;
+    return (uint8_t)value;
+}
+
+void ttr_coverage_from_area_scalar(const float* area, uint8_t* coverage, unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        coverage[i] = coverage_from_area(area[i]);
+    }
+}
+
+#if TTR_COVERAGE_SSE2
+static inline __m128i coverage_from_area_sse2(__m128 area) {
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    __m128 value = _mm_and_ps(area, abs_mask);
+    // Returns the second operand for NaN, same as the scalar comparison.
+    value = _mm_min_ps(value, _mm_set1_ps(1.0f));
+    value = _mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+    return _mm_cvttps_epi32(value);
+}
+
+static void ttr_coverage_from_area_sse2(const float* area, uint8_t* coverage, unsigned int count) {
+    unsigned int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = coverage_from_area_sse2(_mm_loadu_ps(area + i));
+        __m128i b = coverage_from_area_sse2(_mm_loadu_ps(area + i + 4));
+        __m128i c = coverage_from_area_sse2(_mm_loadu_ps(area + i + 8));
+        __m128i d = coverage_from_area_sse2(_mm_loadu_ps(area + i + 12));
+
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128((__m128i*)(coverage + i), packed);
+    }
+
+    ttr_coverage_from_area_scalar(area + i, coverage + i, count - i);
+}
+#endif
+
+#if TTR_COVERAGE_AVX2 || TTR_COVERAGE_AVX2_RUNTIME
+#if TTR_COVERAGE_AVX2_RUNTIME
+#define TTR_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TTR_TARGET_AVX2
+#endif
+
+static inline TTR_TARGET_AVX2 __m256i coverage_from_area_avx2(__m256 area) {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+    __m256 value = _mm256_and_ps(area, abs_mask);
+    value = _mm256_min_ps(value, _mm256_set1_ps(1.0f));
+    value = _mm256_add_ps(_mm256_mul_ps(value, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f));
+    return _mm256_cvttps_epi32(value);
+}
+
+static TTR_TARGET_AVX2 void ttr_coverage_from_area_avx2(const float* area, uint8_t* coverage, unsigned int count) {
+    // Packing works within 128-bit lanes, this puts the 32-bit groups of bytes back in order.
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    unsigned int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = coverage_from_area_avx2(_mm256_loadu_ps(area + i));
+        __m256i b = coverage_from_area_avx2(_mm256_loadu_ps(area + i + 8));
+        __m256i c = coverage_from_area_avx2(_mm256_loadu_ps(area + i + 16));
+        __m256i d = coverage_from_area_avx2(_mm256_loadu_ps(area + i + 24));
+
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        packed = _mm256_permutevar8x32_epi32(packed, order);
+        _mm256_storeu_si256((__m256i*)(coverage + i), packed);
+    }
+
+    ttr_coverage_from_area_sse2(area + i, coverage + i, count - i);
+}
+#endif
+
+#if TTR_COVERAGE_NEON
+static inline uint32x4_t coverage_from_area_neon(float32x4_t area) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+
+    float32x4_t value = vabsq_f32(area);
+    value = vbslq_f32(vcltq_f32(value, one), value, one);
+    value = vaddq_f32(vmulq_f32(value, vdupq_n_f32(255.0f)), vdupq_n_f32(0.5f));
+    return vcvtq_u32_f32(value);
+}
+
+static void ttr_coverage_from_area_neon(const float* area, uint8_t* coverage, unsigned int count) {
+    unsigned int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint32x4_t a = coverage_from_area_neon(vld1q_f32(area + i));
+        uint32x4_t b = coverage_from_area_neon(vld1q_f32(area + i + 4));
+
+        uint16x8_t narrow = vcombine_u16(vmovn_u32(a), vmovn_u32(b));
+        vst1_u8(coverage + i, vmovn_u16(narrow));
+    }
+
+    ttr_coverage_from_area_scalar(area + i, coverage + i, count - i);
+}
+#endif
+
+#if TTR_COVERAGE_AVX2_RUNTIME
+static void ttr_coverage_from_area_detect(const float* area, uint8_t* coverage, unsigned int count);
+
+static void (*coverage_from_area_impl)(const float* area, uint8_t* coverage, unsigned int count) = ttr_coverage_from_area_detect;
+
+static void ttr_coverage_from_area_detect(const float* area, uint8_t* coverage, unsigned int count) {
+    __builtin_cpu_init();
+    void (*impl)(const float* area, uint8_t* coverage, unsigned int count) = __builtin_cpu_supports("avx2") ? ttr_coverage_from_area_avx2 : ttr_coverage_from_area_sse2;
+    // Threads detecting at the same time all store the same value.
+    __atomic_store_n(&coverage_from_area_impl, impl, __ATOMIC_RELAXED);
+    impl(area, coverage, count);
+}
+#endif
+
+unsigned int ttr_coverage_get_kernels(ttr_coverage_kernel_t* kernels) {
+    unsigned int count = 0;
+#if TTR_COVERAGE_SSE2
+    kernels[count++] = (ttr_coverage_kernel_t) { "sse2", ttr_coverage_from_area_sse2 };
+#endif
+#if TTR_COVERAGE_AVX2_RUNTIME
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels[count++] = (ttr_coverage_kernel_t) { "avx2", ttr_coverage_from_area_avx2 };
+    }
+#elif TTR_COVERAGE_AVX2
+    kernels[count++] = (ttr_coverage_kernel_t) { "avx2", ttr_coverage_from_area_avx2 };
+#endif
+#if TTR_COVERAGE_NEON
+    kernels[count++] = (ttr_coverage_kernel_t) { "neon", ttr_coverage_from_area_neon };
+#endif
+    // What `ttr_coverage_from_area` dispatches to, whichever variant that is.
+    kernels[count++] = (ttr_coverage_kernel_t) { "dispatch", ttr_coverage_from_area };
+    return count;
+}
+
+void ttr_coverage_from_area(const float* area, uint8_t* coverage, unsigned int count) {
+#if TTR_COVERAGE_AVX2_RUNTIME
+    __atomic_load_n(&coverage_from_area_impl, __ATOMIC_RELAXED)(area, coverage, count);
+#elif TTR_COVERAGE_AVX2
+    ttr_coverage_from_area_avx2(area, coverage, count);
+#elif TTR_COVERAGE_SSE2
+    ttr_coverage_from_area_sse2(area, coverage, count);
+#elif TTR_COVERAGE_NEON
+    ttr_coverage_from_area_neon(area, coverage, count);
+#else
+    ttr_coverage_from_area_scalar(area, coverage, count);
+#endif
+}
@@ -0,0 +1,48 @@
+#ifndef TTR_COVERAGE_H
+#define TTR_COVERAGE_H 1
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Convert a row of accumulated signed area to 8-bit coverage, `min(|area|, 1) * 255` rounded to nearest.
+ *
+ * Uses the widest vector instructions available, chosen at compile time (SSE2, NEON) or at runtime (AVX2).
+ * All variants produce exactly the same output as `ttr_coverage_from_area_scalar`.
+ * Define `TTR_NO_SIMD` to always use the scalar variant.
+ *
+ * @param area Accumulated area for each pixel of the row.
+ * @param coverage Output buffer for the coverage of each pixel.
+ * @param count Number of pixels in the row.
+ */
+void ttr_coverage_from_area(const float* area, uint8_t* coverage, unsigned int count);
+
+/**
+ * Scalar reference variant of `ttr_coverage_from_area`.
+ */
+void ttr_coverage_from_area_scalar(const float* area, uint8_t* coverage, unsigned int count);
+
+/**
+ * A variant of `ttr_coverage_from_area`.
+ */
+typedef struct ttr_coverage_kernel_t {
+    const char* name;
+    void (*convert)(const float* area, uint8_t* coverage, unsigned int count);
+} ttr_coverage_kernel_t;
+
+/**
+ * Get the vector variants compiled in and supported by the CPU, for testing them against the scalar variant.
+ *
+ * @param kernels Out param for the variants, room for at least 4.
+ * @return Number of variants written to `kernels`.
+ */
+unsigned int ttr_coverage_get_kernels(ttr_coverage_kernel_t* kernels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_COVERAGE_H */
@@ -0,0 +1,131 @@
+#include "tiny_text_renderer.h"
+#include "face.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TTR_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef TTR_HAVE_MMAP
+typedef struct mapped_file {
+    void* data;
+    size_t size;
+} mapped_file;
+
+static void ttr_unmap_file(void* user_data) {
+    mapped_file* file = (mapped_file*)user_data;
+    munmap(file->data, file->size);
+    free(file);
+}
+
+// Map the file read-only, so that only the tables HarfBuzz touches are paged in, and pages are shared between
+// processes using the same font.
+static hb_blob_t* ttr_create_blob_for_file(const char* file_name) {
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || (unsigned long long)st.st_size > UINT32_MAX) {
+        close(fd);
+        return NULL;
+    }
+
+    mapped_file* file = malloc(sizeof(mapped_file));
+    if (!file) {
+        close(fd);
+        return NULL;
+    }
+    file->size = st.st_size;
+    file->data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file->data == MAP_FAILED) {
+        free(file);
+        return NULL;
+    }
+
+    return hb_blob_create_or_fail((const char*)file->data, file->size, HB_MEMORY_MODE_READONLY_MAY_MAKE_WRITABLE, file, ttr_unmap_file);
+}
+#else
+// Read the whole file on targets without mmap.
+static hb_blob_t* ttr_create_blob_for_file(const char* file_name) {
+    FILE* file = fopen(file_name, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+    }
+    if (size <= 0 || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    char* data = malloc(size);
+    if (!data) {
+        fclose(file);
+        return NULL;
+    }
+
+    size_t bytes_read = fread(data, 1, size, file);
+    fclose(file);
+    if (bytes_read != (size_t)size) {
+        free(data);
+        return NULL;
+    }
+
+    return hb_blob_create_or_fail(data, size, HB_MEMORY_MODE_WRITABLE, data, free);
+}
+#endif
+
+hb_face_t* ttr_open_face_file(const char* file_name, unsigned int index) {
+    hb_blob_t* blob = ttr_create_blob_for_file(file_name);
+    if (!blob) {
+        return NULL;
+    }
+
+    hb_face_t* face = hb_face_create(blob, index);
+    hb_blob_destroy(blob);
+
+    // HarfBuzz returns an empty face for data that isn't a font.
+    if (hb_face_get_glyph_count(face) == 0) {
+        hb_face_destroy(face);
+        return NULL;
+    }
+
+    return face;
+}
+
+void ttr_destroy_face(hb_face_t* face) {
+    hb_face_destroy(face);
+}
+
+static hb_user_data_key_t face_id_key;
+static uintptr_t last_face_id;
+
+uintptr_t ttr_face_get_id(hb_face_t* face) {
+    uintptr_t id = (uintptr_t)hb_face_get_user_data(face, &face_id_key);
+    if (id != 0) {
+        return id;
+    }
+
+    id = __atomic_add_fetch(&last_face_id, 1, __ATOMIC_RELAXED);
+    if (hb_face_set_user_data(face, &face_id_key, (void*)id, NULL, false)) {
+        return id;
+    }
+
+    // Another thread gave the face an id meanwhile, or there is no room for it.
+    return (uintptr_t)hb_face_get_user_data(face, &face_id_key);
+}
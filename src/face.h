@@ -0,0 +1,26 @@
+#ifndef TTR_FACE_H
+#define TTR_FACE_H 1
+
+#include <stdint.h>
+#include <hb.h>
+
+#include "tiny_text_renderer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Get an id telling a face apart from any other face created by the process, including faces created later at the
+ * address of this one once it is destroyed, for keying caches that outlive the faces they hold glyphs of.
+ *
+ * @param face The face.
+ * @return The id of the face, or 0 if it couldn't be given one, such as for the empty face.
+ */
+uintptr_t ttr_face_get_id(hb_face_t* face);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_FACE_H */
@@ -0,0 +1,247 @@
+#include "font_chain.h"
+#include "context.h"
+#include "scale.h"
+#include "utf8.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define max(a, b) ({ \
+    typeof(a) _a = (a); \
+    typeof(b) _b = (b); \
+    _a > _b ? _a : _b; \
+})
+
+#define min(a, b) ({ \
+    typeof(a) _a = (a); \
+    typeof(b) _b = (b); \
+    _a < _b ? _a : _b; \
+})
+
+// Add a block with all codepoints mapped to `font`.
+static int ttr_font_chain_add_block(ttr_font_chain_t* chain, unsigned int font) {
+    if (chain->block_count == chain->block_capacity) {
+        unsigned int capacity = max(chain->block_capacity * 2, 16u);
+        uint8_t (*blocks)[TTR_FONT_CHAIN_PAGE_SIZE] = realloc(chain->blocks, capacity * sizeof(*blocks));
+        if (!blocks) {
+            return -1;
+        }
+        chain->blocks = blocks;
+        chain->block_capacity = capacity;
+    }
+
+    memset(chain->blocks[chain->block_count], font, TTR_FONT_CHAIN_PAGE_SIZE);
+    return chain->block_count++;
+}
+
+// Map the codepoints of a font that no earlier font maps to it.
+static int ttr_font_chain_add_font(ttr_font_chain_t* chain, unsigned int font, hb_set_t* codepoints) {
+    // Block mapping whole pages to this font, added on the first page it covers entirely.
+    int full_block = -1;
+
+    hb_codepoint_t first, last = HB_SET_VALUE_INVALID;
+    while (hb_set_next_range(codepoints, &first, &last)) {
+        if (first >= 0x110000) {
+            break;
+        }
+        last = min(last, 0x10ffffu);
+
+        for (unsigned int page = first >> TTR_FONT_CHAIN_PAGE_BITS; page <= last >> TTR_FONT_CHAIN_PAGE_BITS; page++) {
+            unsigned int page_first = page << TTR_FONT_CHAIN_PAGE_BITS;
+            unsigned int start = max(first, page_first) - page_first;
+            unsigned int end = min(last, page_first + TTR_FONT_CHAIN_PAGE_SIZE - 1) - page_first + 1;
+
+            if (chain->pages[page] == 0) {
+                // Ranges of the set don't overlap, so a block of this font is never visited twice.
+                if (start == 0 && end == TTR_FONT_CHAIN_PAGE_SIZE) {
+                    if (full_block < 0 && (full_block = ttr_font_chain_add_block(chain, font)) < 0) {
+                        return -1;
+                    }
+                    chain->pages[page] = full_block;
+                    continue;
+                }
+
+                int block = ttr_font_chain_add_block(chain, TTR_FONT_CHAIN_NONE);
+                if (block < 0) {
+                    return -1;
+                }
+                chain->pages[page] = block;
+            }
+
+            // Blocks of earlier fonts covering whole pages have no unmapped codepoint left, and are left as is.
+            uint8_t* entries = chain->blocks[chain->pages[page]];
+            for (unsigned int i = start; i < end; i++) {
+                if (entries[i] == TTR_FONT_CHAIN_NONE) {
+                    entries[i] = font;
+                }
+            }
+        }
+
+        if (last == 0x10ffff) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+ttr_font_chain_t* ttr_create_font_chain(hb_font_t* const* fonts, unsigned int font_count) {
+    if (font_count == 0 || font_count > TTR_FONT_CHAIN_MAX_FONTS) {
+        return NULL;
+    }
+
+    ttr_font_chain_t* chain = calloc(1, sizeof(ttr_font_chain_t));
+    if (!chain) {
+        return NULL;
+    }
+
+    chain->fonts = calloc(font_count, sizeof(hb_font_t*));
+    hb_set_t* codepoints = hb_set_create();
+    if (!chain->fonts || ttr_font_chain_add_block(chain, TTR_FONT_CHAIN_NONE) != 0) {
+        hb_set_destroy(codepoints);
+        ttr_destroy_font_chain(chain);
+        return NULL;
+    }
+
+    for (unsigned int i = 0; i < font_count; i++) {
+        chain->fonts[i] = hb_font_reference(fonts[i]);
+        chain->font_count++;
+
+        hb_set_clear(codepoints);
+        hb_face_collect_unicodes(hb_font_get_face(fonts[i]), codepoints);
+        if (!hb_set_allocation_successful(codepoints) || ttr_font_chain_add_font(chain, i, codepoints) != 0) {
+            hb_set_destroy(codepoints);
+            ttr_destroy_font_chain(chain);
+            return NULL;
+        }
+    }
+
+    hb_set_destroy(codepoints);
+    return chain;
+}
+
+void ttr_destroy_font_chain(ttr_font_chain_t* chain) {
+    if (!chain) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < chain->font_count; i++) {
+        hb_font_destroy(chain->fonts[i]);
+    }
+    free(chain->fonts);
+    free(chain->blocks);
+    free(chain);
+}
+
+int ttr_font_chain_get_font_for_codepoint(const ttr_font_chain_t* chain, hb_codepoint_t codepoint) {
+    unsigned int font = ttr_font_chain_lookup(chain, codepoint);
+    return font == TTR_FONT_CHAIN_NONE ? -1 : (int)font;
+}
+
+// Combining marks, variation selectors and joiners, shaped with the character before them whatever font maps them.
+static bool ttr_continues_run(hb_codepoint_t codepoint) {
+    return (codepoint >= 0x0300 && codepoint <= 0x036f)
+        || (codepoint >= 0x1ab0 && codepoint <= 0x1aff)
+        || (codepoint >= 0x1dc0 && codepoint <= 0x1dff)
+        || (codepoint >= 0x200c && codepoint <= 0x200d)
+        || (codepoint >= 0x20d0 && codepoint <= 0x20ff)
+        || (codepoint >= 0xfe00 && codepoint <= 0xfe0f)
+        || (codepoint >= 0xfe20 && codepoint <= 0xfe2f)
+        || (codepoint >= 0xe0100 && codepoint <= 0xe01ef);
+}
+
+// Shape `length` bytes of text from `start` into the next run of the context, with the text of `text_length` bytes
+// around it as context.
+static int ttr_font_chain_shape_run(ttr_context_t* ctx, hb_font_t* font, const char* text, unsigned int text_length, unsigned int start, unsigned int length, unsigned int* run_count) {
+    if (*run_count == ctx->chain_run_capacity) {
+        unsigned int capacity = max(ctx->chain_run_capacity * 2, 4u);
+        ttr_run_t* runs = realloc(ctx->chain_runs, capacity * sizeof(ttr_run_t));
+        if (!runs) {
+            return -1;
+        }
+        ctx->chain_runs = runs;
+
+        memset(&runs[ctx->chain_run_capacity], 0, (capacity - ctx->chain_run_capacity) * sizeof(ttr_run_t));
+        for (unsigned int i = ctx->chain_run_capacity; i < capacity; i++) {
+            runs[i].buffer = hb_buffer_create();
+        }
+        ctx->chain_run_capacity = capacity;
+    }
+
+    ttr_run_t* run = &ctx->chain_runs[*run_count];
+    run->font = font;
+    if (ttr_run_shape_segment(run, text, text_length, start, length) != 0) {
+        return -1;
+    }
+
+    (*run_count)++;
+    return 0;
+}
+
+int ttr_font_chain_shape(ttr_context_t* ctx, const ttr_font_chain_t* chain, const char* text, unsigned int* run_count) {
+    *run_count = 0;
+
+    // Measured once, rather than by HarfBuzz for each run.
+    unsigned int text_length = strlen(text);
+
+    unsigned int current = TTR_FONT_CHAIN_NONE;
+    const char* run_start = text;
+
+    for (const char* next = text; *next;) {
+        hb_codepoint_t codepoint;
+        const char* after = ttr_decode_utf8(next, &codepoint);
+
+        unsigned int font = ttr_font_chain_lookup(chain, codepoint);
+        if (current != TTR_FONT_CHAIN_NONE && (font == TTR_FONT_CHAIN_NONE || ttr_continues_run(codepoint))) {
+            font = current;
+        } else if (font == TTR_FONT_CHAIN_NONE) {
+            font = 0;
+        }
+
+        if (font != current) {
+            if (current != TTR_FONT_CHAIN_NONE
+                && ttr_font_chain_shape_run(ctx, chain->fonts[current], text, text_length, run_start - text, next - run_start, run_count) != 0) {
+                return -1;
+            }
+            current = font;
+            run_start = next;
+        }
+
+        next = after;
+    }
+
+    if (current != TTR_FONT_CHAIN_NONE
+        && ttr_font_chain_shape_run(ctx, chain->fonts[current], text, text_length, run_start - text, text_length - (run_start - text), run_count) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+void ttr_font_chain_measure_runs(const ttr_run_t* runs, unsigned int run_count, unsigned int *width, unsigned int *height, unsigned int *baseline) {
+    int x_min = 0, x_max = 0;
+    int y_min = 0, y_max = 0;
+
+    int cursor_x = 0;
+    for (unsigned int i = 0; i < run_count; i++) {
+        const ttr_run_t* run = &runs[i];
+
+        x_min = min(x_min, cursor_x + run->x_min);
+        x_max = max(x_max, cursor_x + run->x_max);
+        y_min = min(y_min, run->y_min);
+        y_max = max(y_max, run->y_max);
+
+        cursor_x += ttr_run_advance(run);
+    }
+
+    if (width != NULL && height != NULL) {
+        *width = ttr_scale_down_ceil(x_max - x_min);
+        *height = ttr_scale_down_ceil(y_max - y_min);
+    }
+
+    if (baseline != NULL) {
+        *baseline = ttr_scale_down_round(y_max);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef TTR_FONT_CHAIN_H
+#define TTR_FONT_CHAIN_H 1
+
+#include <stdint.h>
+#include <hb.h>
+
+#include "tiny_text_renderer.h"
+#include "run.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Font index of codepoints no font of the chain maps.
+#define TTR_FONT_CHAIN_NONE 0xff
+#define TTR_FONT_CHAIN_MAX_FONTS 255
+
+// Codepoints are looked up by page of 256, each page pointing at a block of font indices shared between pages.
+#define TTR_FONT_CHAIN_PAGE_BITS 8
+#define TTR_FONT_CHAIN_PAGE_SIZE (1u << TTR_FONT_CHAIN_PAGE_BITS)
+#define TTR_FONT_CHAIN_PAGE_COUNT (0x110000u >> TTR_FONT_CHAIN_PAGE_BITS)
+
+struct ttr_font_chain_t {
+    hb_font_t** fonts;
+    unsigned int font_count;
+
+    // Index in `blocks` of each page of codepoints. Block 0 maps no codepoint, and each font has a block mapping
+    // all codepoints to it, used for the pages it covers entirely before any earlier font.
+    uint16_t pages[TTR_FONT_CHAIN_PAGE_COUNT];
+    uint8_t (*blocks)[TTR_FONT_CHAIN_PAGE_SIZE];
+    unsigned int block_count;
+    unsigned int block_capacity;
+};
+
+/**
+ * Index of the first font of the chain mapping a codepoint.
+ *
+ * @return The index, or `TTR_FONT_CHAIN_NONE` if no font maps it.
+ */
+static inline unsigned int ttr_font_chain_lookup(const ttr_font_chain_t* chain, hb_codepoint_t codepoint) {
+    if (codepoint >= 0x110000) {
+        return TTR_FONT_CHAIN_NONE;
+    }
+    return chain->blocks[chain->pages[codepoint >> TTR_FONT_CHAIN_PAGE_BITS]][codepoint & (TTR_FONT_CHAIN_PAGE_SIZE - 1)];
+}
+
+/**
+ * Split text into runs of the font of the chain mapping their characters, and shape each one with its font into
+ * `chain_runs` of the context, valid until the next call. Runs are in the order of the text.
+ *
+ * @param text Null-terminated utf-8 text to shape.
+ * @param run_count Set to the number of runs shaped.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int ttr_font_chain_shape(ttr_context_t* ctx, const ttr_font_chain_t* chain, const char* text, unsigned int* run_count);
+
+/**
+ * Measure runs shaped by `ttr_font_chain_shape` placed one after the other, like `ttr_run_measure`.
+ */
+void ttr_font_chain_measure_runs(const ttr_run_t* runs, unsigned int run_count, unsigned int *width, unsigned int *height, unsigned int *baseline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_FONT_CHAIN_H */
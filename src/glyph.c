@@ -1,9 +1,21 @@
 #include "glyph.h"
+#include "context.h"
+#include "outline_cache.h"
 #include "scale.h"
 #include "schrift.h"
+#include "stats.h"
 
+#include <limits.h>
 #include <stddef.h>
 
+// HarfBuzz hands outlines over in font scale, which is 26.6 fixed point.
+#ifdef TTR_FIXED_POINT
+#define TTR_FIXED_FROM_SCALED (SFT_FIXED_ONE / 64)
+#define ttr_outline_coord(value) ttr_round_float((value) * TTR_FIXED_FROM_SCALED)
+#else
+#define ttr_outline_coord(value) ttr_scale_down_float(value)
+#endif
+
 static void sft_move_to(
     hb_draw_funcs_t *dfuncs,
     void *draw_data,
@@ -14,7 +26,7 @@ static void sft_move_to(
 ) {
     SFT_Outline* outline = (SFT_Outline*)draw_data;
 
-    sft_add_point(outline, ttr_scale_down_float(to_x), ttr_scale_down_float(to_y));
+    sft_add_point(outline, ttr_outline_coord(to_x), ttr_outline_coord(to_y));
 }
 
 static void sft_line_to(
@@ -27,7 +39,7 @@ static void sft_line_to(
 ) {
     SFT_Outline* outline = (SFT_Outline*)draw_data;
 
-    sft_add_point(outline, ttr_scale_down_float(to_x), ttr_scale_down_float(to_y));
+    sft_add_point(outline, ttr_outline_coord(to_x), ttr_outline_coord(to_y));
     sft_add_line(outline, outline->numPoints - 2, outline->numPoints - 1);
 }
 
@@ -43,8 +55,8 @@ static void sft_quadratic_to(
 ) {
     SFT_Outline* outline = (SFT_Outline*)draw_data;
 
-    sft_add_point(outline, ttr_scale_down_float(control_x), ttr_scale_down_float(control_y));
-    sft_add_point(outline, ttr_scale_down_float(to_x), ttr_scale_down_float(to_y));
+    sft_add_point(outline, ttr_outline_coord(control_x), ttr_outline_coord(control_y));
+    sft_add_point(outline, ttr_outline_coord(to_x), ttr_outline_coord(to_y));
     sft_add_curve(outline, outline->numPoints - 3, outline->numPoints - 2, outline->numPoints - 1);
 }
 
@@ -60,7 +72,12 @@ static void sft_cubic_to(
     float to_y,
     void *user_data
 ) {
-    // Not implemented
+    SFT_Outline* outline = (SFT_Outline*)draw_data;
+
+    sft_add_point(outline, ttr_outline_coord(control1_x), ttr_outline_coord(control1_y));
+    sft_add_point(outline, ttr_outline_coord(control2_x), ttr_outline_coord(control2_y));
+    sft_add_point(outline, ttr_outline_coord(to_x), ttr_outline_coord(to_y));
+    sft_add_cubic(outline, outline->numPoints - 4, outline->numPoints - 3, outline->numPoints - 2, outline->numPoints - 1);
 }
 
 static void sft_close_path(
@@ -72,7 +89,24 @@ static void sft_close_path(
     // Nothing to do.
 }
 
-static hb_draw_funcs_t* ttr_create_draw_funcs() {
+#ifdef TTR_ENABLE_STATS
+typedef struct timed_span_data {
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data);
+    void* user_data;
+    unsigned long long ns;
+} timed_span_data;
+
+// Times the span callback, to tell compositing apart from rasterizing.
+static void ttr_timed_draw_span(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data) {
+    timed_span_data* data = (timed_span_data*)user_data;
+
+    ttr_stats_timer(start);
+    data->draw_span(y, x_start, len, coverage, data->user_data);
+    data->ns += ttr_stats_now() - start;
+}
+#endif
+
+hb_draw_funcs_t* ttr_create_draw_funcs() {
     hb_draw_funcs_t *funcs = hb_draw_funcs_create();
 
     hb_draw_funcs_set_move_to_func(funcs, sft_move_to, NULL, NULL);
@@ -81,41 +115,168 @@ static hb_draw_funcs_t* ttr_create_draw_funcs() {
     hb_draw_funcs_set_cubic_to_func(funcs, sft_cubic_to, NULL, NULL);
     hb_draw_funcs_set_close_path_func(funcs, sft_close_path, NULL, NULL);
 
+    hb_draw_funcs_make_immutable(funcs);
+
     return funcs;
 }
 
+void ttr_glyph_bitmap_size(
+    hb_glyph_extents_t extents,
+    unsigned int offset_x,
+    unsigned int offset_y,
+    unsigned int* width,
+    unsigned int* height
+) {
+    *width = ttr_scale_down_ceil(offset_x + extents.width);
+    *height = ttr_scale_down_ceil(offset_y - extents.height);
+}
+
 int ttr_draw_glyph(
+    ttr_context_t* ctx,
     hb_font_t* font,
     hb_codepoint_t glyph,
     hb_glyph_extents_t extents,
     unsigned int offset_x,
     unsigned int offset_y,
-    void (*draw_pixel_at)(unsigned int x, unsigned int y, uint8_t mask, void* user_data),
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
     void* user_data
+) {
+    return ttr_draw_glyph_rows(ctx, font, glyph, extents, offset_x, offset_y, 0, UINT_MAX, draw_span, user_data);
+}
+
+// Rasterize rows of a glyph, handing spans to `draw_span`, or writing whole rows to `pixels` if not NULL.
+static int ttr_render_glyph_rows(
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    hb_codepoint_t glyph,
+    hb_glyph_extents_t extents,
+    unsigned int offset_x,
+    unsigned int offset_y,
+    unsigned int row_begin,
+    unsigned int row_end,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data,
+    uint8_t* pixels
 ) {
     if (extents.width == 0 || extents.height == 0) {
         // Nothing to be done
         return 0;
     }
 
-    hb_draw_funcs_t *funcs = ttr_create_draw_funcs();
+    unsigned int width, height;
+    ttr_glyph_bitmap_size(extents, offset_x, offset_y, &width, &height);
 
-    SFT_Outline outline;
-    sft_init_outline(&outline);
+    if (row_end > height) {
+        row_end = height;
+    }
+    if (row_begin >= row_end) {
+        return 0;
+    }
+
+    SFT_Outline* outline = &ctx->outline;
 
-    hb_font_draw_glyph(font, glyph, funcs , &outline);
+    ttr_stats_timer(decode_start);
+
+    int x_scale, y_scale;
+    hb_font_get_scale(font, &x_scale, &y_scale);
+
+    // Outlines from the outline cache are in the units of a font with a different scale.
+    int outline_x_scale = x_scale, outline_y_scale = y_scale;
+
+    ttr_outline_cache_t* outline_cache = ttr_font_get_outline_cache(font);
+    const SFT_Outline* cached = outline_cache ? ttr_outline_cache_get(outline_cache, ctx, font, glyph) : NULL;
+    if (cached) {
+        if (sft_copy_outline(outline, cached) != 0) {
+            return -1;
+        }
+        outline_x_scale = outline_y_scale = ttr_outline_cache_scale(outline_cache);
+    } else {
+        sft_reset_outline(outline);
+        hb_font_draw_glyph(font, glyph, ctx->draw_funcs, outline);
+    }
+
+    ttr_stats_add_time(outline_decode_ns, decode_start);
+
+#ifdef TTR_ENABLE_STATS
+    timed_span_data timed = { draw_span, user_data, 0 };
+    draw_span = ttr_timed_draw_span;
+    user_data = &timed;
+#endif
 
     SFT_Image image = {
-        .width = ttr_scale_down_ceil(offset_x + extents.width),
-        .height = ttr_scale_down_ceil(offset_y - extents.height),
+        .width = width,
+        .height = height,
+        .rowBeg = row_begin,
+        .rowEnd = row_end,
 
-        .draw_pixel_at = draw_pixel_at,
-        .user_data = user_data
+        .draw_span = draw_span,
+        .user_data = user_data,
+        .pixels = pixels
     };
-    float transform[6] = {1, 0, 0, -1, ttr_scale_down(offset_x - extents.x_bearing), ttr_scale_down(offset_y + extents.y_bearing)};
-    sft_render_outline(&outline, transform, image);
+#ifdef TTR_FIXED_POINT
+    SFT_Coord transform[6] = {
+        (SFT_Coord)((((int64_t)x_scale << 16) + outline_x_scale / 2) / outline_x_scale), 0,
+        0, -(SFT_Coord)((((int64_t)y_scale << 16) + outline_y_scale / 2) / outline_y_scale),
+        (offset_x - extents.x_bearing) * TTR_FIXED_FROM_SCALED, (offset_y + extents.y_bearing) * TTR_FIXED_FROM_SCALED};
+#else
+    SFT_Coord transform[6] = {
+        (float)x_scale / outline_x_scale, 0,
+        0, -(float)y_scale / outline_y_scale,
+        ttr_scale_down(offset_x - extents.x_bearing), ttr_scale_down(offset_y + extents.y_bearing)};
+#endif
+
+    ttr_stats_timer(rasterize_start);
+    int result = sft_render_outline(outline, transform, image, &ctx->scratch);
+    ttr_stats_add_time(rasterize_ns, rasterize_start + timed.ns);
+    ttr_stats_add(composite_ns, timed.ns);
+
+    return result;
+}
+
+int ttr_draw_glyph_rows(
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    hb_codepoint_t glyph,
+    hb_glyph_extents_t extents,
+    unsigned int offset_x,
+    unsigned int offset_y,
+    unsigned int row_begin,
+    unsigned int row_end,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data
+) {
+    return ttr_render_glyph_rows(ctx, font, glyph, extents, offset_x, offset_y, row_begin, row_end, draw_span, user_data, NULL);
+}
+
+int ttr_rasterize_glyph_rows(
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    hb_codepoint_t glyph,
+    hb_glyph_extents_t extents,
+    unsigned int offset_x,
+    unsigned int offset_y,
+    unsigned int row_begin,
+    unsigned int row_end,
+    uint8_t* pixels
+) {
+    return ttr_render_glyph_rows(ctx, font, glyph, extents, offset_x, offset_y, row_begin, row_end, NULL, NULL, pixels);
+}
 
-    sft_free_outline(&outline);
-    hb_draw_funcs_destroy(funcs);
-    return 0;
+void ttr_draw_coverage_row(
+    unsigned int y,
+    const uint8_t* coverage,
+    unsigned int width,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data
+) {
+    unsigned int x = 0;
+    for (;;) {
+        while (x < width && !coverage[x]) x++;
+        if (x >= width) break;
+
+        unsigned int start = x;
+        while (x < width && coverage[x]) x++;
+
+        draw_span(y, start, x - start, coverage + start, user_data);
+    }
 }
@@ -3,28 +3,109 @@
 
 #include <hb.h>
 
+#include "tiny_text_renderer.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Create draw funcs that collect a glyph outline into an `SFT_Outline`.
+ */
+hb_draw_funcs_t* ttr_create_draw_funcs();
+
+/**
+ * Calculate the size of the pixel box `ttr_draw_glyph` renders a glyph into.
+ *
+ * @param extents Extents of the glyph.
+ * @param offset_x Fractional part of x offset adjustment for the glyph.
+ * @param offset_y Fractional part of y offset adjustment for the glyph.
+ * @param width Out param for the width of the box in pixels.
+ * @param height Out param for the height of the box in pixels.
+ */
+void ttr_glyph_bitmap_size(
+    hb_glyph_extents_t extents,
+    unsigned int offset_x,
+    unsigned int offset_y,
+    unsigned int* width,
+    unsigned int* height
+);
+
 /**
  * Draw a glyph to a pixel buffer.
  * 
+ * @param ctx Context holding the working memory to use.
  * @param font The font to use.
  * @param glyph Glyph id to draw.
  * @param extents Extents of the glyph.
  * @param offset_x Fractional part of x offset adjustment for the glyph.
  * @param offset_y Fractional part of y offset adjustment for the glyph.
- * @param draw_pixel_at Callback to draw a pixel at a given position.
+ * @param draw_span Callback to draw a horizontal run of pixels with non-zero coverage.
  * @param user_data User data to pass to the callback.
  */
 int ttr_draw_glyph(
+    ttr_context_t* ctx,
     hb_font_t* font,
     hb_codepoint_t glyph,
     hb_glyph_extents_t extents,
     unsigned int offset_x,
     unsigned int offset_y,
-    void (*draw_pixel_at)(unsigned int x, unsigned int y, uint8_t mask, void* user_data),
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data
+);
+
+/**
+ * Like `ttr_draw_glyph`, but only rasterizing rows from `row_begin` up to `row_end` of the glyph's pixel box.
+ * Nothing is decoded when no row of the glyph is in that range.
+ *
+ * @param row_begin First row of the box to draw.
+ * @param row_end Row of the box to stop drawing at, clamped to its height.
+ */
+int ttr_draw_glyph_rows(
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    hb_codepoint_t glyph,
+    hb_glyph_extents_t extents,
+    unsigned int offset_x,
+    unsigned int offset_y,
+    unsigned int row_begin,
+    unsigned int row_end,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data
+);
+
+/**
+ * Like `ttr_draw_glyph_rows`, but writing whole rows of coverage to a buffer, pixels with zero coverage included.
+ *
+ * @param pixels Buffer of `(row_end - row_begin) * width` bytes for the rows of the box, row `row_begin` first,
+ *               with `row_end` clamped to its height and `width` as returned by `ttr_glyph_bitmap_size`.
+ */
+int ttr_rasterize_glyph_rows(
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    hb_codepoint_t glyph,
+    hb_glyph_extents_t extents,
+    unsigned int offset_x,
+    unsigned int offset_y,
+    unsigned int row_begin,
+    unsigned int row_end,
+    uint8_t* pixels
+);
+
+/**
+ * Hand over the runs of non-zero coverage of a row of stored coverage, same as the rasterizer would emit them.
+ *
+ * @param y Row of the glyph's pixel box.
+ * @param coverage Coverage of the pixels of the row.
+ * @param width Number of pixels in the row.
+ * @param draw_span Callback to draw a horizontal run of pixels with non-zero coverage.
+ * @param user_data User data to pass to the callback.
+ */
+void ttr_draw_coverage_row(
+    unsigned int y,
+    const uint8_t* coverage,
+    unsigned int width,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
     void* user_data
 );
 
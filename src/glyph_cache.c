@@ -0,0 +1,319 @@
+#include "glyph_cache.h"
+#include "face.h"
+#include "glyph.h"
+#include "mutex.h"
+#include "stats.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct glyph_cache_entry glyph_cache_entry;
+
+struct glyph_cache_entry {
+    glyph_cache_entry* hash_next;
+    glyph_cache_entry* lru_prev;
+    glyph_cache_entry* lru_next;
+
+    // Id of the face rather than its address, which a face created after it is destroyed can get.
+    uintptr_t face_id;
+    hb_codepoint_t glyph;
+    int x_scale;
+    int y_scale;
+    unsigned int offset_x;
+    unsigned int offset_y;
+
+    unsigned int width;
+    unsigned int height;
+    size_t size;
+
+    // Number of draws replaying the entry. An entry evicted meanwhile is freed by the last of them.
+    unsigned int refs;
+    bool evicted;
+
+    uint8_t coverage[];
+};
+
+struct ttr_glyph_cache_t {
+    ttr_mutex_t mutex;
+
+    size_t max_bytes;
+    size_t used_bytes;
+
+    glyph_cache_entry** buckets;
+    unsigned int bucket_mask;
+
+    // Most recently used entry first.
+    glyph_cache_entry* lru_head;
+    glyph_cache_entry* lru_tail;
+
+    unsigned long hits;
+    unsigned long misses;
+};
+
+static hb_user_data_key_t glyph_cache_key;
+
+ttr_glyph_cache_t* ttr_create_glyph_cache(size_t max_bytes) {
+    ttr_glyph_cache_t* cache = calloc(1, sizeof(ttr_glyph_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+
+    // Roughly one bucket per kilobyte of budget, which is about the size of a glyph at 24px.
+    unsigned int bucket_count = 16;
+    while (bucket_count < 65536 && bucket_count * 1024 < max_bytes) {
+        bucket_count <<= 1;
+    }
+
+    cache->buckets = calloc(bucket_count, sizeof(glyph_cache_entry*));
+    if (!cache->buckets) {
+        free(cache);
+        return NULL;
+    }
+
+    if (ttr_mutex_init(&cache->mutex) != 0) {
+        free(cache->buckets);
+        free(cache);
+        return NULL;
+    }
+
+    cache->bucket_mask = bucket_count - 1;
+    cache->max_bytes = max_bytes;
+
+    return cache;
+}
+
+void ttr_destroy_glyph_cache(ttr_glyph_cache_t* cache) {
+    if (!cache) {
+        return;
+    }
+
+    glyph_cache_entry* entry = cache->lru_head;
+    while (entry) {
+        glyph_cache_entry* next = entry->lru_next;
+        free(entry);
+        entry = next;
+    }
+
+    ttr_mutex_destroy(&cache->mutex);
+    free(cache->buckets);
+    free(cache);
+}
+
+void ttr_glyph_cache_get_stats(ttr_glyph_cache_t* cache, unsigned long* hits, unsigned long* misses) {
+    ttr_mutex_lock(&cache->mutex);
+    if (hits != NULL) {
+        *hits = cache->hits;
+    }
+    if (misses != NULL) {
+        *misses = cache->misses;
+    }
+    ttr_mutex_unlock(&cache->mutex);
+}
+
+void ttr_font_set_glyph_cache(hb_font_t* font, ttr_glyph_cache_t* cache) {
+    hb_font_set_user_data(font, &glyph_cache_key, cache, NULL, true);
+}
+
+ttr_glyph_cache_t* ttr_font_get_glyph_cache(hb_font_t* font) {
+    unsigned int coords_length;
+    hb_font_get_var_coords_normalized(font, &coords_length);
+    if (coords_length > 0) {
+        // Entries aren't keyed on variations.
+        return NULL;
+    }
+
+    return (ttr_glyph_cache_t*)hb_font_get_user_data(font, &glyph_cache_key);
+}
+
+static unsigned int glyph_cache_hash(uintptr_t face_id, hb_codepoint_t glyph, int x_scale, int y_scale, unsigned int offset_x, unsigned int offset_y) {
+    uint32_t hash = (uint32_t)face_id;
+    hash = (hash ^ glyph) * 0x9E3779B1u;
+    hash = (hash ^ (uint32_t)x_scale) * 0x9E3779B1u;
+    hash = (hash ^ (uint32_t)y_scale) * 0x9E3779B1u;
+    hash = (hash ^ (offset_x << 8) ^ offset_y) * 0x9E3779B1u;
+    return hash ^ (hash >> 16);
+}
+
+static void glyph_cache_unlink_lru(ttr_glyph_cache_t* cache, glyph_cache_entry* entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+}
+
+static void glyph_cache_push_lru(ttr_glyph_cache_t* cache, glyph_cache_entry* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = entry;
+    } else {
+        cache->lru_tail = entry;
+    }
+    cache->lru_head = entry;
+}
+
+static void glyph_cache_remove(ttr_glyph_cache_t* cache, glyph_cache_entry* entry) {
+    unsigned int bucket = glyph_cache_hash(entry->face_id, entry->glyph, entry->x_scale, entry->y_scale, entry->offset_x, entry->offset_y) & cache->bucket_mask;
+
+    glyph_cache_entry** link = &cache->buckets[bucket];
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+
+    glyph_cache_unlink_lru(cache, entry);
+
+    cache->used_bytes -= entry->size;
+    if (entry->refs > 0) {
+        entry->evicted = true;
+    } else {
+        free(entry);
+    }
+}
+
+static glyph_cache_entry* glyph_cache_find(ttr_glyph_cache_t* cache, unsigned int bucket, uintptr_t face_id, hb_codepoint_t glyph, int x_scale, int y_scale, unsigned int offset_x, unsigned int offset_y) {
+    glyph_cache_entry* entry = cache->buckets[bucket];
+    while (entry) {
+        if (entry->face_id == face_id && entry->glyph == glyph
+            && entry->x_scale == x_scale && entry->y_scale == y_scale
+            && entry->offset_x == offset_x && entry->offset_y == offset_y) {
+            break;
+        }
+        entry = entry->hash_next;
+    }
+    return entry;
+}
+
+static void glyph_cache_store_span(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data) {
+    glyph_cache_entry* entry = (glyph_cache_entry*)user_data;
+
+    memcpy(&entry->coverage[y * entry->width + x_start], coverage, len);
+}
+
+int ttr_draw_cached_glyph(
+    ttr_glyph_cache_t* cache,
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    hb_codepoint_t glyph,
+    hb_glyph_extents_t extents,
+    unsigned int offset_x,
+    unsigned int offset_y,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data
+) {
+    if (extents.width == 0 || extents.height == 0) {
+        // Nothing to be done
+        return 0;
+    }
+
+    uintptr_t face_id = ttr_face_get_id(hb_font_get_face(font));
+    if (face_id == 0) {
+        return ttr_draw_glyph(ctx, font, glyph, extents, offset_x, offset_y, draw_span, user_data);
+    }
+
+    int x_scale, y_scale;
+    hb_font_get_scale(font, &x_scale, &y_scale);
+
+    unsigned int bucket = glyph_cache_hash(face_id, glyph, x_scale, y_scale, offset_x, offset_y) & cache->bucket_mask;
+
+    ttr_mutex_lock(&cache->mutex);
+
+    glyph_cache_entry* entry = glyph_cache_find(cache, bucket, face_id, glyph, x_scale, y_scale, offset_x, offset_y);
+    if (entry) {
+        cache->hits++;
+        ttr_stats_add(glyph_cache_hits, 1);
+
+        glyph_cache_unlink_lru(cache, entry);
+        glyph_cache_push_lru(cache, entry);
+        entry->refs++;
+
+        ttr_mutex_unlock(&cache->mutex);
+    } else {
+        cache->misses++;
+        ttr_stats_add(glyph_cache_misses, 1);
+
+        ttr_mutex_unlock(&cache->mutex);
+
+        unsigned int width, height;
+        ttr_glyph_bitmap_size(extents, offset_x, offset_y, &width, &height);
+
+        size_t size = sizeof(glyph_cache_entry) + (size_t)width * height;
+        if (size > cache->max_bytes) {
+            // Would never fit, draw directly.
+            return ttr_draw_glyph(ctx, font, glyph, extents, offset_x, offset_y, draw_span, user_data);
+        }
+
+        entry = calloc(1, size);
+        if (!entry) {
+            return ttr_draw_glyph(ctx, font, glyph, extents, offset_x, offset_y, draw_span, user_data);
+        }
+
+        *entry = (glyph_cache_entry) {
+            .face_id = face_id,
+            .glyph = glyph,
+            .x_scale = x_scale,
+            .y_scale = y_scale,
+            .offset_x = offset_x,
+            .offset_y = offset_y,
+            .width = width,
+            .height = height,
+            .size = size
+        };
+
+        // Rasterize without holding the lock, so that other threads can use the cache meanwhile.
+        if (ttr_draw_glyph(ctx, font, glyph, extents, offset_x, offset_y, glyph_cache_store_span, entry) != 0) {
+            free(entry);
+            return -1;
+        }
+
+        ttr_mutex_lock(&cache->mutex);
+
+        glyph_cache_entry* existing = glyph_cache_find(cache, bucket, face_id, glyph, x_scale, y_scale, offset_x, offset_y);
+        if (existing) {
+            // Another thread cached the same glyph in the meantime.
+            free(entry);
+            entry = existing;
+
+            glyph_cache_unlink_lru(cache, entry);
+            glyph_cache_push_lru(cache, entry);
+        } else {
+            while (cache->used_bytes + size > cache->max_bytes) {
+                glyph_cache_remove(cache, cache->lru_tail);
+            }
+
+            entry->hash_next = cache->buckets[bucket];
+            cache->buckets[bucket] = entry;
+            glyph_cache_push_lru(cache, entry);
+            cache->used_bytes += size;
+        }
+        entry->refs++;
+
+        ttr_mutex_unlock(&cache->mutex);
+    }
+
+    ttr_stats_timer(replay_start);
+
+    for (unsigned int y = 0; y < entry->height; y++) {
+        ttr_draw_coverage_row(y, &entry->coverage[y * entry->width], entry->width, draw_span, user_data);
+    }
+
+    ttr_stats_add_time(composite_ns, replay_start);
+
+    ttr_mutex_lock(&cache->mutex);
+    if (--entry->refs == 0 && entry->evicted) {
+        free(entry);
+    }
+    ttr_mutex_unlock(&cache->mutex);
+
+    return 0;
+}
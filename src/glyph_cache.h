@@ -0,0 +1,51 @@
+#ifndef TTR_GLYPH_CACHE_H
+#define TTR_GLYPH_CACHE_H 1
+
+#include <hb.h>
+
+#include "tiny_text_renderer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Number of subpixel positions per pixel, along each axis, a glyph is rendered
+ * at when a glyph cache is in use. Must be a power of two, at most 64.
+ */
+#ifndef TTR_GLYPH_CACHE_SUBPIXEL_PHASES
+#define TTR_GLYPH_CACHE_SUBPIXEL_PHASES 4
+#endif
+
+/**
+ * Get the glyph cache attached to a font with `ttr_font_set_glyph_cache`.
+ *
+ * @param font The font.
+ * @return The attached cache, or NULL if there is none or the font can't use it because it has variations set.
+ */
+ttr_glyph_cache_t* ttr_font_get_glyph_cache(hb_font_t* font);
+
+/**
+ * Draw a glyph, reusing its coverage from the cache if it has been drawn before
+ * with the same font size and subpixel offset.
+ *
+ * Takes the same parameters as `ttr_draw_glyph`, plus the cache to use.
+ * Offsets are expected to be already rounded with `ttr_round_scaled_to_phase`.
+ */
+int ttr_draw_cached_glyph(
+    ttr_glyph_cache_t* cache,
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    hb_codepoint_t glyph,
+    hb_glyph_extents_t extents,
+    unsigned int offset_x,
+    unsigned int offset_y,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_GLYPH_CACHE_H */
@@ -1 +1,3 @@
-#undef HB_NO_DRAW
\ No newline at end of file
+#undef HB_NO_DRAW
+#undef HB_NO_CFF
+#undef HB_NO_FACE_COLLECT_UNICODES
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "metrics.h"
+#include "stats.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Fonts with up to this many glyphs get all their entries up front, larger ones a page of entries at a time.
+#define METRICS_FLAT_GLYPHS 1024
+
+// Glyphs of larger fonts, mostly CJK, are looked up by page of 256, each page allocated on first use.
+#define METRICS_PAGE_BITS 8
+#define METRICS_PAGE_SIZE (1u << METRICS_PAGE_BITS)
+
+enum {
+    METRICS_EMPTY,
+    METRICS_FILLING,
+    METRICS_FILLED,
+};
+
+typedef struct metrics_entry {
+    hb_glyph_extents_t extents;
+    bool has_extents;
+    // One of `METRICS_*`, filled by the first thread moving it out of empty, and read once filled.
+    int state;
+} metrics_entry;
+
+struct ttr_metrics_table_t {
+    // Serial of the font when the metrics were taken, the table is ignored once the font is changed since, be it
+    // its scale, variations or synthetic bold and slant.
+    unsigned int serial;
+
+    unsigned int glyph_count;
+    // Entries of all glyphs for fonts with few glyphs, or else NULL.
+    metrics_entry* entries;
+    // Pages of entries for fonts with many glyphs, installed without locking.
+    metrics_entry** pages;
+};
+
+static hb_user_data_key_t metrics_table_key;
+
+static void ttr_destroy_metrics_table(void* user_data) {
+    ttr_metrics_table_t* table = (ttr_metrics_table_t*)user_data;
+
+    if (table->pages) {
+        unsigned int page_count = (table->glyph_count + METRICS_PAGE_SIZE - 1) >> METRICS_PAGE_BITS;
+        for (unsigned int i = 0; i < page_count; i++) {
+            free(table->pages[i]);
+        }
+    }
+
+    free(table->pages);
+    free(table->entries);
+    free(table);
+}
+
+void ttr_font_enable_metrics_table(hb_font_t* font) {
+    if (hb_font_get_user_data(font, &metrics_table_key)) {
+        return;
+    }
+
+    ttr_metrics_table_t* table = calloc(1, sizeof(ttr_metrics_table_t));
+    if (!table) {
+        return;
+    }
+
+    table->serial = hb_font_get_serial(font);
+    table->glyph_count = hb_face_get_glyph_count(hb_font_get_face(font));
+
+    if (table->glyph_count <= METRICS_FLAT_GLYPHS) {
+        table->entries = calloc(table->glyph_count ? table->glyph_count : 1, sizeof(metrics_entry));
+    } else {
+        unsigned int page_count = (table->glyph_count + METRICS_PAGE_SIZE - 1) >> METRICS_PAGE_BITS;
+        table->pages = calloc(page_count, sizeof(metrics_entry*));
+    }
+
+    if ((!table->entries && !table->pages) || !hb_font_set_user_data(font, &metrics_table_key, table, ttr_destroy_metrics_table, false)) {
+        free(table->entries);
+        free(table->pages);
+        free(table);
+    }
+}
+
+ttr_metrics_table_t* ttr_font_get_metrics_table(hb_font_t* font) {
+    ttr_metrics_table_t* table = (ttr_metrics_table_t*)hb_font_get_user_data(font, &metrics_table_key);
+    if (!table) {
+        return NULL;
+    }
+
+    if (hb_font_get_serial(font) != table->serial) {
+        return NULL;
+    }
+
+    return table;
+}
+
+// Entry of a glyph, allocating its page if needed, or NULL if the glyph is out of the font or on allocation failure.
+static metrics_entry* metrics_get_entry(ttr_metrics_table_t* table, hb_codepoint_t glyph) {
+    if (glyph >= table->glyph_count) {
+        return NULL;
+    }
+
+    if (table->entries) {
+        return &table->entries[glyph];
+    }
+
+    metrics_entry** slot = &table->pages[glyph >> METRICS_PAGE_BITS];
+    metrics_entry* page = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    if (!page) {
+        metrics_entry* created = calloc(METRICS_PAGE_SIZE, sizeof(metrics_entry));
+        if (!created) {
+            return NULL;
+        }
+
+        // Another thread may have installed the page meanwhile, in which case it is used instead.
+        if (__atomic_compare_exchange_n(slot, &page, created, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            page = created;
+        } else {
+            free(created);
+        }
+    }
+
+    return &page[glyph & (METRICS_PAGE_SIZE - 1)];
+}
+
+bool ttr_metrics_get(ttr_metrics_table_t* table, hb_font_t* font, hb_codepoint_t glyph, hb_glyph_extents_t* extents) {
+    metrics_entry* entry = table ? metrics_get_entry(table, glyph) : NULL;
+
+    int state = METRICS_EMPTY;
+    if (entry) {
+        state = __atomic_load_n(&entry->state, __ATOMIC_ACQUIRE);
+        if (state == METRICS_FILLED) {
+            ttr_stats_add(glyph_metrics_hits, 1);
+            *extents = entry->extents;
+            return entry->has_extents;
+        }
+    }
+
+    bool has_extents = hb_font_get_glyph_extents(font, glyph, extents);
+    if (!has_extents) {
+        // Nothing will be drawn for this glyph.
+        *extents = (hb_glyph_extents_t) { 0 };
+    }
+
+    // A glyph being filled by another thread is looked up again rather than waited for.
+    if (entry && state == METRICS_EMPTY
+            && __atomic_compare_exchange_n(&entry->state, &state, METRICS_FILLING, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        entry->extents = *extents;
+        entry->has_extents = has_extents;
+        __atomic_store_n(&entry->state, METRICS_FILLED, __ATOMIC_RELEASE);
+    }
+
+    if (table) {
+        ttr_stats_add(glyph_metrics_misses, 1);
+    }
+
+    return has_extents;
+}
@@ -0,0 +1,39 @@
+#ifndef TTR_METRICS_H
+#define TTR_METRICS_H 1
+
+#include <stdbool.h>
+#include <hb.h>
+
+#include "tiny_text_renderer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ttr_metrics_table_t ttr_metrics_table_t;
+
+/**
+ * Get the metrics table of a font.
+ *
+ * @param font The font.
+ * @return The table enabled on the font with `ttr_font_enable_metrics_table`, or NULL if there is none.
+ */
+ttr_metrics_table_t* ttr_font_get_metrics_table(hb_font_t* font);
+
+/**
+ * Get the extents of a glyph in font scale, from the table when it has them, or else from the font, filling the
+ * table for next time.
+ *
+ * @param table The table of the font, or NULL to always ask the font.
+ * @param font The font.
+ * @param glyph Glyph id.
+ * @param extents Out param for the extents of the glyph, all zero if it has none.
+ * @return Whether the glyph has extents, like `hb_font_get_glyph_extents`.
+ */
+bool ttr_metrics_get(ttr_metrics_table_t* table, hb_font_t* font, hb_codepoint_t glyph, hb_glyph_extents_t* extents);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_METRICS_H */
@@ -0,0 +1,52 @@
+#ifndef TTR_MUTEX_H
+#define TTR_MUTEX_H 1
+
+#ifdef TTR_THREADS
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Mutex guarding state shared between threads, such as caches.
+ * Without `TTR_THREADS` all operations do nothing.
+ */
+#ifdef TTR_THREADS
+typedef pthread_mutex_t ttr_mutex_t;
+#else
+typedef struct { char unused; } ttr_mutex_t;
+#endif
+
+static inline int ttr_mutex_init(ttr_mutex_t* mutex) {
+#ifdef TTR_THREADS
+    return pthread_mutex_init(mutex, NULL) == 0 ? 0 : -1;
+#else
+    return 0;
+#endif
+}
+
+static inline void ttr_mutex_destroy(ttr_mutex_t* mutex) {
+#ifdef TTR_THREADS
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+static inline void ttr_mutex_lock(ttr_mutex_t* mutex) {
+#ifdef TTR_THREADS
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+static inline void ttr_mutex_unlock(ttr_mutex_t* mutex) {
+#ifdef TTR_THREADS
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_MUTEX_H */
@@ -0,0 +1,219 @@
+#include "outline_cache.h"
+#include "context.h"
+#include "mutex.h"
+#include "scale.h"
+#include "stats.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct outline_cache_entry outline_cache_entry;
+
+struct outline_cache_entry {
+    outline_cache_entry* next;
+    hb_codepoint_t glyph;
+
+    // Arrays point into the memory following the entry, points first as they have the strictest alignment.
+    SFT_Outline outline;
+    SFT_Point points[];
+};
+
+struct ttr_outline_cache_t {
+    ttr_mutex_t mutex;
+
+    // Scale the outlines are decoded at, which makes HarfBuzz's 26.6 coordinates equal to font units.
+    int scale;
+
+    outline_cache_entry** buckets;
+    unsigned int bucket_mask;
+    unsigned int count;
+};
+
+static hb_user_data_key_t outline_cache_key;
+
+static void ttr_destroy_outline_cache(void* user_data) {
+    ttr_outline_cache_t* cache = (ttr_outline_cache_t*)user_data;
+
+    for (unsigned int i = 0; i <= cache->bucket_mask; i++) {
+        outline_cache_entry* entry = cache->buckets[i];
+        while (entry) {
+            outline_cache_entry* next = entry->next;
+            free(entry);
+            entry = next;
+        }
+    }
+
+    ttr_mutex_destroy(&cache->mutex);
+    free(cache->buckets);
+    free(cache);
+}
+
+void ttr_face_enable_outline_cache(hb_face_t* face) {
+    if (hb_face_get_user_data(face, &outline_cache_key)) {
+        return;
+    }
+
+    ttr_outline_cache_t* cache = calloc(1, sizeof(ttr_outline_cache_t));
+    if (!cache) {
+        return;
+    }
+
+    unsigned int bucket_count = 64;
+    cache->buckets = calloc(bucket_count, sizeof(outline_cache_entry*));
+    if (!cache->buckets) {
+        free(cache);
+        return;
+    }
+
+    if (ttr_mutex_init(&cache->mutex) != 0) {
+        free(cache->buckets);
+        free(cache);
+        return;
+    }
+
+    cache->bucket_mask = bucket_count - 1;
+    cache->scale = ttr_scale_up(hb_face_get_upem(face));
+
+    if (!hb_face_set_user_data(face, &outline_cache_key, cache, ttr_destroy_outline_cache, false)) {
+        ttr_destroy_outline_cache(cache);
+    }
+}
+
+ttr_outline_cache_t* ttr_font_get_outline_cache(hb_font_t* font) {
+    unsigned int coords_length;
+    hb_font_get_var_coords_normalized(font, &coords_length);
+    if (coords_length > 0) {
+        // Cached outlines are those of the default instance.
+        return NULL;
+    }
+
+    return (ttr_outline_cache_t*)hb_face_get_user_data(hb_font_get_face(font), &outline_cache_key);
+}
+
+int ttr_outline_cache_scale(const ttr_outline_cache_t* cache) {
+    return cache->scale;
+}
+
+static unsigned int outline_cache_hash(hb_codepoint_t glyph) {
+    uint32_t hash = glyph * 0x9E3779B1u;
+    return hash ^ (hash >> 16);
+}
+
+// Doubles the number of buckets, keeping chains short as more glyphs get cached.
+static void outline_cache_grow(ttr_outline_cache_t* cache) {
+    unsigned int bucket_count = (cache->bucket_mask + 1) * 2;
+    outline_cache_entry** buckets = calloc(bucket_count, sizeof(outline_cache_entry*));
+    if (!buckets) {
+        return;
+    }
+
+    for (unsigned int i = 0; i <= cache->bucket_mask; i++) {
+        outline_cache_entry* entry = cache->buckets[i];
+        while (entry) {
+            outline_cache_entry* next = entry->next;
+            unsigned int bucket = outline_cache_hash(entry->glyph) & (bucket_count - 1);
+            entry->next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_mask = bucket_count - 1;
+}
+
+static outline_cache_entry* outline_cache_decode(ttr_outline_cache_t* cache, ttr_context_t* ctx, hb_font_t* font, hb_codepoint_t glyph) {
+    hb_font_t* unit_font = hb_font_create(hb_font_get_face(font));
+    hb_font_set_scale(unit_font, cache->scale, cache->scale);
+
+    SFT_Outline* decoded = &ctx->outline;
+    sft_reset_outline(decoded);
+    hb_font_draw_glyph(unit_font, glyph, ctx->draw_funcs, decoded);
+
+    hb_font_destroy(unit_font);
+
+    size_t points_size = decoded->numPoints * sizeof(SFT_Point);
+    size_t cubics_size = decoded->numCubics * sizeof(SFT_Cubic);
+    size_t curves_size = decoded->numCurves * sizeof(SFT_Curve);
+    size_t lines_size = decoded->numLines * sizeof(SFT_Line);
+
+    outline_cache_entry* entry = malloc(sizeof(outline_cache_entry) + points_size + cubics_size + curves_size + lines_size);
+    if (!entry) {
+        return NULL;
+    }
+
+    char* memory = (char*)entry->points;
+    SFT_Outline* outline = &entry->outline;
+
+    outline->points = (SFT_Point*)memory;
+    outline->cubics = (SFT_Cubic*)(memory += points_size);
+    outline->curves = (SFT_Curve*)(memory += cubics_size);
+    outline->lines = (SFT_Line*)(memory += curves_size);
+
+    outline->numPoints = outline->capPoints = decoded->numPoints;
+    outline->numCubics = outline->capCubics = decoded->numCubics;
+    outline->numCurves = outline->capCurves = decoded->numCurves;
+    outline->numLines = outline->capLines = decoded->numLines;
+
+    memcpy(outline->points, decoded->points, points_size);
+    memcpy(outline->cubics, decoded->cubics, cubics_size);
+    memcpy(outline->curves, decoded->curves, curves_size);
+    memcpy(outline->lines, decoded->lines, lines_size);
+
+    entry->glyph = glyph;
+
+    return entry;
+}
+
+static outline_cache_entry* outline_cache_find(ttr_outline_cache_t* cache, hb_codepoint_t glyph) {
+    outline_cache_entry* entry = cache->buckets[outline_cache_hash(glyph) & cache->bucket_mask];
+    while (entry && entry->glyph != glyph) {
+        entry = entry->next;
+    }
+    return entry;
+}
+
+const SFT_Outline* ttr_outline_cache_get(ttr_outline_cache_t* cache, ttr_context_t* ctx, hb_font_t* font, hb_codepoint_t glyph) {
+    ttr_mutex_lock(&cache->mutex);
+    outline_cache_entry* entry = outline_cache_find(cache, glyph);
+    ttr_mutex_unlock(&cache->mutex);
+
+    if (entry) {
+        ttr_stats_add(outline_cache_hits, 1);
+
+        // Entries live as long as the cache, so can be used without holding the lock.
+        return &entry->outline;
+    }
+
+    ttr_stats_add(outline_cache_misses, 1);
+
+    entry = outline_cache_decode(cache, ctx, font, glyph);
+    if (!entry) {
+        return NULL;
+    }
+
+    ttr_mutex_lock(&cache->mutex);
+
+    outline_cache_entry* existing = outline_cache_find(cache, glyph);
+    if (existing) {
+        // Another thread decoded the same glyph in the meantime.
+        free(entry);
+        entry = existing;
+    } else {
+        if (cache->count >= (cache->bucket_mask + 1) * 2) {
+            outline_cache_grow(cache);
+        }
+
+        unsigned int bucket = outline_cache_hash(glyph) & cache->bucket_mask;
+        entry->next = cache->buckets[bucket];
+        cache->buckets[bucket] = entry;
+        cache->count++;
+    }
+
+    ttr_mutex_unlock(&cache->mutex);
+
+    return &entry->outline;
+}
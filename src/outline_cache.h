@@ -0,0 +1,50 @@
+#ifndef TTR_OUTLINE_CACHE_H
+#define TTR_OUTLINE_CACHE_H 1
+
+#include <hb.h>
+
+#include "tiny_text_renderer.h"
+#include "schrift.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ttr_outline_cache_t ttr_outline_cache_t;
+
+/**
+ * Get the outline cache to use when drawing with a font.
+ *
+ * @param font The font.
+ * @return The cache enabled on the font's face with `ttr_face_enable_outline_cache`, or NULL if there is none
+ * or the font can't use it because it has variations set.
+ */
+ttr_outline_cache_t* ttr_font_get_outline_cache(hb_font_t* font);
+
+/**
+ * Get the outline of a glyph, decoding and caching it on first use.
+ *
+ * Coordinates are those a font scaled to `ttr_outline_cache_scale` would produce, that is font units
+ * in the same fixed or floating point representation as any other outline.
+ *
+ * @param cache The cache.
+ * @param ctx Context holding the working memory to decode in.
+ * @param font Any font of the face the cache belongs to.
+ * @param glyph Glyph id.
+ * @return The cached outline, valid until the face is destroyed, or NULL on allocation failure.
+ */
+const SFT_Outline* ttr_outline_cache_get(ttr_outline_cache_t* cache, ttr_context_t* ctx, hb_font_t* font, hb_codepoint_t glyph);
+
+/**
+ * Get the font scale, in 26.6 units like `hb_font_get_scale`, of the outlines in a cache.
+ *
+ * @param cache The cache.
+ * @return The scale.
+ */
+int ttr_outline_cache_scale(const ttr_outline_cache_t* cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_OUTLINE_CACHE_H */
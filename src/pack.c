@@ -0,0 +1,165 @@
+#include "pack.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Whether `count` items of `item_size` bytes at `offset` are within the pack and aligned.
+static bool ttr_pack_range_valid(size_t size, uint32_t offset, uint32_t count, size_t item_size) {
+    if (offset % 4 != 0 || offset > size) {
+        return false;
+    }
+    return (unsigned long long)count * item_size <= size - offset;
+}
+
+static bool ttr_pack_string_valid(const uint8_t* data, size_t size, uint32_t offset) {
+    return offset < size && memchr(data + offset, '\0', size - offset) != NULL;
+}
+
+static bool ttr_pack_strike_valid(const uint8_t* data, size_t size, const ttr_pack_strike_t* strike) {
+    if (!ttr_pack_range_valid(size, strike->glyphs_offset, strike->glyph_count, sizeof(ttr_pack_glyph_t))
+        || !ttr_pack_range_valid(size, strike->cmap_offset, strike->cmap_count, sizeof(ttr_pack_cmap_entry_t))
+        || !ttr_pack_range_valid(size, strike->strings_offset, strike->string_count, sizeof(ttr_pack_string_t))) {
+        return false;
+    }
+
+    const ttr_pack_glyph_t* glyphs = (const ttr_pack_glyph_t*)(data + strike->glyphs_offset);
+    for (uint32_t i = 0; i < strike->glyph_count; i++) {
+        // Coverage is read a byte at a time and needs no alignment.
+        if (glyphs[i].bitmap_offset > size || (size_t)glyphs[i].width * glyphs[i].height > size - glyphs[i].bitmap_offset) {
+            return false;
+        }
+    }
+
+    const ttr_pack_cmap_entry_t* cmap = (const ttr_pack_cmap_entry_t*)(data + strike->cmap_offset);
+    for (uint32_t i = 0; i < strike->cmap_count; i++) {
+        if (cmap[i].glyph_index >= strike->glyph_count) {
+            return false;
+        }
+    }
+
+    const ttr_pack_string_t* strings = (const ttr_pack_string_t*)(data + strike->strings_offset);
+    for (uint32_t i = 0; i < strike->string_count; i++) {
+        if (!ttr_pack_string_valid(data, size, strings[i].text_offset)
+            || !ttr_pack_range_valid(size, strings[i].placements_offset, strings[i].placement_count, sizeof(ttr_pack_placement_t))) {
+            return false;
+        }
+
+        const ttr_pack_placement_t* placements = (const ttr_pack_placement_t*)(data + strings[i].placements_offset);
+        for (uint32_t j = 0; j < strings[i].placement_count; j++) {
+            if (placements[j].glyph_index >= strike->glyph_count) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+ttr_pack_t* ttr_open_pack(const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    // Everything is read in place, so the pack must be aligned like its fields.
+    if (((uintptr_t)bytes % 4) != 0 || size < sizeof(ttr_pack_header_t)) {
+        return NULL;
+    }
+
+    const ttr_pack_header_t* header = (const ttr_pack_header_t*)bytes;
+    if (memcmp(header->magic, TTR_PACK_MAGIC, 4) != 0 || header->version != TTR_PACK_VERSION) {
+        return NULL;
+    }
+
+    if (!ttr_pack_range_valid(size, header->strikes_offset, header->strike_count, sizeof(ttr_pack_strike_t))) {
+        return NULL;
+    }
+
+    const ttr_pack_strike_t* strikes = (const ttr_pack_strike_t*)(bytes + header->strikes_offset);
+    for (uint32_t i = 0; i < header->strike_count; i++) {
+        if (!ttr_pack_strike_valid(bytes, size, &strikes[i])) {
+            return NULL;
+        }
+    }
+
+    ttr_pack_t* pack = calloc(1, sizeof(ttr_pack_t));
+    if (!pack) {
+        return NULL;
+    }
+
+    pack->data = bytes;
+    pack->size = size;
+    pack->header = header;
+    pack->strikes = strikes;
+
+    return pack;
+}
+
+void ttr_destroy_pack(ttr_pack_t* pack) {
+    free(pack);
+}
+
+const ttr_pack_strike_t* ttr_pack_find_strike(const ttr_pack_t* pack, unsigned int size) {
+    for (uint32_t i = 0; i < pack->header->strike_count; i++) {
+        if (pack->strikes[i].size == size) {
+            return &pack->strikes[i];
+        }
+    }
+    return NULL;
+}
+
+const ttr_pack_glyph_t* ttr_pack_find_glyph(const ttr_pack_t* pack, const ttr_pack_strike_t* strike, hb_codepoint_t glyph_id) {
+    const ttr_pack_glyph_t* glyphs = ttr_pack_at(pack, strike->glyphs_offset);
+
+    uint32_t low = 0, high = strike->glyph_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (glyphs[mid].glyph_id < glyph_id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low < strike->glyph_count && glyphs[low].glyph_id == glyph_id ? &glyphs[low] : NULL;
+}
+
+const ttr_pack_glyph_t* ttr_pack_find_codepoint(const ttr_pack_t* pack, const ttr_pack_strike_t* strike, hb_codepoint_t codepoint) {
+    const ttr_pack_cmap_entry_t* cmap = ttr_pack_at(pack, strike->cmap_offset);
+
+    uint32_t low = 0, high = strike->cmap_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (cmap[mid].codepoint < codepoint) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (low == strike->cmap_count || cmap[low].codepoint != codepoint) {
+        return NULL;
+    }
+
+    const ttr_pack_glyph_t* glyphs = ttr_pack_at(pack, strike->glyphs_offset);
+    return &glyphs[cmap[low].glyph_index];
+}
+
+const ttr_pack_string_t* ttr_pack_find_string(const ttr_pack_t* pack, const ttr_pack_strike_t* strike, const char* text) {
+    const ttr_pack_string_t* strings = ttr_pack_at(pack, strike->strings_offset);
+
+    uint32_t low = 0, high = strike->string_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        int order = strcmp(ttr_pack_at(pack, strings[mid].text_offset), text);
+        if (order == 0) {
+            return &strings[mid];
+        }
+        if (order < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,128 @@
+#ifndef TTR_PACK_H
+#define TTR_PACK_H 1
+
+#include <stdint.h>
+#include <hb.h>
+
+#include "tiny_text_renderer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Layout of glyph packs written by `tiny-text-renderer-pack` and drawn from by `ttr_pack_*`.
+ *
+ * All fields are little endian and aligned to 4 bytes, and offsets are in bytes from the start of the pack, so that
+ * a pack can be used in place from flash or a mapped file. Positions in font scale are 26.6 fixed point like
+ * HarfBuzz positions at the scale fonts are created with, with y pointing up; pixel positions have y pointing down.
+ */
+#define TTR_PACK_MAGIC "TTRP"
+#define TTR_PACK_VERSION 1
+
+typedef struct ttr_pack_header_t {
+    char magic[4];
+    uint32_t version;
+    uint32_t strike_count;
+    uint32_t strikes_offset;
+} ttr_pack_header_t;
+
+// Glyphs of one font at one size.
+typedef struct ttr_pack_strike_t {
+    uint32_t size;
+    int32_t ascender;
+    int32_t descender;
+    // `ttr_pack_glyph_t` sorted by glyph id.
+    uint32_t glyph_count;
+    uint32_t glyphs_offset;
+    // `ttr_pack_cmap_entry_t` sorted by codepoint, for text that wasn't shaped by the tool.
+    uint32_t cmap_count;
+    uint32_t cmap_offset;
+    // `ttr_pack_string_t` sorted by text, as compared with `strcmp`.
+    uint32_t string_count;
+    uint32_t strings_offset;
+} ttr_pack_strike_t;
+
+typedef struct ttr_pack_glyph_t {
+    uint32_t glyph_id;
+    // Advance of the glyph alone, in font scale.
+    int32_t x_advance;
+    // Top left of the coverage relative to a pen on a whole pixel of the baseline, in pixels.
+    int16_t left;
+    int16_t top;
+    uint16_t width;
+    uint16_t height;
+    // `width * height` bytes of coverage, row after row.
+    uint32_t bitmap_offset;
+} ttr_pack_glyph_t;
+
+typedef struct ttr_pack_cmap_entry_t {
+    uint32_t codepoint;
+    // Index in the glyphs of the strike.
+    uint32_t glyph_index;
+} ttr_pack_cmap_entry_t;
+
+typedef struct ttr_pack_string_t {
+    // Null-terminated utf-8.
+    uint32_t text_offset;
+    // `ttr_pack_placement_t` in drawing order.
+    uint32_t placement_count;
+    uint32_t placements_offset;
+    // As returned by `ttr_run_measure` for the shaped string.
+    uint32_t width;
+    uint32_t height;
+    uint32_t baseline;
+} ttr_pack_string_t;
+
+typedef struct ttr_pack_placement_t {
+    // Index in the glyphs of the strike.
+    uint32_t glyph_index;
+    // Pen position plus glyph offset from the start of the string, in font scale.
+    int32_t x;
+    int32_t y;
+} ttr_pack_placement_t;
+
+struct ttr_pack_t {
+    const uint8_t* data;
+    size_t size;
+    const ttr_pack_header_t* header;
+    const ttr_pack_strike_t* strikes;
+};
+
+/**
+ * Find the strike of a pack for a size.
+ *
+ * @return The strike, or NULL if the pack has none for that size.
+ */
+const ttr_pack_strike_t* ttr_pack_find_strike(const ttr_pack_t* pack, unsigned int size);
+
+/**
+ * Find a glyph of a strike by glyph id.
+ *
+ * @return The glyph, or NULL if it isn't in the strike.
+ */
+const ttr_pack_glyph_t* ttr_pack_find_glyph(const ttr_pack_t* pack, const ttr_pack_strike_t* strike, hb_codepoint_t glyph_id);
+
+/**
+ * Find the glyph a codepoint is mapped to in a strike.
+ *
+ * @return The glyph, or NULL if the codepoint isn't mapped.
+ */
+const ttr_pack_glyph_t* ttr_pack_find_codepoint(const ttr_pack_t* pack, const ttr_pack_strike_t* strike, hb_codepoint_t codepoint);
+
+/**
+ * Find a string shaped by the tool in a strike.
+ *
+ * @return The string, or NULL if it wasn't shaped at that size.
+ */
+const ttr_pack_string_t* ttr_pack_find_string(const ttr_pack_t* pack, const ttr_pack_strike_t* strike, const char* text);
+
+static inline const void* ttr_pack_at(const ttr_pack_t* pack, uint32_t offset) {
+    return pack->data + offset;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_PACK_H */
@@ -0,0 +1,253 @@
+#include "paragraph.h"
+#include "scale.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define max(a, b) ({ \
+    typeof(a) _a = (a); \
+    typeof(b) _b = (b); \
+    _a > _b ? _a : _b; \
+})
+
+// Kinds of break after a glyph.
+enum {
+    BREAK_NONE,
+    // White space, which lines can be broken after and which isn't counted at their end.
+    BREAK_SPACE,
+    // Lines can be broken after it, such as after a hyphen.
+    BREAK_AFTER,
+    // Lines must be broken after it.
+    BREAK_MANDATORY,
+};
+
+// Index in the run of the glyph at `index` in logical order.
+static unsigned int paragraph_glyph(const ttr_paragraph_t* paragraph, unsigned int index) {
+    const ttr_run_t* run = paragraph->run;
+    return HB_DIRECTION_IS_BACKWARD(run->direction) ? run->glyph_count - 1 - index : index;
+}
+
+static uint32_t paragraph_cluster(const ttr_paragraph_t* paragraph, unsigned int index) {
+    return paragraph->run->glyph_info[paragraph_glyph(paragraph, index)].cluster;
+}
+
+// Find where lines can be broken from the characters glyphs were shaped from. This only looks at spaces, hyphens
+// and newlines, which is enough for scripts separating words with spaces.
+static void paragraph_find_breaks(ttr_paragraph_t* paragraph, const char* text) {
+    unsigned int count = paragraph->run->glyph_count;
+
+    for (unsigned int i = 0; i < count; i++) {
+        uint32_t cluster = paragraph_cluster(paragraph, i);
+
+        // Glyphs of a cluster can't be split over lines.
+        if (i + 1 < count && paragraph_cluster(paragraph, i + 1) == cluster) {
+            paragraph->breaks[i] = BREAK_NONE;
+            continue;
+        }
+
+        switch (text[cluster]) {
+        case '\n':
+            paragraph->breaks[i] = BREAK_MANDATORY;
+            break;
+        case ' ':
+        case '\t':
+        case '\r':
+            paragraph->breaks[i] = BREAK_SPACE;
+            break;
+        case '-':
+            paragraph->breaks[i] = BREAK_AFTER;
+            break;
+        default:
+            paragraph->breaks[i] = BREAK_NONE;
+            break;
+        }
+    }
+}
+
+static int paragraph_add_line(ttr_paragraph_t* paragraph, unsigned int start, unsigned int end) {
+    if (paragraph->line_count == paragraph->line_capacity) {
+        unsigned int capacity = paragraph->line_capacity ? paragraph->line_capacity * 2 : 8;
+        ttr_line_t* lines = realloc(paragraph->lines, capacity * sizeof(ttr_line_t));
+        if (!lines) {
+            return -1;
+        }
+        paragraph->lines = lines;
+        paragraph->line_capacity = capacity;
+    }
+
+    const ttr_run_t* run = paragraph->run;
+
+    // The text of a line runs up to the next one, while trailing space and line breaks aren't part of its glyphs.
+    // The empty line after a trailing newline starts at the end of the text.
+    unsigned int text_start = start < run->glyph_count ? paragraph_cluster(paragraph, start) : paragraph->text_length;
+    unsigned int visible_end = end;
+    while (visible_end > start && paragraph->breaks[visible_end - 1] != BREAK_NONE && paragraph->breaks[visible_end - 1] != BREAK_AFTER) {
+        visible_end--;
+    }
+
+    int advance = 0;
+    for (unsigned int i = start; i < visible_end; i++) {
+        advance += run->glyph_pos[paragraph_glyph(paragraph, i)].x_advance;
+    }
+
+    unsigned int index = paragraph->line_count++;
+    int top = index * paragraph->line_height;
+
+    paragraph->lines[index] = (ttr_line_t) {
+        .glyph_start = HB_DIRECTION_IS_BACKWARD(run->direction) ? run->glyph_count - visible_end : start,
+        .glyph_count = visible_end - start,
+        .text_start = text_start,
+        .bounds = {
+            .y = ttr_scale_down_round(top),
+            .width = ttr_scale_down_ceil(advance),
+            .height = ttr_scale_down_round(paragraph->line_height),
+        },
+        .baseline = ttr_scale_down_round(top + paragraph->ascender),
+    };
+
+    return 0;
+}
+
+static int paragraph_advance(const ttr_paragraph_t* paragraph, unsigned int index) {
+    return paragraph->run->glyph_pos[paragraph_glyph(paragraph, index)].x_advance;
+}
+
+static int paragraph_fit_lines(ttr_paragraph_t* paragraph, unsigned int max_width) {
+    const ttr_run_t* run = paragraph->run;
+    const int limit = ttr_scale_up(max_width);
+    const unsigned int count = run->glyph_count;
+
+    paragraph->line_count = 0;
+
+    unsigned int line_start = 0;
+    // Start of the line after the last place the current one can be broken at, or `line_start` if there is none.
+    unsigned int break_at = 0;
+    int line_width = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        uint8_t kind = paragraph->breaks[i];
+
+        line_width += paragraph_advance(paragraph, i);
+
+        // White space may hang past the end of a line.
+        while (max_width > 0 && kind != BREAK_SPACE && kind != BREAK_MANDATORY && line_width > limit && i > line_start) {
+            unsigned int end;
+            if (break_at > line_start) {
+                end = break_at;
+            } else if (paragraph_cluster(paragraph, i) != paragraph_cluster(paragraph, i - 1)) {
+                // A word longer than a line is broken at the glyph that overflows.
+                end = i;
+            } else {
+                break;
+            }
+
+            if (paragraph_add_line(paragraph, line_start, end) != 0) {
+                return -1;
+            }
+            line_start = break_at = end;
+
+            line_width = 0;
+            for (unsigned int j = line_start; j <= i; j++) {
+                line_width += paragraph_advance(paragraph, j);
+            }
+        }
+
+        if (kind == BREAK_MANDATORY) {
+            if (paragraph_add_line(paragraph, line_start, i + 1) != 0) {
+                return -1;
+            }
+            line_start = break_at = i + 1;
+            line_width = 0;
+        } else if (kind != BREAK_NONE) {
+            break_at = i + 1;
+        }
+    }
+
+    if (paragraph_add_line(paragraph, line_start, count) != 0) {
+        return -1;
+    }
+
+    unsigned int width = 0;
+    for (unsigned int i = 0; i < paragraph->line_count; i++) {
+        ttr_line_t* line = &paragraph->lines[i];
+        unsigned int text_end = i + 1 < paragraph->line_count ? paragraph->lines[i + 1].text_start : paragraph->text_length;
+        line->text_length = text_end - line->text_start;
+        width = max(width, line->bounds.width);
+    }
+
+    // Right to left lines are aligned to the right of the paragraph.
+    if (HB_DIRECTION_IS_BACKWARD(run->direction)) {
+        for (unsigned int i = 0; i < paragraph->line_count; i++) {
+            paragraph->lines[i].bounds.x = width - paragraph->lines[i].bounds.width;
+        }
+    }
+
+    paragraph->width = width;
+    paragraph->height = ttr_scale_down_ceil(paragraph->line_count * paragraph->line_height);
+
+    return 0;
+}
+
+ttr_paragraph_t* ttr_layout_paragraph(hb_font_t* font, const char *text, unsigned int max_width) {
+    ttr_paragraph_t* paragraph = calloc(1, sizeof(ttr_paragraph_t));
+    if (!paragraph) {
+        return NULL;
+    }
+
+    paragraph->run = ttr_shape_text(font, text);
+    if (!paragraph->run) {
+        ttr_destroy_paragraph(paragraph);
+        return NULL;
+    }
+
+    paragraph->breaks = malloc(max(paragraph->run->glyph_count, 1u));
+    if (!paragraph->breaks) {
+        ttr_destroy_paragraph(paragraph);
+        return NULL;
+    }
+    paragraph_find_breaks(paragraph, text);
+    paragraph->text_length = strlen(text);
+
+    hb_font_extents_t extents;
+    hb_font_get_h_extents(font, &extents);
+    paragraph->ascender = extents.ascender;
+    paragraph->line_height = extents.ascender - extents.descender + extents.line_gap;
+
+    if (paragraph_fit_lines(paragraph, max_width) != 0) {
+        ttr_destroy_paragraph(paragraph);
+        return NULL;
+    }
+
+    return paragraph;
+}
+
+int ttr_paragraph_set_max_width(ttr_paragraph_t* paragraph, unsigned int max_width) {
+    return paragraph_fit_lines(paragraph, max_width);
+}
+
+void ttr_destroy_paragraph(ttr_paragraph_t* paragraph) {
+    if (!paragraph) {
+        return;
+    }
+
+    ttr_destroy_run(paragraph->run);
+    free(paragraph->breaks);
+    free(paragraph->lines);
+    free(paragraph);
+}
+
+void ttr_paragraph_measure(const ttr_paragraph_t* paragraph, unsigned int *width, unsigned int *height) {
+    if (width != NULL) {
+        *width = paragraph->width;
+    }
+    if (height != NULL) {
+        *height = paragraph->height;
+    }
+}
+
+const ttr_line_t* ttr_paragraph_get_lines(const ttr_paragraph_t* paragraph, unsigned int* line_count) {
+    *line_count = paragraph->line_count;
+    return paragraph->lines;
+}
@@ -0,0 +1,37 @@
+#ifndef TTR_PARAGRAPH_H
+#define TTR_PARAGRAPH_H 1
+
+#include <hb.h>
+
+#include "tiny_text_renderer.h"
+#include "run.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ttr_paragraph_t {
+    ttr_run_t* run;
+
+    // Kind of break allowed after each glyph, in logical order.
+    uint8_t* breaks;
+    // Bytes of the text the run was shaped from.
+    unsigned int text_length;
+
+    ttr_line_t* lines;
+    unsigned int line_count;
+    unsigned int line_capacity;
+
+    // Distance between baselines, and from the top of a line to its baseline, in font scale.
+    int line_height;
+    int ascender;
+
+    unsigned int width;
+    unsigned int height;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_PARAGRAPH_H */
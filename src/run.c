@@ -0,0 +1,138 @@
+#include "run.h"
+#include "metrics.h"
+#include "scale.h"
+#include "stats.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define max(a, b) ({ \
+    typeof(a) _a = (a); \
+    typeof(b) _b = (b); \
+    _a > _b ? _a : _b; \
+})
+
+#define min(a, b) ({ \
+    typeof(a) _a = (a); \
+    typeof(b) _b = (b); \
+    _a < _b ? _a : _b; \
+})
+
+int ttr_run_shape(ttr_run_t* run, const char* text) {
+    return ttr_run_shape_segment(run, text, -1, 0, -1);
+}
+
+int ttr_run_shape_segment(ttr_run_t* run, const char* text, int text_length, unsigned int start, int length) {
+    hb_buffer_clear_contents(run->buffer);
+    hb_buffer_add_utf8(run->buffer, text, text_length, start, length);
+
+    hb_buffer_guess_segment_properties(run->buffer);
+
+    ttr_stats_timer(shape_start);
+    hb_shape(run->font, run->buffer, NULL, 0);
+    ttr_stats_add_time(shape_ns, shape_start);
+    ttr_stats_add(shape_calls, 1);
+
+    unsigned int glyph_count;
+    run->glyph_info = hb_buffer_get_glyph_infos(run->buffer, &glyph_count);
+    run->glyph_pos  = hb_buffer_get_glyph_positions(run->buffer, &glyph_count);
+    run->glyph_count = glyph_count;
+    run->direction = hb_buffer_get_direction(run->buffer);
+
+    if (glyph_count > run->extents_capacity || !run->glyph_extents) {
+        unsigned int capacity = max(glyph_count, 16u);
+        hb_glyph_extents_t* glyph_extents = realloc(run->glyph_extents, capacity * sizeof(hb_glyph_extents_t));
+        if (!glyph_extents) {
+            return -1;
+        }
+        run->glyph_extents = glyph_extents;
+        run->extents_capacity = capacity;
+    }
+
+    ttr_stats_timer(extents_start);
+
+    ttr_metrics_table_t* metrics = ttr_font_get_metrics_table(run->font);
+
+    int x_min = 0, x_max = 0;
+    int y_min = 0, y_max = 0;
+
+    int cursor_x = 0;
+    int cursor_y = 0;
+    for (unsigned int i = 0; i < glyph_count; i++) {
+        hb_codepoint_t glyphid  = run->glyph_info[i].codepoint;
+        hb_glyph_position_t* pos = &run->glyph_pos[i];
+
+        hb_glyph_extents_t* extents = &run->glyph_extents[i];
+        if (ttr_metrics_get(metrics, run->font, glyphid, extents)) {
+            y_min = min(y_min, cursor_y + pos->y_offset + extents->y_bearing + extents->height);
+            y_max = max(y_max, cursor_y + pos->y_offset + extents->y_bearing);
+
+            x_min = min(x_min, cursor_x + pos->x_offset + extents->x_bearing);
+            x_max = max(x_max, cursor_x + pos->x_offset + extents->x_bearing + extents->width);
+        }
+
+        cursor_x += pos->x_advance;
+        cursor_y += pos->y_advance;
+    }
+
+    run->x_min = x_min;
+    run->x_max = x_max;
+    run->y_min = y_min;
+    run->y_max = y_max;
+
+    ttr_stats_add_time(extents_ns, extents_start);
+
+    return 0;
+}
+
+ttr_run_t* ttr_shape_text(hb_font_t* font, const char *text) {
+    ttr_run_t* run = calloc(1, sizeof(ttr_run_t));
+    if (!run) {
+        return NULL;
+    }
+
+    run->font = hb_font_reference(font);
+    run->buffer = hb_buffer_create();
+
+    if (ttr_run_shape(run, text) != 0) {
+        ttr_destroy_run(run);
+        return NULL;
+    }
+
+    return run;
+}
+
+void ttr_destroy_run(ttr_run_t* run) {
+    if (!run) {
+        return;
+    }
+
+    free(run->glyph_extents);
+    hb_buffer_destroy(run->buffer);
+    hb_font_destroy(run->font);
+    free(run);
+}
+
+int ttr_run_advance(const ttr_run_t* run) {
+    int advance = 0;
+    for (unsigned int i = 0; i < run->glyph_count; i++) {
+        advance += HB_DIRECTION_IS_HORIZONTAL(run->direction) ? run->glyph_pos[i].x_advance : run->glyph_pos[i].y_advance;
+    }
+    return advance;
+}
+
+void ttr_run_measure(const ttr_run_t* run, unsigned int *width, unsigned int *height, unsigned int *baseline) {
+    if (width != NULL && height != NULL) {
+        *width = ttr_scale_down_ceil(run->x_max - run->x_min);
+        *height = ttr_scale_down_ceil(run->y_max - run->y_min);
+    }
+
+    if (baseline != NULL) {
+        if (HB_DIRECTION_IS_VERTICAL(run->direction)) {
+            *baseline = ttr_scale_down_round(-run->x_min);
+        } else {
+            *baseline = ttr_scale_down_round(run->y_max);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef TTR_RUN_H
+#define TTR_RUN_H 1
+
+#include <hb.h>
+
+#include "tiny_text_renderer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ttr_run_t {
+    hb_font_t* font;
+    hb_buffer_t* buffer;
+    hb_direction_t direction;
+
+    unsigned int glyph_count;
+    hb_glyph_info_t* glyph_info;
+    hb_glyph_position_t* glyph_pos;
+    hb_glyph_extents_t* glyph_extents;
+    unsigned int extents_capacity;
+
+    // Ink bounds of the whole run relative to the starting pen position, y pointing up.
+    int x_min;
+    int x_max;
+    int y_min;
+    int y_max;
+};
+
+/**
+ * Shape text into a run and collect the extents of all its glyphs.
+ * Memory held by the run from earlier calls is reused.
+ *
+ * @param run The run to fill, with `font` and `buffer` set.
+ * @param text Null-terminated utf-8 text to shape.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int ttr_run_shape(ttr_run_t* run, const char* text);
+
+/**
+ * Like `ttr_run_shape`, but only shaping `length` bytes from `start`, with the rest of the text as context.
+ * Clusters are byte offsets in the whole text.
+ *
+ * @param text_length Length of the text in bytes, or -1 if null-terminated.
+ * @param length Length of the segment in bytes, or -1 for up to the end of the text.
+ */
+int ttr_run_shape_segment(ttr_run_t* run, const char* text, int text_length, unsigned int start, int length);
+
+/**
+ * Sum of the advances of the glyphs of a run along its direction, in font scale.
+ */
+int ttr_run_advance(const ttr_run_t* run);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_RUN_H */
@@ -20,6 +20,16 @@ int ttr_fraction_scaled(int value) {
     return value & (hb_scale_factor - 1);
 }
 
+// Rounds to the nearest of `phases` equally spaced subpixel positions. `phases` must be a power of two.
+int ttr_round_scaled_to_phase(int value, unsigned int phases) {
+    const int step = hb_scale_factor / phases;
+    return (value + (step >> 1)) & ~(step - 1);
+}
+
+int ttr_round_float(float value) {
+    return value < 0 ? -(int)(0.5f - value) : (int)(value + 0.5f);
+}
+
 float ttr_scale_down_float(float value) {
     return value / hb_scale_factor_divider;
 }
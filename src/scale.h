@@ -12,6 +12,9 @@ int ttr_scale_up(int value);
 int ttr_round_scaled(int value);
 int ttr_floor_scaled(int value);
 int ttr_fraction_scaled(int value);
+int ttr_round_scaled_to_phase(int value, unsigned int phases);
+
+int ttr_round_float(float value);
 
 float ttr_scale_down_float(float value);
 float ttr_scale_down(int value);
@@ -20,48 +20,85 @@
 #include <assert.h>
 
 #include "schrift.h"
+#include "coverage.h"
+#include "stats.h"
 
 /* macros */
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define SIGN(x)   (((x) > 0) - ((x) < 0))
 
 /* structs */
-typedef struct Cell    Cell;
-typedef struct Raster  Raster;
+typedef struct Cell       Cell;
+typedef struct SparseCell SparseCell;
+typedef struct Raster     Raster;
 
+#ifdef TTR_FIXED_POINT
+/* Cover is in fixed point units of pixel height. Area is additionally scaled by
+ * twice the width of a pixel, so that a fully covered pixel has an area of FULL_AREA. */
+#define COVER_TO_AREA (2 * SFT_FIXED_ONE)
+#define FULL_AREA     (COVER_TO_AREA * SFT_FIXED_ONE)
+struct Cell  { int32_t area, cover; };
+#else
 struct Cell  { float area, cover; };
+#endif
+
+/* A cell of a sparse raster, linked to the cell added before it on the same row. */
+struct SparseCell { int32_t next, x; Cell cell; };
+
+/* Glyphs of at least this many pixels whose outline touches few of them are rasterized sparsely. */
+#define SPARSE_MIN_PIXELS (64 * 64)
 
 struct Raster
 {
-	Cell *cells;
-	int   width;
-	int   height;
+	Cell    *cells;
+	uint8_t *row;
+	int      width;
+	int      height;
+	/* Row of the image the first row of cells belongs to. */
+	int      top;
+
+	/* In sparse mode, cells are instead added to a list per row, most recent first, and cells is NULL. */
+	int32_t      *rowHeads;
+	SparseCell   *sparse;
+	unsigned int *numSparse;
+	unsigned int  capSparse;
+	/* Room for the cells of one row, sorted by column, and in floating point, for a row of area. */
+	SparseCell   *sorted;
+	float        *area;
 };
 
 /* function declarations */
 static inline int fast_floor(float x);
 static inline int fast_ceil (float x);
 /* simple mathematical operations */
-static SFT_Point midpoint(SFT_Point a, SFT_Point b);
-static void transform_points(unsigned int numPts, SFT_Point *points, float trf[6]);
+static void transform_points(unsigned int numPts, SFT_Point *points, SFT_Coord trf[6]);
 static void clip_points(unsigned int numPts, SFT_Point *points, int width, int height);
 /* 'outline' data structure management */
 // static int  init_outline(SFT_Outline *outl);
 // static void free_outline(SFT_Outline *outl);
 static int  grow_points (SFT_Outline *outl);
 static int  grow_curves (SFT_Outline *outl);
+static int  grow_cubics (SFT_Outline *outl);
 static int  grow_lines  (SFT_Outline *outl);
 /* tesselation */
-static int  is_flat(SFT_Outline *outl, SFT_Curve curve);
+static SFT_Point second_diff(SFT_Point a, SFT_Point b, SFT_Point c);
+static unsigned int num_segments(SFT_Point secondDiff, int degree);
+static int  add_segment(SFT_Outline *outl, uint_least16_t *prev, SFT_Point pt);
 static int  tesselate_curve(SFT_Curve curve, SFT_Outline *outl);
+static int  tesselate_cubic(SFT_Cubic cubic, SFT_Outline *outl);
 static int  tesselate_curves(SFT_Outline *outl);
 /* silhouette rasterization */
-static void draw_line(Raster buf, SFT_Point origin, SFT_Point goal);
+static SFT_Coord interpolate_x(SFT_Point a, SFT_Point b, SFT_Coord y);
+static int  clip_line_to_rows(Raster buf, SFT_Point *origin, SFT_Point *goal);
+static unsigned int draw_line(Raster buf, SFT_Point origin, SFT_Point goal);
 static void draw_lines(SFT_Outline *outl, Raster buf);
+static unsigned int max_cells(SFT_Outline *outl, Raster buf);
 /* post-processing */
 static void post_process(Raster buf, SFT_Image *image);
+static void post_process_sparse(Raster buf, SFT_Image *image);
 /* glyph rendering */
-// static int  render_outline(SFT_Outline *outl, float transform[6], SFT_Image image);
+// static int  render_outline(SFT_Outline *outl, SFT_Coord transform[6], SFT_Image image);
 
 /* function implementations */
 
@@ -80,18 +117,52 @@ fast_ceil(float x)
 	return i + (i < x);
 }
 
-static SFT_Point
-midpoint(SFT_Point a, SFT_Point b)
+#ifdef TTR_FIXED_POINT
+
+/* Divides, rounding to nearest. */
+static inline SFT_Coord
+div_round(int64_t num, int64_t den)
 {
-	return (SFT_Point) {
-		0.5 * (a.x + b.x),
-		0.5 * (a.y + b.y)
-	};
+	if (den < 0) {
+		num = -num;
+		den = -den;
+	}
+	return (SFT_Coord) (num >= 0 ? (num + den / 2) / den : -((-num + den / 2) / den));
 }
 
 /* Applies an affine linear transformation matrix to a set of points. */
 static void
-transform_points(unsigned int numPts, SFT_Point *points, float trf[6])
+transform_points(unsigned int numPts, SFT_Point *points, SFT_Coord trf[6])
+{
+	SFT_Point pt;
+	unsigned int i;
+	for (i = 0; i < numPts; ++i) {
+		pt = points[i];
+		points[i] = (SFT_Point) {
+			(SFT_Coord) (((int64_t) pt.x * trf[0] + (int64_t) pt.y * trf[2] + 0x8000) >> 16) + trf[4],
+			(SFT_Coord) (((int64_t) pt.x * trf[1] + (int64_t) pt.y * trf[3] + 0x8000) >> 16) + trf[5]
+		};
+	}
+}
+
+static void
+clip_points(unsigned int numPts, SFT_Point *points, int width, int height)
+{
+	const SFT_Coord maxX = (SFT_Coord) width * SFT_FIXED_ONE - 1;
+	const SFT_Coord maxY = (SFT_Coord) height * SFT_FIXED_ONE - 1;
+	unsigned int i;
+
+	for (i = 0; i < numPts; ++i) {
+		points[i].x = points[i].x < 0 ? 0 : MIN(points[i].x, maxX);
+		points[i].y = points[i].y < 0 ? 0 : MIN(points[i].y, maxY);
+	}
+}
+
+#else
+
+/* Applies an affine linear transformation matrix to a set of points. */
+static void
+transform_points(unsigned int numPts, SFT_Point *points, SFT_Coord trf[6])
 {
 	SFT_Point pt;
 	unsigned int i;
@@ -128,6 +199,8 @@ clip_points(unsigned int numPts, SFT_Point *points, int width, int height)
 	}
 }
 
+#endif
+
 int
 sft_init_outline(SFT_Outline *outl)
 {
@@ -140,6 +213,10 @@ sft_init_outline(SFT_Outline *outl)
 	outl->capCurves = 64;
 	if (!(outl->curves = malloc(outl->capCurves * sizeof *outl->curves)))
 		return -1;
+	outl->numCubics = 0;
+	outl->capCubics = 64;
+	if (!(outl->cubics = malloc(outl->capCubics * sizeof *outl->cubics)))
+		return -1;
 	outl->numLines = 0;
 	outl->capLines = 64;
 	if (!(outl->lines = malloc(outl->capLines * sizeof *outl->lines)))
@@ -147,14 +224,48 @@ sft_init_outline(SFT_Outline *outl)
 	return 0;
 }
 
+/* Empties an outline while keeping its memory for reuse. */
+void
+sft_reset_outline(SFT_Outline *outl)
+{
+	outl->numPoints = 0;
+	outl->numCurves = 0;
+	outl->numCubics = 0;
+	outl->numLines  = 0;
+}
+
 void
 sft_free_outline(SFT_Outline *outl)
 {
 	free(outl->points);
 	free(outl->curves);
+	free(outl->cubics);
 	free(outl->lines);
 }
 
+/* Copies an outline into another one, growing its memory as needed. */
+int
+sft_copy_outline(SFT_Outline *dst, const SFT_Outline *src)
+{
+	while (dst->capPoints < src->numPoints)
+		if (grow_points(dst) < 0) return -1;
+	while (dst->capCurves < src->numCurves)
+		if (grow_curves(dst) < 0) return -1;
+	while (dst->capCubics < src->numCubics)
+		if (grow_cubics(dst) < 0) return -1;
+	while (dst->capLines < src->numLines)
+		if (grow_lines(dst) < 0) return -1;
+	memcpy(dst->points, src->points, src->numPoints * sizeof *src->points);
+	memcpy(dst->curves, src->curves, src->numCurves * sizeof *src->curves);
+	memcpy(dst->cubics, src->cubics, src->numCubics * sizeof *src->cubics);
+	memcpy(dst->lines,  src->lines,  src->numLines  * sizeof *src->lines);
+	dst->numPoints = src->numPoints;
+	dst->numCurves = src->numCurves;
+	dst->numCubics = src->numCubics;
+	dst->numLines  = src->numLines;
+	return 0;
+}
+
 static int
 grow_points(SFT_Outline *outl)
 {
@@ -188,6 +299,22 @@ grow_curves(SFT_Outline *outl)
 	return 0;
 }
 
+static int
+grow_cubics(SFT_Outline *outl)
+{
+	void *mem;
+	uint_fast16_t cap;
+	assert(outl->capCubics);
+	if (outl->capCubics > UINT16_MAX / 2)
+		return -1;
+	cap = (uint_fast16_t) (2U * outl->capCubics);
+	if (!(mem = realloc(outl->cubics, cap * sizeof *outl->cubics)))
+		return -1;
+	outl->capCubics = (uint_least16_t) cap;
+	outl->cubics    = mem;
+	return 0;
+}
+
 static int
 grow_lines(SFT_Outline *outl)
 {
@@ -204,64 +331,159 @@ grow_lines(SFT_Outline *outl)
 	return 0;
 }
 
-/* A heuristic to tell whether a given curve can be approximated closely enough by a line. */
+/* Curves are flattened into as many lines as needed to stay within 1 / FLATNESS_INV pixels of
+ * the true curve, with the count worked out up front from the already transformed control points
+ * (Wang's formula). Small glyphs get few lines, large ones stay smooth. */
+#define FLATNESS_INV 10
+#define MAX_SEGMENTS 64
+
+static SFT_Point
+second_diff(SFT_Point a, SFT_Point b, SFT_Point c)
+{
+	return (SFT_Point) { a.x - 2 * b.x + c.x, a.y - 2 * b.y + c.y };
+}
+
+/* Smallest n with n^2 >= degree * (degree - 1) / 8 * |secondDiff| * FLATNESS_INV. */
+#ifdef TTR_FIXED_POINT
+static unsigned int
+num_segments(SFT_Point secondDiff, int degree)
+{
+	/* Both sides are squared to avoid the square root in the length. */
+	int64_t k = degree * (degree - 1) * FLATNESS_INV, lhs;
+	int64_t rhs = k * k * ((int64_t) secondDiff.x * secondDiff.x + (int64_t) secondDiff.y * secondDiff.y);
+	unsigned int n = 1;
+	for (; n < MAX_SEGMENTS; ++n) {
+		lhs = (int64_t) n * n * 8 * SFT_FIXED_ONE;
+		if (lhs * lhs >= rhs)
+			break;
+	}
+	return n;
+}
+#else
+static unsigned int
+num_segments(SFT_Point secondDiff, int degree)
+{
+	float n = ceilf(sqrtf(degree * (degree - 1) * FLATNESS_INV / 8.0f * hypotf(secondDiff.x, secondDiff.y)));
+	return n <= 1.0f ? 1 : n >= MAX_SEGMENTS ? MAX_SEGMENTS : (unsigned int) n;
+}
+#endif
+
+/* Appends a point, and a line to it from the previous one. */
 static int
-is_flat(SFT_Outline *outl, SFT_Curve curve)
+add_segment(SFT_Outline *outl, uint_least16_t *prev, SFT_Point pt)
 {
-	const float maxArea2 = 2.0;
-	SFT_Point a = outl->points[curve.beg];
-	SFT_Point b = outl->points[curve.ctrl];
-	SFT_Point c = outl->points[curve.end];
-	SFT_Point g = { b.x-a.x, b.y-a.y };
-	SFT_Point h = { c.x-a.x, c.y-a.y };
-	float area2 = fabs(g.x*h.y-h.x*g.y);
-	return area2 <= maxArea2;
+	uint_least16_t next = outl->numPoints;
+	if (sft_add_point(outl, pt.x, pt.y) < 0 || sft_add_line(outl, *prev, next) < 0)
+		return -1;
+	*prev = next;
+	return 0;
 }
 
+#ifdef TTR_FIXED_POINT
+
+/* Points along the curves are evaluated exactly and rounded, as forward differencing
+ * would need more precision than the coordinates have to not drift. */
 static int
 tesselate_curve(SFT_Curve curve, SFT_Outline *outl)
 {
-	/* From my tests I can conclude that this stack barely reaches a top height
-	 * of 4 elements even for the largest font sizes I'm willing to support. And
-	 * as space requirements should only grow logarithmically, I think 10 is
-	 * more than enough. */
-#define STACK_SIZE 10
-	SFT_Curve stack[STACK_SIZE];
-	unsigned int top = 0;
-	for (;;) {
-		if (is_flat(outl, curve) || top >= STACK_SIZE) {
-			if (outl->numLines >= outl->capLines && grow_lines(outl) < 0)
-				return -1;
-			outl->lines[outl->numLines++] = (SFT_Line) { curve.beg, curve.end };
-			if (top == 0) break;
-			curve = stack[--top];
-		} else {
-			uint_least16_t ctrl0 = outl->numPoints;
-			if (outl->numPoints >= outl->capPoints && grow_points(outl) < 0)
-				return -1;
-			outl->points[ctrl0] = midpoint(outl->points[curve.beg], outl->points[curve.ctrl]);
-			++outl->numPoints;
-
-			uint_least16_t ctrl1 = outl->numPoints;
-			if (outl->numPoints >= outl->capPoints && grow_points(outl) < 0)
-				return -1;
-			outl->points[ctrl1] = midpoint(outl->points[curve.ctrl], outl->points[curve.end]);
-			++outl->numPoints;
-
-			uint_least16_t pivot = outl->numPoints;
-			if (outl->numPoints >= outl->capPoints && grow_points(outl) < 0)
-				return -1;
-			outl->points[pivot] = midpoint(outl->points[ctrl0], outl->points[ctrl1]);
-			++outl->numPoints;
-
-			stack[top++] = (SFT_Curve) { curve.beg, pivot, ctrl0 };
-			curve = (SFT_Curve) { pivot, curve.end, ctrl1 };
-		}
+	SFT_Point p0 = outl->points[curve.beg];
+	SFT_Point p1 = outl->points[curve.ctrl];
+	SFT_Point p2 = outl->points[curve.end];
+	int64_t n = num_segments(second_diff(p0, p1, p2), 2), den = n * n, i, u;
+	uint_least16_t prev = curve.beg;
+	SFT_Point pt;
+
+	for (i = 1; i < n; ++i) {
+		u = n - i;
+		pt.x = div_round(u * u * p0.x + 2 * u * i * p1.x + i * i * p2.x, den);
+		pt.y = div_round(u * u * p0.y + 2 * u * i * p1.y + i * i * p2.y, den);
+		if (add_segment(outl, &prev, pt) < 0)
+			return -1;
 	}
-	return 0;
-#undef STACK_SIZE
+	return sft_add_line(outl, prev, curve.end);
+}
+
+static int
+tesselate_cubic(SFT_Cubic cubic, SFT_Outline *outl)
+{
+	SFT_Point p0 = outl->points[cubic.beg];
+	SFT_Point p1 = outl->points[cubic.ctrl1];
+	SFT_Point p2 = outl->points[cubic.ctrl2];
+	SFT_Point p3 = outl->points[cubic.end];
+	int64_t n = MAX(num_segments(second_diff(p0, p1, p2), 3), num_segments(second_diff(p1, p2, p3), 3));
+	int64_t den = n * n * n, i, u;
+	uint_least16_t prev = cubic.beg;
+	SFT_Point pt;
+
+	for (i = 1; i < n; ++i) {
+		u = n - i;
+		pt.x = div_round(u * u * u * p0.x + 3 * u * u * i * p1.x + 3 * u * i * i * p2.x + i * i * i * p3.x, den);
+		pt.y = div_round(u * u * u * p0.y + 3 * u * u * i * p1.y + 3 * u * i * i * p2.y + i * i * i * p3.y, den);
+		if (add_segment(outl, &prev, pt) < 0)
+			return -1;
+	}
+	return sft_add_line(outl, prev, cubic.end);
+}
+
+#else
+
+/* Steps along the curves by forward differencing. */
+static int
+tesselate_curve(SFT_Curve curve, SFT_Outline *outl)
+{
+	SFT_Point p0 = outl->points[curve.beg];
+	SFT_Point p1 = outl->points[curve.ctrl];
+	SFT_Point p2 = outl->points[curve.end];
+	/* p(t) = a t^2 + b t + p0 */
+	SFT_Point a = second_diff(p0, p1, p2);
+	SFT_Point b = { 2 * (p1.x - p0.x), 2 * (p1.y - p0.y) };
+	unsigned int n = num_segments(a, 2), i;
+	float h = 1.0f / n, h2 = h * h;
+	SFT_Point d1 = { a.x * h2 + b.x * h, a.y * h2 + b.y * h };
+	SFT_Point d2 = { 2 * a.x * h2, 2 * a.y * h2 };
+	SFT_Point pt = p0;
+	uint_least16_t prev = curve.beg;
+
+	for (i = 1; i < n; ++i) {
+		pt.x += d1.x; pt.y += d1.y;
+		d1.x += d2.x; d1.y += d2.y;
+		if (add_segment(outl, &prev, pt) < 0)
+			return -1;
+	}
+	return sft_add_line(outl, prev, curve.end);
+}
+
+static int
+tesselate_cubic(SFT_Cubic cubic, SFT_Outline *outl)
+{
+	SFT_Point p0 = outl->points[cubic.beg];
+	SFT_Point p1 = outl->points[cubic.ctrl1];
+	SFT_Point p2 = outl->points[cubic.ctrl2];
+	SFT_Point p3 = outl->points[cubic.end];
+	/* p(t) = a t^3 + b t^2 + c t + p0 */
+	SFT_Point a = { p3.x - p0.x + 3 * (p1.x - p2.x), p3.y - p0.y + 3 * (p1.y - p2.y) };
+	SFT_Point b = { 3 * (p0.x - 2 * p1.x + p2.x), 3 * (p0.y - 2 * p1.y + p2.y) };
+	SFT_Point c = { 3 * (p1.x - p0.x), 3 * (p1.y - p0.y) };
+	unsigned int n = MAX(num_segments(second_diff(p0, p1, p2), 3), num_segments(second_diff(p1, p2, p3), 3)), i;
+	float h = 1.0f / n, h2 = h * h, h3 = h2 * h;
+	SFT_Point d1 = { a.x * h3 + b.x * h2 + c.x * h, a.y * h3 + b.y * h2 + c.y * h };
+	SFT_Point d2 = { 6 * a.x * h3 + 2 * b.x * h2, 6 * a.y * h3 + 2 * b.y * h2 };
+	SFT_Point d3 = { 6 * a.x * h3, 6 * a.y * h3 };
+	SFT_Point pt = p0;
+	uint_least16_t prev = cubic.beg;
+
+	for (i = 1; i < n; ++i) {
+		pt.x += d1.x; pt.y += d1.y;
+		d1.x += d2.x; d1.y += d2.y;
+		d2.x += d3.x; d2.y += d3.y;
+		if (add_segment(outl, &prev, pt) < 0)
+			return -1;
+	}
+	return sft_add_line(outl, prev, cubic.end);
 }
 
+#endif
+
 static int
 tesselate_curves(SFT_Outline *outl)
 {
@@ -270,11 +492,141 @@ tesselate_curves(SFT_Outline *outl)
 		if (tesselate_curve(outl->curves[i], outl) < 0)
 			return -1;
 	}
+	for (i = 0; i < outl->numCubics; ++i) {
+		if (tesselate_cubic(outl->cubics[i], outl) < 0)
+			return -1;
+	}
 	return 0;
 }
 
-/* Draws a line into the buffer. Uses a custom 2D raycasting algorithm to do so. */
-static void
+#ifdef TTR_FIXED_POINT
+
+/* Adds to the cell of the buffer at a column and row. */
+static inline void
+add_to_cell(Raster buf, int x, int y, int32_t area, int32_t cover)
+{
+	Cell *cptr;
+	unsigned int i;
+	if (buf.rowHeads) {
+		i = (*buf.numSparse)++;
+		assert(i < buf.capSparse);
+		buf.sparse[i] = (SparseCell) { buf.rowHeads[y], x, { area, cover } };
+		buf.rowHeads[y] = (int32_t) i;
+		return;
+	}
+	cptr = &buf.cells[y * buf.width + x];
+	cptr->cover += cover;
+	cptr->area  += area;
+}
+
+/* Number of pixels from the one holding a to the one holding b, both included. */
+static inline unsigned int
+pixel_span(SFT_Coord a, SFT_Coord b)
+{
+	return (unsigned int) ((MAX(a, b) >> SFT_FIXED_SHIFT) - (MIN(a, b) >> SFT_FIXED_SHIFT)) + 1;
+}
+
+/* Accumulates a piece of a line that lies within a single row of the buffer,
+ * splitting it further at every pixel boundary it crosses. Returns the number of cells touched. */
+static unsigned int
+draw_row_segment(Raster buf, int row, SFT_Coord x0, SFT_Coord y0, SFT_Coord x1, SFT_Coord y1)
+{
+	SFT_Coord xa = x0, ya = y0, nx, ny, fx0, fx1;
+	int col;
+	unsigned int numCells = 0;
+
+	for (;;) {
+		if (x1 > xa) {
+			col = xa >> SFT_FIXED_SHIFT;
+			nx  = MIN(x1, (col + 1) * SFT_FIXED_ONE);
+		} else if (x1 < xa) {
+			col = (xa - 1) >> SFT_FIXED_SHIFT;
+			nx  = MAX(x1, col * SFT_FIXED_ONE);
+		} else {
+			col = xa >> SFT_FIXED_SHIFT;
+			nx  = x1;
+		}
+		/* Interpolate from the ends of the piece, so that rounding errors don't add up. */
+		ny = nx == x1 ? y1 : y0 + div_round((int64_t) (nx - x0) * (y1 - y0), x1 - x0);
+
+		fx0 = xa - col * SFT_FIXED_ONE;
+		fx1 = nx - col * SFT_FIXED_ONE;
+		add_to_cell(buf, col, row, (ny - ya) * (2 * SFT_FIXED_ONE - fx0 - fx1), ny - ya);
+		++numCells;
+
+		if (nx == x1) break;
+		xa = nx;
+		ya = ny;
+	}
+	return numCells;
+}
+
+/* Draws a line into the buffer, one row at a time, with integer arithmetic only.
+ * Returns the number of cells touched. */
+static unsigned int
+draw_line(Raster buf, SFT_Point origin, SFT_Point goal)
+{
+	SFT_Coord dx = goal.x - origin.x;
+	SFT_Coord dy = goal.y - origin.y;
+	SFT_Coord x = origin.x, y = origin.y, nx, ny;
+	int row;
+	unsigned int numCells = 0;
+
+	if (!dy) {
+		return 0;
+	}
+
+	while (y != goal.y) {
+		if (dy > 0) {
+			row = y >> SFT_FIXED_SHIFT;
+			ny  = MIN(goal.y, (row + 1) * SFT_FIXED_ONE);
+		} else {
+			row = (y - 1) >> SFT_FIXED_SHIFT;
+			ny  = MAX(goal.y, row * SFT_FIXED_ONE);
+		}
+		nx = ny == goal.y ? goal.x : origin.x + div_round((int64_t) (ny - origin.y) * dx, dy);
+
+		numCells += draw_row_segment(buf, row, x, y, nx, ny);
+
+		x = nx;
+		y = ny;
+	}
+	return numCells;
+}
+
+#else
+
+/* Adds to the cell of the buffer at a column and row. The area is added in double precision, like the
+ * products it is computed from. */
+static inline void
+add_to_cell(Raster buf, int x, int y, double area, float cover)
+{
+	Cell *cptr, cell;
+	unsigned int i;
+	if (buf.rowHeads) {
+		i = (*buf.numSparse)++;
+		assert(i < buf.capSparse);
+		buf.sparse[i] = (SparseCell) { buf.rowHeads[y], x, { (float) area, cover } };
+		buf.rowHeads[y] = (int32_t) i;
+		return;
+	}
+	cptr = &buf.cells[y * buf.width + x];
+	cell = *cptr;
+	cell.cover += cover;
+	cell.area  += area;
+	*cptr = cell;
+}
+
+/* Number of pixels from the one holding a to the one holding b, both included. */
+static inline unsigned int
+pixel_span(SFT_Coord a, SFT_Coord b)
+{
+	return (unsigned int) (fast_ceil(MAX(a, b)) - fast_floor(MIN(a, b))) + 1;
+}
+
+/* Draws a line into the buffer. Uses a custom 2D raycasting algorithm to do so.
+ * Returns the number of cells touched. */
+static unsigned int
 draw_line(Raster buf, SFT_Point origin, SFT_Point goal)
 {
 	SFT_Point delta;
@@ -286,7 +638,6 @@ draw_line(Raster buf, SFT_Point origin, SFT_Point goal)
 	struct { int x, y; } pixel;
 	struct { int x, y; } dir;
 	int step, numSteps = 0;
-	Cell *restrict cptr, cell;
 
 	delta.x = goal.x - origin.x;
 	delta.y = goal.y - origin.y;
@@ -294,7 +645,7 @@ draw_line(Raster buf, SFT_Point origin, SFT_Point goal)
 	dir.y = SIGN(delta.y);
 
 	if (!dir.y) {
-		return;
+		return 0;
 	}
 	
 	crossingIncr.x = dir.x ? fabs(1.0 / delta.x) : 1.0;
@@ -333,12 +684,8 @@ draw_line(Raster buf, SFT_Point origin, SFT_Point goal)
 	for (step = 0; step < numSteps; ++step) {
 		xAverage = origin.x + (prevDistance + nextDistance) * halfDeltaX;
 		yDifference = (nextDistance - prevDistance) * delta.y;
-		cptr = &buf.cells[pixel.y * buf.width + pixel.x];
-		cell = *cptr;
-		cell.cover += yDifference;
 		xAverage -= (float) pixel.x;
-		cell.area += (1.0 - xAverage) * yDifference;
-		*cptr = cell;
+		add_to_cell(buf, pixel.x, pixel.y, (1.0 - xAverage) * yDifference, yDifference);
 		prevDistance = nextDistance;
 		int alongX = nextCrossing.x < nextCrossing.y;
 		pixel.x += alongX ? dir.x : 0;
@@ -350,47 +697,257 @@ draw_line(Raster buf, SFT_Point origin, SFT_Point goal)
 
 	xAverage = origin.x + (prevDistance + 1.0) * halfDeltaX;
 	yDifference = (1.0 - prevDistance) * delta.y;
-	cptr = &buf.cells[pixel.y * buf.width + pixel.x];
-	cell = *cptr;
-	cell.cover += yDifference;
 	xAverage -= (float) pixel.x;
-	cell.area += (1.0 - xAverage) * yDifference;
-	*cptr = cell;
+	add_to_cell(buf, pixel.x, pixel.y, (1.0 - xAverage) * yDifference, yDifference);
+	return (unsigned int) numSteps + 1;
+}
+
+#endif
+
+/* Finds the x coordinate at which a line crosses a horizontal. */
+static SFT_Coord
+interpolate_x(SFT_Point a, SFT_Point b, SFT_Coord y)
+{
+#ifdef TTR_FIXED_POINT
+	return a.x + div_round((int64_t) (y - a.y) * (b.x - a.x), b.y - a.y);
+#else
+	SFT_Coord x = a.x + (y - a.y) * (b.x - a.x) / (b.y - a.y);
+	/* Rounding must not take it past the ends, which have already been clipped to the image. */
+	return MAX(MIN(x, MAX(a.x, b.x)), MIN(a.x, b.x));
+#endif
+}
+
+/* Cuts a line down to the rows held by the buffer, and moves it into their coordinates.
+ * Returns 0 if nothing of it is left. Rows of a closed outline still get all of their
+ * crossings, so their cover still adds up to zero. */
+static int
+clip_line_to_rows(Raster buf, SFT_Point *origin, SFT_Point *goal)
+{
+#ifdef TTR_FIXED_POINT
+	const SFT_Coord top    = (SFT_Coord) buf.top * SFT_FIXED_ONE;
+	const SFT_Coord bottom = (SFT_Coord) (buf.top + buf.height) * SFT_FIXED_ONE;
+#else
+	const SFT_Coord top    = (SFT_Coord) buf.top;
+	const SFT_Coord bottom = (SFT_Coord) (buf.top + buf.height);
+#endif
+	SFT_Point a = *origin, b = *goal;
+
+	if (a.y == b.y || MAX(a.y, b.y) <= top || MIN(a.y, b.y) >= bottom) {
+		return 0;
+	}
+
+	if (a.y < top) {
+		a = (SFT_Point) { interpolate_x(*origin, *goal, top), top };
+	} else if (a.y > bottom) {
+		a = (SFT_Point) { interpolate_x(*origin, *goal, bottom), bottom };
+	}
+	if (b.y < top) {
+		b = (SFT_Point) { interpolate_x(*origin, *goal, top), top };
+	} else if (b.y > bottom) {
+		b = (SFT_Point) { interpolate_x(*origin, *goal, bottom), bottom };
+	}
+
+	a.y -= top;
+	b.y -= top;
+	*origin = a;
+	*goal   = b;
+	return 1;
 }
 
 static void
 draw_lines(SFT_Outline *outl, Raster buf)
 {
-	unsigned int i;
+	unsigned int i, numCells = 0;
+	for (i = 0; i < outl->numLines; ++i) {
+		SFT_Line  line   = outl->lines[i];
+		SFT_Point origin = outl->points[line.beg];
+		SFT_Point goal   = outl->points[line.end];
+		if (clip_line_to_rows(buf, &origin, &goal)) {
+			numCells += draw_line(buf, origin, goal);
+		}
+	}
+	ttr_stats_add(raster_cells_touched, numCells);
+}
+
+/* Bounds the number of cells draw_lines touches, by the pixels each line spans along both axes. */
+static unsigned int
+max_cells(SFT_Outline *outl, Raster buf)
+{
+	unsigned int i, numCells = 0;
 	for (i = 0; i < outl->numLines; ++i) {
 		SFT_Line  line   = outl->lines[i];
 		SFT_Point origin = outl->points[line.beg];
 		SFT_Point goal   = outl->points[line.end];
-		draw_line(buf, origin, goal);
+		if (clip_line_to_rows(buf, &origin, &goal)) {
+			numCells += pixel_span(origin.x, goal.x) + pixel_span(origin.y, goal.y);
+		}
+	}
+	return numCells;
+}
+
+/* Hands the non-zero runs of a row of the final image from column begin up to end over to the image. */
+static void
+emit_spans(const uint8_t *row, int begin, int end, int y, SFT_Image *image)
+{
+	int x = begin, start;
+	for (;;) {
+		while (x < end && !row[x]) ++x;
+		if (x >= end) break;
+		start = x;
+		while (x < end && row[x]) ++x;
+		image->draw_span((unsigned int) y, (unsigned int) start, (unsigned int) (x - start), row + start, image->user_data);
 	}
 }
 
 /* Integrate the values in the buffer to arrive at the final grayscale image. */
+#ifdef TTR_FIXED_POINT
+static void
+post_process(Raster buf, SFT_Image *image)
+{
+	Cell cell, *cells = buf.cells;
+	int32_t accum = 0, value;
+	uint8_t *row;
+	int x, y;
+	for (y = 0; y < buf.height; ++y) {
+		row = image->pixels ? image->pixels + (size_t) y * buf.width : buf.row;
+		for (x = 0; x < buf.width; ++x) {
+			cell     = *cells++;
+			value    = accum * COVER_TO_AREA + cell.area;
+			value    = value < 0 ? -value : value;
+			value    = MIN(value, FULL_AREA);
+			accum   += cell.cover;
+			row[x]   = (uint8_t) ((value * 255 + FULL_AREA / 2) / FULL_AREA);
+		}
+		if (!image->pixels) {
+			emit_spans(row, 0, buf.width, buf.top + y, image);
+		}
+	}
+}
+#else
 static void
 post_process(Raster buf, SFT_Image *image)
 {
+	Cell cell, *cells;
+	float accum = 0.0f, *area;
+	uint8_t *row;
+	int x, y;
+	for (y = 0; y < buf.height; ++y) {
+		/* The running sum has to stay sequential to be reproducible, so it is computed here
+		 * and written back over the front of the row (area[x] aliases cells[x / 2], which has
+		 * already been read). The conversion to coverage is then done a whole row at a time. */
+		cells = buf.cells + (size_t) y * buf.width;
+		area  = (float *) cells;
+		for (x = 0; x < buf.width; ++x) {
+			cell     = cells[x];
+			area[x]  = accum + cell.area;
+			accum   += cell.cover;
+		}
+		row = image->pixels ? image->pixels + (size_t) y * buf.width : buf.row;
+		ttr_coverage_from_area(area, row, (unsigned int) buf.width);
+		if (!image->pixels) {
+			emit_spans(row, 0, buf.width, buf.top + y, image);
+		}
+	}
+}
+#endif
+
+static int
+compare_cells(const void *a, const void *b)
+{
+	return ((const SparseCell *) a)->x - ((const SparseCell *) b)->x;
+}
+
+/* Sorts the cells of a row by column. Short rows are sorted in place, keeping the order cells were added in. */
+static void
+sort_cells(SparseCell *cells, int numCells)
+{
+	SparseCell cell;
+	int i, j;
+	if (numCells > 16) {
+		qsort(cells, (size_t) numCells, sizeof *cells, compare_cells);
+		return;
+	}
+	for (i = 1; i < numCells; ++i) {
+		cell = cells[i];
+		for (j = i; j > 0 && cells[j - 1].x > cell.x; --j) {
+			cells[j] = cells[j - 1];
+		}
+		cells[j] = cell;
+	}
+}
+
+/* Like post_process, but only integrating the cells of each row, from the first one to the last one. Pixels
+ * between cells take the cover accumulated so far, and rows without cells are skipped. */
+static void
+post_process_sparse(Raster buf, SFT_Image *image)
+{
+	SparseCell *sorted = buf.sorted;
 	Cell cell;
-	float accum = 0.0, value;
-	unsigned int i, num;
-	num = (unsigned int) buf.width * (unsigned int) buf.height;
-	for (i = 0; i < num; ++i) {
-		cell     = buf.cells[i];
-		value    = fabs(accum + cell.area);
-		value    = MIN(value, 1.0);
-		value    = value * 255.0 + 0.5;
-		accum   += cell.cover;
+	uint8_t *row;
+	int32_t i;
+	int y, x, col, k, numCells, begin;
+#ifdef TTR_FIXED_POINT
+	int32_t accum, value;
+#else
+	float accum;
+#endif
+	for (y = 0; y < buf.height; ++y) {
+		row = image->pixels ? image->pixels + (size_t) y * buf.width : buf.row;
+		if (buf.rowHeads[y] < 0) {
+			if (image->pixels) {
+				memset(row, 0, (size_t) buf.width);
+			}
+			continue;
+		}
 
-		image->draw_pixel_at(i % image->width, i / image->width, (uint8_t)value, image->user_data);
+		/* Lists are most recent first, so they are copied backwards. */
+		numCells = 0;
+		for (i = buf.rowHeads[y]; i >= 0; i = buf.sparse[i].next) ++numCells;
+		k = numCells;
+		for (i = buf.rowHeads[y]; i >= 0; i = buf.sparse[i].next) sorted[--k] = buf.sparse[i];
+		sort_cells(sorted, numCells);
+
+		begin = x = sorted[0].x;
+		accum = 0;
+		for (k = 0; k < numCells;) {
+			col  = sorted[k].x;
+			cell = sorted[k].cell;
+			for (++k; k < numCells && sorted[k].x == col; ++k) {
+				cell.area  += sorted[k].cell.area;
+				cell.cover += sorted[k].cell.cover;
+			}
+#ifdef TTR_FIXED_POINT
+			value = accum * COVER_TO_AREA;
+			value = value < 0 ? -value : value;
+			value = MIN(value, FULL_AREA);
+			memset(row + x, (value * 255 + FULL_AREA / 2) / FULL_AREA, (size_t) (col - x));
+			value = accum * COVER_TO_AREA + cell.area;
+			value = value < 0 ? -value : value;
+			value = MIN(value, FULL_AREA);
+			row[col] = (uint8_t) ((value * 255 + FULL_AREA / 2) / FULL_AREA);
+#else
+			for (; x < col; ++x) buf.area[x] = accum;
+			buf.area[col] = accum + cell.area;
+#endif
+			accum += cell.cover;
+			x = col + 1;
+		}
+#ifndef TTR_FIXED_POINT
+		ttr_coverage_from_area(buf.area + begin, row + begin, (unsigned int) (x - begin));
+#endif
+
+		/* The cover of a row of a closed outline adds up to zero, so nothing is left past its last cell. */
+		if (image->pixels) {
+			memset(row, 0, (size_t) begin);
+			memset(row + x, 0, (size_t) (buf.width - x));
+		} else {
+			emit_spans(row, begin, x, buf.top + y, image);
+		}
 	}
 }
 
 int
-sft_add_point(SFT_Outline *outl, float x, float y)
+sft_add_point(SFT_Outline *outl, SFT_Coord x, SFT_Coord y)
 {
 	if (outl->numPoints >= outl->capPoints && grow_points(outl) < 0) {
 		return -1;
@@ -411,6 +968,17 @@ sft_add_curve(SFT_Outline *outl, uint_least16_t beg, uint_least16_t ctrl, uint_l
 	return 0;
 }
 
+int
+sft_add_cubic(SFT_Outline *outl, uint_least16_t beg, uint_least16_t ctrl1, uint_least16_t ctrl2, uint_least16_t end)
+{
+	if (outl->numCubics >= outl->capCubics && grow_cubics(outl) < 0) {
+		return -1;
+	}
+
+	outl->cubics[outl->numCubics++] = (SFT_Cubic) { beg, end, ctrl1, ctrl2 };
+	return 0;
+}
+
 int
 sft_add_line(SFT_Outline *outl, uint_least16_t beg, uint_least16_t end)
 {
@@ -422,37 +990,107 @@ sft_add_line(SFT_Outline *outl, uint_least16_t beg, uint_least16_t end)
 	return 0;
 }
 
+void
+sft_free_scratch(SFT_Scratch *scratch)
+{
+	free(scratch->memory);
+	scratch->memory = NULL;
+	scratch->size   = 0;
+}
+
 int
-sft_render_outline(SFT_Outline *outl, float transform[6], SFT_Image image)
+sft_render_outline(SFT_Outline *outl, SFT_Coord transform[6], SFT_Image image, SFT_Scratch *scratch)
 {
+	SFT_Scratch local = { NULL, 0 };
 	Cell *cells = NULL;
 	Raster buf;
-	unsigned int numPixels;
+	unsigned int numPixels, numPoints, numSparse = 0;
+	int rowBeg, rowEnd;
+	size_t size, sparseSize;
+	char *mem;
 
-	numPixels = (unsigned int) image.width * (unsigned int) image.height;
+	if (!scratch) {
+		scratch = &local;
+	}
 
-	cells = malloc(numPixels * sizeof *cells);
-	if (!cells) {
-		return -1;
+	rowBeg = MAX(image.rowBeg, 0);
+	rowEnd = MIN(image.rowEnd, image.height);
+	if (rowBeg >= rowEnd) {
+		return 0;
 	}
-	memset(cells, 0, numPixels * sizeof *cells);
-	buf.cells  = cells;
-	buf.width  = image.width;
-	buf.height = image.height;
 
 	transform_points(outl->numPoints, outl->points, transform);
 
 	clip_points(outl->numPoints, outl->points, image.width, image.height);
 
+	numPoints = outl->numPoints;
 	if (tesselate_curves(outl) < 0) {
-		free(cells);
 		return -1;
 	}
+	/* Points on the curves lie within their clipped control points, but rounding may push them just outside. */
+	clip_points(outl->numPoints - numPoints, outl->points + numPoints, image.width, image.height);
+
+	ttr_stats_add(outline_points, outl->numPoints);
+	ttr_stats_add(outline_lines, outl->numLines);
+
+	memset(&buf, 0, sizeof buf);
+	buf.width  = image.width;
+	buf.height = rowEnd - rowBeg;
+	buf.top    = rowBeg;
+
+	numPixels = (unsigned int) image.width * (unsigned int) (rowEnd - rowBeg);
+
+	/* One row of 8-bit coverage is kept after the cells to collect spans in. A sparse raster keeps a list
+	 * head per row, the cells touched, room to sort a row of them and a row of area instead of a cell per
+	 * pixel, and is used when that's well under the size of the dense one, so that memory and the time spent
+	 * clearing and integrating it grow with the outline rather than the box of the glyph. */
+	size = numPixels * sizeof *cells + (unsigned int) image.width;
+	sparseSize = 0;
+	if (numPixels >= SPARSE_MIN_PIXELS) {
+		buf.capSparse = max_cells(outl, buf);
+		sparseSize = (size_t) buf.height * sizeof (int32_t) + (size_t) buf.capSparse * 2 * sizeof (SparseCell)
+			+ (unsigned int) image.width * (sizeof (float) + 1);
+	}
+	if (sparseSize && sparseSize < size / 2) {
+		size = sparseSize;
+	} else {
+		sparseSize = 0;
+	}
+
+	if (size > scratch->size) {
+		if (!(mem = realloc(scratch->memory, size))) {
+			return -1;
+		}
+		ttr_stats_add(raster_bytes_allocated, size - scratch->size);
+		scratch->memory = mem;
+		scratch->size   = size;
+	}
+	mem = scratch->memory;
+
+	if (sparseSize) {
+		buf.rowHeads  = (int32_t *) mem;
+		buf.sparse    = (SparseCell *) (buf.rowHeads + buf.height);
+		buf.sorted    = buf.sparse + buf.capSparse;
+		buf.area      = (float *) (buf.sorted + buf.capSparse);
+		buf.row       = (uint8_t *) (buf.area + image.width);
+		buf.numSparse = &numSparse;
+		memset(buf.rowHeads, 0xff, (size_t) buf.height * sizeof (int32_t));
+		ttr_stats_add(raster_sparse_glyphs, 1);
+	} else {
+		cells = (Cell *) mem;
+		memset(cells, 0, numPixels * sizeof *cells);
+		buf.cells = cells;
+		buf.row   = (uint8_t *) (cells + numPixels);
+	}
 
 	draw_lines(outl, buf);
 
-	post_process(buf, &image);
+	if (sparseSize) {
+		post_process_sparse(buf, &image);
+	} else {
+		post_process(buf, &image);
+	}
 
-	free(cells);
+	sft_free_scratch(&local);
 	return 0;
 }
@@ -24,47 +24,85 @@
 extern "C" {
 #endif
 
+#ifdef TTR_FIXED_POINT
+/* Coordinates in 22.10 fixed point. Four bits finer than HarfBuzz's 26.6 units,
+ * which keeps the output within one coverage level of the floating point rasterizer. */
+#define SFT_FIXED_SHIFT 10
+#define SFT_FIXED_ONE   (1 << SFT_FIXED_SHIFT)
+typedef int32_t SFT_Coord;
+#else
+typedef float   SFT_Coord;
+#endif
+
 typedef struct SFT_Image    SFT_Image;
+typedef struct SFT_Scratch  SFT_Scratch;
 
 typedef struct SFT_Outline  SFT_Outline;
 typedef struct SFT_Point   SFT_Point;
 typedef struct SFT_Line    SFT_Line;
 typedef struct SFT_Curve   SFT_Curve;
+typedef struct SFT_Cubic   SFT_Cubic;
 
 struct SFT_Image
 {
 	int   width;
 	int   height;
+	/* Only rows from rowBeg up to rowEnd are rasterized and handed over. */
+	int   rowBeg;
+	int   rowEnd;
 
-	void (*draw_pixel_at)(unsigned int x, unsigned int y, uint8_t mask, void* user_data);
+	/* Called for each horizontal run of pixels with non-zero coverage. */
+	void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t *coverage, void *user_data);
 	void* user_data;
+
+	/* When not NULL, whole rows are written there instead of handed over, from rowBeg, width bytes apart. */
+	uint8_t *pixels;
 };
 
-struct SFT_Point { float x, y; };
+/* Memory the rasterizer works in, grown as needed and kept across calls. */
+struct SFT_Scratch
+{
+	void  *memory;
+	size_t size;
+};
+
+struct SFT_Point { SFT_Coord x, y; };
 struct SFT_Line  { uint_least16_t beg, end; };
 struct SFT_Curve { uint_least16_t beg, end, ctrl; };
+struct SFT_Cubic { uint_least16_t beg, end, ctrl1, ctrl2; };
 
 struct SFT_Outline
 {
 	SFT_Point *points;
 	SFT_Curve *curves;
+	SFT_Cubic *cubics;
 	SFT_Line  *lines;
 	uint_least16_t numPoints;
 	uint_least16_t capPoints;
 	uint_least16_t numCurves;
 	uint_least16_t capCurves;
+	uint_least16_t numCubics;
+	uint_least16_t capCubics;
 	uint_least16_t numLines;
 	uint_least16_t capLines;
 };
 
 int  sft_init_outline(SFT_Outline *outl);
+void sft_reset_outline(SFT_Outline *outl);
 void sft_free_outline(SFT_Outline *outl);
+int  sft_copy_outline(SFT_Outline *dst, const SFT_Outline *src);
+
+void sft_free_scratch(SFT_Scratch *scratch);
 
-int sft_add_point(SFT_Outline *outl, float x, float y);
+int sft_add_point(SFT_Outline *outl, SFT_Coord x, SFT_Coord y);
 int sft_add_curve(SFT_Outline *outl, uint_least16_t beg, uint_least16_t ctrl, uint_least16_t end);
+int sft_add_cubic(SFT_Outline *outl, uint_least16_t beg, uint_least16_t ctrl1, uint_least16_t ctrl2, uint_least16_t end);
 int sft_add_line(SFT_Outline *outl, uint_least16_t beg, uint_least16_t end);
 
-int sft_render_outline(SFT_Outline *outl, float transform[6], SFT_Image image);
+/* With TTR_FIXED_POINT, the linear part of the transform (the first four entries) is in 16.16 fixed point,
+ * and the translation (the last two) in 22.10 like all coordinates. */
+/* scratch may be NULL, in which case the working memory is allocated for this call only. */
+int sft_render_outline(SFT_Outline *outl, SFT_Coord transform[6], SFT_Image image, SFT_Scratch *scratch);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,587 @@
+#include "sdf.h"
+#include "context.h"
+#include "mutex.h"
+#include "scale.h"
+#include "schrift.h"
+#include "stats.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+
+// Outlines are decoded at the base size like any other, and measured in pixels of that size.
+#ifdef TTR_FIXED_POINT
+#define sdf_coord(value) ((double)(value) / SFT_FIXED_ONE)
+#else
+#define sdf_coord(value) ((double)(value))
+#endif
+
+// Quadratics each cubic is approximated with, which is exact enough for the distances fields are encoded with.
+#define SDF_CUBIC_PIECES 4
+
+// Spans are handed over from a buffer of this many pixels at most.
+#define SDF_SPAN_PIXELS 256
+
+typedef struct sdf_cache_entry sdf_cache_entry;
+
+struct sdf_cache_entry {
+    sdf_cache_entry* next;
+    hb_codepoint_t glyph;
+
+    // Distances point into the memory following the entry.
+    ttr_sdf_glyph_t field;
+    uint8_t distances[];
+};
+
+struct ttr_sdf_cache_t {
+    ttr_mutex_t mutex;
+
+    // Font scale the fields are generated at, in 26.6 units like `hb_font_get_scale`.
+    int scale;
+    // Distance in pixels of the base size at which fields are clamped.
+    unsigned int spread;
+
+    sdf_cache_entry** buckets;
+    unsigned int bucket_mask;
+    unsigned int count;
+};
+
+// A line from 0 to 2, or a quadratic through control point 1, with y pointing down.
+typedef struct sdf_segment {
+    double x0, y0, x1, y1, x2, y2;
+    bool curve;
+    // Box around the segment and its control point, which the segment never leaves.
+    double min_x, min_y, max_x, max_y;
+} sdf_segment;
+
+static hb_user_data_key_t sdf_cache_key;
+
+static void ttr_destroy_sdf_cache(void* user_data) {
+    ttr_sdf_cache_t* cache = (ttr_sdf_cache_t*)user_data;
+
+    for (unsigned int i = 0; i <= cache->bucket_mask; i++) {
+        sdf_cache_entry* entry = cache->buckets[i];
+        while (entry) {
+            sdf_cache_entry* next = entry->next;
+            free(entry);
+            entry = next;
+        }
+    }
+
+    ttr_mutex_destroy(&cache->mutex);
+    free(cache->buckets);
+    free(cache);
+}
+
+void ttr_face_enable_sdf(hb_face_t* face, unsigned int base_size, unsigned int spread) {
+    if (base_size == 0 || spread == 0 || hb_face_get_user_data(face, &sdf_cache_key)) {
+        return;
+    }
+
+    ttr_sdf_cache_t* cache = calloc(1, sizeof(ttr_sdf_cache_t));
+    if (!cache) {
+        return;
+    }
+
+    unsigned int bucket_count = 64;
+    cache->buckets = calloc(bucket_count, sizeof(sdf_cache_entry*));
+    if (!cache->buckets) {
+        free(cache);
+        return;
+    }
+
+    if (ttr_mutex_init(&cache->mutex) != 0) {
+        free(cache->buckets);
+        free(cache);
+        return;
+    }
+
+    cache->bucket_mask = bucket_count - 1;
+    cache->scale = ttr_scale_up(base_size);
+    cache->spread = spread;
+
+    if (!hb_face_set_user_data(face, &sdf_cache_key, cache, ttr_destroy_sdf_cache, false)) {
+        ttr_destroy_sdf_cache(cache);
+    }
+}
+
+ttr_sdf_cache_t* ttr_font_get_sdf_cache(hb_font_t* font) {
+    unsigned int coords_length;
+    hb_font_get_var_coords_normalized(font, &coords_length);
+    if (coords_length > 0) {
+        // Fields are those of the default instance.
+        return NULL;
+    }
+
+    return (ttr_sdf_cache_t*)hb_face_get_user_data(hb_font_get_face(font), &sdf_cache_key);
+}
+
+static unsigned int sdf_cache_hash(hb_codepoint_t glyph) {
+    uint32_t hash = glyph * 0x9E3779B1u;
+    return hash ^ (hash >> 16);
+}
+
+// Doubles the number of buckets, keeping chains short as more glyphs get cached.
+static void sdf_cache_grow(ttr_sdf_cache_t* cache) {
+    unsigned int bucket_count = (cache->bucket_mask + 1) * 2;
+    sdf_cache_entry** buckets = calloc(bucket_count, sizeof(sdf_cache_entry*));
+    if (!buckets) {
+        return;
+    }
+
+    for (unsigned int i = 0; i <= cache->bucket_mask; i++) {
+        sdf_cache_entry* entry = cache->buckets[i];
+        while (entry) {
+            sdf_cache_entry* next = entry->next;
+            unsigned int bucket = sdf_cache_hash(entry->glyph) & (bucket_count - 1);
+            entry->next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_mask = bucket_count - 1;
+}
+
+static void sdf_add_segment(sdf_segment* segments, unsigned int* count, double x0, double y0, double x1, double y1, double x2, double y2, bool curve) {
+    sdf_segment* segment = &segments[(*count)++];
+    *segment = (sdf_segment) { x0, y0, x1, y1, x2, y2, curve, min(x0, x2), min(y0, y2), max(x0, x2), max(y0, y2) };
+    if (curve) {
+        segment->min_x = min(segment->min_x, x1);
+        segment->min_y = min(segment->min_y, y1);
+        segment->max_x = max(segment->max_x, x1);
+        segment->max_y = max(segment->max_y, y1);
+    }
+}
+
+// Split a cubic into quadratics, each with its control point where the tangents at the ends of a piece meet on
+// average, which is exact at the ends and off by a small fraction of a pixel in between.
+static void sdf_add_cubic(sdf_segment* segments, unsigned int* count, const double p[8]) {
+    double prev_x = p[0], prev_y = p[1];
+    double prev_dx = 3 * (p[2] - p[0]), prev_dy = 3 * (p[3] - p[1]);
+
+    for (int piece = 1; piece <= SDF_CUBIC_PIECES; piece++) {
+        double t = (double)piece / SDF_CUBIC_PIECES, s = 1 - t;
+
+        double x = s * s * s * p[0] + 3 * s * s * t * p[2] + 3 * s * t * t * p[4] + t * t * t * p[6];
+        double y = s * s * s * p[1] + 3 * s * s * t * p[3] + 3 * s * t * t * p[5] + t * t * t * p[7];
+        double dx = 3 * (s * s * (p[2] - p[0]) + 2 * s * t * (p[4] - p[2]) + t * t * (p[6] - p[4]));
+        double dy = 3 * (s * s * (p[3] - p[1]) + 2 * s * t * (p[5] - p[3]) + t * t * (p[7] - p[5]));
+
+        // Control points of this piece as a cubic, and the quadratic closest to it.
+        double step = 1.0 / SDF_CUBIC_PIECES / 3;
+        double c1_x = prev_x + prev_dx * step, c1_y = prev_y + prev_dy * step;
+        double c2_x = x - dx * step, c2_y = y - dy * step;
+        double control_x = (3 * (c1_x + c2_x) - prev_x - x) / 4;
+        double control_y = (3 * (c1_y + c2_y) - prev_y - y) / 4;
+
+        sdf_add_segment(segments, count, prev_x, prev_y, control_x, control_y, x, y, true);
+
+        prev_x = x;
+        prev_y = y;
+        prev_dx = dx;
+        prev_dy = dy;
+    }
+}
+
+static double sdf_line_distance_squared(const sdf_segment* segment, double x, double y) {
+    double dx = segment->x2 - segment->x0, dy = segment->y2 - segment->y0;
+    double length_squared = dx * dx + dy * dy;
+
+    double t = 0;
+    if (length_squared > 0) {
+        t = ((x - segment->x0) * dx + (y - segment->y0) * dy) / length_squared;
+        t = min(max(t, 0.0), 1.0);
+    }
+
+    double ex = segment->x0 + t * dx - x, ey = segment->y0 + t * dy - y;
+    return ex * ex + ey * ey;
+}
+
+// Real roots of t^3 + a t^2 + b t + c.
+static int sdf_solve_cubic(double a, double b, double c, double roots[3]) {
+    double a3 = a / 3;
+    double p = b - a * a3;
+    double q = 2 * a3 * a3 * a3 - a3 * b + c;
+    double discriminant = q * q / 4 + p * p * p / 27;
+
+    if (discriminant >= 0) {
+        double root = sqrt(discriminant);
+        roots[0] = cbrt(-q / 2 + root) + cbrt(-q / 2 - root) - a3;
+        return 1;
+    }
+
+    double r = sqrt(-p / 3);
+    double phi = acos(min(max(3 * q / (2 * p) / r, -1.0), 1.0)) / 3;
+    for (int k = 0; k < 3; k++) {
+        roots[k] = 2 * r * cos(phi - 2 * M_PI * k / 3) - a3;
+    }
+    return 3;
+}
+
+// The nearest point of a quadratic is where the vector to it is normal to the curve, a cubic in t, or an end.
+static double sdf_curve_distance_squared(const sdf_segment* segment, double x, double y) {
+    double ax = segment->x1 - segment->x0, ay = segment->y1 - segment->y0;
+    double bx = segment->x2 - 2 * segment->x1 + segment->x0, by = segment->y2 - 2 * segment->y1 + segment->y0;
+    double mx = segment->x0 - x, my = segment->y0 - y;
+
+    double bb = bx * bx + by * by;
+    if (bb < 1e-12) {
+        // The control point is halfway between the ends.
+        return sdf_line_distance_squared(segment, x, y);
+    }
+
+    double roots[5];
+    int count = sdf_solve_cubic(3 * (ax * bx + ay * by) / bb, (2 * (ax * ax + ay * ay) + mx * bx + my * by) / bb, (mx * ax + my * ay) / bb, roots);
+    roots[count++] = 0;
+    roots[count++] = 1;
+
+    double best = INFINITY;
+    for (int i = 0; i < count; i++) {
+        double t = min(max(roots[i], 0.0), 1.0);
+        double ex = mx + t * (2 * ax + t * bx), ey = my + t * (2 * ay + t * by);
+        best = min(best, ex * ex + ey * ey);
+    }
+    return best;
+}
+
+// Winding of a part of a quadratic where y only grows or only shrinks, from `t0` to `t1`, around a point.
+static int sdf_curve_part_winding(const sdf_segment* segment, double t0, double t1, double x, double y) {
+    double a = segment->y0 - 2 * segment->y1 + segment->y2;
+    double b = 2 * (segment->y1 - segment->y0);
+    double c = segment->y0;
+
+    double y0 = (a * t0 + b) * t0 + c, y1 = (a * t1 + b) * t1 + c;
+    if ((y0 <= y) == (y1 <= y)) {
+        return 0;
+    }
+
+    double t;
+    if (fabs(a) < 1e-12) {
+        t = (y - c) / b;
+    } else {
+        double root = sqrt(max(b * b - 4 * a * (c - y), 0.0));
+        t = (-b - root) / (2 * a);
+        if (t < t0 - 1e-9 || t > t1 + 1e-9) {
+            t = (-b + root) / (2 * a);
+        }
+    }
+    t = min(max(t, t0), t1);
+
+    double s = 1 - t;
+    double crossing = s * s * segment->x0 + 2 * s * t * segment->x1 + t * t * segment->x2;
+    if (crossing <= x) {
+        return 0;
+    }
+    return y1 > y0 ? 1 : -1;
+}
+
+// Winding of a segment around a point, counted where it crosses the ray from the point towards positive x.
+static int sdf_segment_winding(const sdf_segment* segment, double x, double y) {
+    if (y < segment->min_y || y >= segment->max_y || x >= segment->max_x) {
+        return 0;
+    }
+
+    if (!segment->curve) {
+        if ((segment->y0 <= y) == (segment->y2 <= y)) {
+            return 0;
+        }
+        double crossing = segment->x0 + (y - segment->y0) * (segment->x2 - segment->x0) / (segment->y2 - segment->y0);
+        if (crossing <= x) {
+            return 0;
+        }
+        return segment->y2 > segment->y0 ? 1 : -1;
+    }
+
+    // Split where the curve turns back vertically.
+    double denominator = segment->y0 - 2 * segment->y1 + segment->y2;
+    double turn = denominator != 0 ? (segment->y0 - segment->y1) / denominator : -1;
+    if (turn > 0 && turn < 1) {
+        return sdf_curve_part_winding(segment, 0, turn, x, y) + sdf_curve_part_winding(segment, turn, 1, x, y);
+    }
+    return sdf_curve_part_winding(segment, 0, 1, x, y);
+}
+
+// Signed distance from a point to the outline, positive inside as filled with the nonzero rule, clamped to
+// `limit` since nothing further is encoded.
+static double sdf_distance(const sdf_segment* segments, unsigned int count, double x, double y, double limit) {
+    double best = limit * limit;
+    int winding = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        const sdf_segment* segment = &segments[i];
+
+        winding += sdf_segment_winding(segment, x, y);
+
+        // Skip segments whose box is further than the nearest point found so far.
+        double dx = max(max(segment->min_x - x, x - segment->max_x), 0.0);
+        double dy = max(max(segment->min_y - y, y - segment->max_y), 0.0);
+        if (dx * dx + dy * dy >= best) {
+            continue;
+        }
+
+        best = min(best, segment->curve ? sdf_curve_distance_squared(segment, x, y) : sdf_line_distance_squared(segment, x, y));
+    }
+
+    double distance = sqrt(best);
+    return winding != 0 ? distance : -distance;
+}
+
+static sdf_cache_entry* sdf_cache_generate(ttr_sdf_cache_t* cache, ttr_context_t* ctx, hb_font_t* font, hb_codepoint_t glyph) {
+    hb_font_t* base_font = hb_font_create(hb_font_get_face(font));
+    hb_font_set_scale(base_font, cache->scale, cache->scale);
+
+    SFT_Outline* outline = &ctx->outline;
+    sft_reset_outline(outline);
+    hb_font_draw_glyph(base_font, glyph, ctx->draw_funcs, outline);
+
+    hb_font_destroy(base_font);
+
+    unsigned int segment_count = 0;
+    sdf_segment* segments = malloc(((size_t)outline->numLines + outline->numCurves + (size_t)outline->numCubics * SDF_CUBIC_PIECES + 1) * sizeof(sdf_segment));
+    if (!segments) {
+        return NULL;
+    }
+
+    // Flip y so that fields are laid out like pixels.
+    const SFT_Point* points = outline->points;
+    for (unsigned int i = 0; i < outline->numLines; i++) {
+        const SFT_Line* line = &outline->lines[i];
+        sdf_add_segment(segments, &segment_count,
+            sdf_coord(points[line->beg].x), -sdf_coord(points[line->beg].y), 0, 0,
+            sdf_coord(points[line->end].x), -sdf_coord(points[line->end].y), false);
+    }
+    for (unsigned int i = 0; i < outline->numCurves; i++) {
+        const SFT_Curve* curve = &outline->curves[i];
+        sdf_add_segment(segments, &segment_count,
+            sdf_coord(points[curve->beg].x), -sdf_coord(points[curve->beg].y),
+            sdf_coord(points[curve->ctrl].x), -sdf_coord(points[curve->ctrl].y),
+            sdf_coord(points[curve->end].x), -sdf_coord(points[curve->end].y), true);
+    }
+    for (unsigned int i = 0; i < outline->numCubics; i++) {
+        const SFT_Cubic* cubic = &outline->cubics[i];
+        const double p[8] = {
+            sdf_coord(points[cubic->beg].x), -sdf_coord(points[cubic->beg].y),
+            sdf_coord(points[cubic->ctrl1].x), -sdf_coord(points[cubic->ctrl1].y),
+            sdf_coord(points[cubic->ctrl2].x), -sdf_coord(points[cubic->ctrl2].y),
+            sdf_coord(points[cubic->end].x), -sdf_coord(points[cubic->end].y)
+        };
+        sdf_add_cubic(segments, &segment_count, p);
+    }
+
+    ttr_sdf_glyph_t field = { 0 };
+    if (segment_count > 0) {
+        double min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+        for (unsigned int i = 0; i < segment_count; i++) {
+            min_x = min(min_x, segments[i].min_x);
+            min_y = min(min_y, segments[i].min_y);
+            max_x = max(max_x, segments[i].max_x);
+            max_y = max(max_y, segments[i].max_y);
+        }
+
+        // Leave room around the outline for the distances outside of it.
+        field.left = (int)floor(min_x) - (int)cache->spread;
+        field.top = (int)floor(min_y) - (int)cache->spread;
+        field.width = (unsigned int)((int)ceil(max_x) + (int)cache->spread - field.left);
+        field.height = (unsigned int)((int)ceil(max_y) + (int)cache->spread - field.top);
+    }
+
+    sdf_cache_entry* entry = malloc(sizeof(sdf_cache_entry) + (size_t)field.width * field.height);
+    if (!entry) {
+        free(segments);
+        return NULL;
+    }
+
+    ttr_stats_timer(start);
+
+    double spread = cache->spread;
+    uint8_t* distances = entry->distances;
+    for (unsigned int row = 0; row < field.height; row++) {
+        double y = field.top + (int)row + 0.5;
+        for (unsigned int column = 0; column < field.width; column++) {
+            double x = field.left + (int)column + 0.5;
+            double distance = sdf_distance(segments, segment_count, x, y, spread);
+            int value = (int)floor(128 + distance * 127 / spread + 0.5);
+            *distances++ = min(max(value, 0), 255);
+        }
+    }
+
+    ttr_stats_add_time(rasterize_ns, start);
+
+    free(segments);
+
+    entry->glyph = glyph;
+    entry->field = field;
+    entry->field.distances = entry->distances;
+
+    return entry;
+}
+
+static sdf_cache_entry* sdf_cache_find(ttr_sdf_cache_t* cache, hb_codepoint_t glyph) {
+    sdf_cache_entry* entry = cache->buckets[sdf_cache_hash(glyph) & cache->bucket_mask];
+    while (entry && entry->glyph != glyph) {
+        entry = entry->next;
+    }
+    return entry;
+}
+
+const ttr_sdf_glyph_t* ttr_sdf_cache_get(ttr_sdf_cache_t* cache, ttr_context_t* ctx, hb_font_t* font, hb_codepoint_t glyph) {
+    ttr_mutex_lock(&cache->mutex);
+    sdf_cache_entry* entry = sdf_cache_find(cache, glyph);
+    ttr_mutex_unlock(&cache->mutex);
+
+    if (entry) {
+        ttr_stats_add(sdf_cache_hits, 1);
+
+        // Entries live as long as the cache, so can be used without holding the lock.
+        return &entry->field;
+    }
+
+    ttr_stats_add(sdf_cache_misses, 1);
+
+    entry = sdf_cache_generate(cache, ctx, font, glyph);
+    if (!entry) {
+        return NULL;
+    }
+
+    ttr_mutex_lock(&cache->mutex);
+
+    sdf_cache_entry* existing = sdf_cache_find(cache, glyph);
+    if (existing) {
+        // Another thread generated the same glyph in the meantime.
+        free(entry);
+        entry = existing;
+    } else {
+        if (cache->count >= (cache->bucket_mask + 1) * 2) {
+            sdf_cache_grow(cache);
+        }
+
+        unsigned int bucket = sdf_cache_hash(glyph) & cache->bucket_mask;
+        entry->next = cache->buckets[bucket];
+        cache->buckets[bucket] = entry;
+        cache->count++;
+    }
+
+    ttr_mutex_unlock(&cache->mutex);
+
+    return &entry->field;
+}
+
+static long long sdf_floor_div(long long value, long long divisor) {
+    long long quotient = value / divisor;
+    return quotient * divisor > value ? quotient - 1 : quotient;
+}
+
+static inline unsigned int sdf_texel(const ttr_sdf_glyph_t* glyph, const uint8_t* row, int column) {
+    return row && column >= 0 && (unsigned int)column < glyph->width ? row[column] : 0;
+}
+
+void ttr_sdf_draw_glyph(
+    const ttr_sdf_cache_t* cache,
+    const ttr_sdf_glyph_t* glyph,
+    hb_font_t* font,
+    int pen_x,
+    int pen_y,
+    unsigned int softness,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data)
+{
+    if (glyph->width == 0 || glyph->height == 0) {
+        return;
+    }
+
+    int x_scale, y_scale;
+    hb_font_get_scale(font, &x_scale, &y_scale);
+    if (x_scale <= 0 || y_scale <= 0) {
+        return;
+    }
+
+    const long long base = cache->scale;
+
+    // Pixels covered by the field once scaled, in font scale and then in pixels.
+    long long box_left = pen_x + sdf_floor_div((long long)glyph->left * x_scale * 64, base);
+    long long box_top = pen_y + sdf_floor_div((long long)glyph->top * y_scale * 64, base);
+    long long box_right = pen_x + sdf_floor_div(((long long)glyph->left + glyph->width) * x_scale * 64, base);
+    long long box_bottom = pen_y + sdf_floor_div(((long long)glyph->top + glyph->height) * y_scale * 64, base);
+
+    int x_begin = max((long long)left, sdf_floor_div(box_left, 64));
+    int y_begin = max((long long)top, sdf_floor_div(box_top, 64));
+    int x_end = min((long long)right, sdf_floor_div(box_right + 63, 64));
+    int y_end = min((long long)bottom, sdf_floor_div(box_bottom + 63, 64));
+    if (x_begin >= x_end || y_begin >= y_end) {
+        return;
+    }
+
+    // Coverage is 0.5 on the edge, and changes by 1 every `softness` pixels, for each of the 127 steps of a field
+    // value per `spread` pixels of the base size, scaled. Fields are never sampled softer than they can encode, so
+    // that pixels beyond the spread stay empty.
+    long long gain = (long long)cache->spread * 255 * (x_scale + y_scale) * 32 * 65536 / ((long long)127 * base * max(softness, 1u));
+    gain = max(gain, 255LL * 256);
+
+    // Position in the field of the center of the first pixel drawn, and the step between pixels, in 16.16.
+    long long step_x = 65536 * base / x_scale;
+    long long step_y = 65536 * base / y_scale;
+    long long field_x = sdf_floor_div(((long long)x_begin * 64 + 32 - pen_x) * 1024 * base, x_scale) - (long long)glyph->left * 65536 - 32768;
+    long long field_y = sdf_floor_div(((long long)y_begin * 64 + 32 - pen_y) * 1024 * base, y_scale) - (long long)glyph->top * 65536 - 32768;
+
+    uint8_t coverage[SDF_SPAN_PIXELS];
+
+    for (int y = y_begin; y < y_end; y++, field_y += step_y) {
+        int row = (int)(field_y >> 16);
+        unsigned int fraction_y = field_y & 0xffff;
+
+        const uint8_t* row0 = row >= 0 && (unsigned int)row < glyph->height ? glyph->distances + (size_t)row * glyph->width : NULL;
+        const uint8_t* row1 = row + 1 >= 0 && (unsigned int)(row + 1) < glyph->height ? glyph->distances + (size_t)(row + 1) * glyph->width : NULL;
+        if (!row0 && !row1) {
+            continue;
+        }
+
+        long long position = field_x;
+        int span_start = 0, length = 0;
+        for (int x = x_begin; x < x_end; x++, position += step_x) {
+            int column = (int)(position >> 16);
+            unsigned int fraction_x = position & 0xffff;
+
+            // Bilinear filtering, rows in 8.16 and their blend in 8.8.
+            unsigned int upper = sdf_texel(glyph, row0, column) * (65536 - fraction_x) + sdf_texel(glyph, row0, column + 1) * fraction_x;
+            unsigned int lower = sdf_texel(glyph, row1, column) * (65536 - fraction_x) + sdf_texel(glyph, row1, column + 1) * fraction_x;
+            long long value = ((long long)upper * (65536 - fraction_y) + (long long)lower * fraction_y) >> 24;
+
+            long long alpha = ((value - 32768) * gain + (255LL << 23)) >> 24;
+            alpha = min(max(alpha, 0), 255);
+
+            // Hand over runs of pixels with coverage, starting a new one when the buffer is full.
+            if (alpha > 0 && length < SDF_SPAN_PIXELS) {
+                if (length == 0) {
+                    span_start = x;
+                }
+                coverage[length++] = alpha;
+                continue;
+            }
+
+            if (length > 0) {
+                draw_span(y, span_start, length, coverage, user_data);
+                length = 0;
+            }
+            if (alpha > 0) {
+                span_start = x;
+                coverage[length++] = alpha;
+            }
+        }
+
+        if (length > 0) {
+            draw_span(y, span_start, length, coverage, user_data);
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef TTR_SDF_H
+#define TTR_SDF_H 1
+
+#include <stdint.h>
+#include <hb.h>
+
+#include "tiny_text_renderer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ttr_sdf_cache_t ttr_sdf_cache_t;
+
+/**
+ * Signed distance field of a glyph at the base size of a cache.
+ *
+ * Each byte is the distance from the center of a pixel to the nearest point of the outline, 128 on the edge, higher
+ * inside, and 127 steps for each `spread` pixels, clamped.
+ */
+typedef struct ttr_sdf_glyph_t {
+    // Top left of the field relative to the pen, in pixels of the base size with y pointing down.
+    int left;
+    int top;
+    unsigned int width;
+    unsigned int height;
+    const uint8_t* distances;
+} ttr_sdf_glyph_t;
+
+/**
+ * Get the distance field cache to use when drawing with a font.
+ *
+ * @param font The font.
+ * @return The cache enabled on the font's face with `ttr_face_enable_sdf`, or NULL if there is none or the font
+ * can't use it because it has variations set.
+ */
+ttr_sdf_cache_t* ttr_font_get_sdf_cache(hb_font_t* font);
+
+/**
+ * Get the distance field of a glyph, generating and caching it on first use.
+ *
+ * @param cache The cache.
+ * @param ctx Context holding the working memory to decode the outline in.
+ * @param font Any font of the face the cache belongs to.
+ * @param glyph Glyph id.
+ * @return The cached field, valid until the face is destroyed, or NULL on allocation failure.
+ */
+const ttr_sdf_glyph_t* ttr_sdf_cache_get(ttr_sdf_cache_t* cache, ttr_context_t* ctx, hb_font_t* font, hb_codepoint_t glyph);
+
+/**
+ * Draw a glyph by sampling its distance field, scaled from the base size of the cache to the scale of `font`.
+ *
+ * @param cache The cache the field belongs to.
+ * @param glyph The field.
+ * @param font The font the glyph is drawn with.
+ * @param pen_x Pen position of the glyph in font scale, offsets included.
+ * @param pen_y Pen position of the glyph in font scale with y pointing down, offsets included.
+ * @param softness Width of the edge in 64ths of a pixel.
+ * @param left Left of the pixels that can be drawn to.
+ * @param top Top of the pixels that can be drawn to.
+ * @param right Right of the pixels that can be drawn to, excluded.
+ * @param bottom Bottom of the pixels that can be drawn to, excluded.
+ * @param draw_span Callback to draw a horizontal run of pixels with non-zero coverage, in destination pixels.
+ * @param user_data User data to pass to the callback.
+ */
+void ttr_sdf_draw_glyph(
+    const ttr_sdf_cache_t* cache,
+    const ttr_sdf_glyph_t* glyph,
+    hb_font_t* font,
+    int pen_x,
+    int pen_y,
+    unsigned int softness,
+    int left,
+    int top,
+    int right,
+    int bottom,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_SDF_H */
@@ -0,0 +1,41 @@
+#include "stats.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef TTR_ENABLE_STATS
+#include <time.h>
+
+ttr_stats_t ttr_stats;
+
+unsigned long long ttr_stats_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+// All fields are counters of the same type, read and written one at a time.
+#define TTR_STATS_FIELDS (sizeof(ttr_stats_t) / sizeof(unsigned long long))
+
+void ttr_get_stats(ttr_stats_t* stats) {
+    unsigned long long* from = (unsigned long long*)&ttr_stats;
+    unsigned long long* to = (unsigned long long*)stats;
+    for (size_t i = 0; i < TTR_STATS_FIELDS; i++) {
+        to[i] = __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+    }
+}
+
+void ttr_reset_stats(void) {
+    unsigned long long* fields = (unsigned long long*)&ttr_stats;
+    for (size_t i = 0; i < TTR_STATS_FIELDS; i++) {
+        __atomic_store_n(&fields[i], 0, __ATOMIC_RELAXED);
+    }
+}
+#else
+void ttr_get_stats(ttr_stats_t* stats) {
+    memset(stats, 0, sizeof(ttr_stats_t));
+}
+
+void ttr_reset_stats(void) {
+}
+#endif
@@ -0,0 +1,38 @@
+#ifndef TTR_STATS_H
+#define TTR_STATS_H 1
+
+#include "tiny_text_renderer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Instrumentation, compiled out unless `TTR_ENABLE_STATS` is defined.
+ *
+ * `ttr_stats_add(counter, value)` adds to a field of `ttr_stats_t`, safe to call from any thread.
+ * `ttr_stats_timer(name)` declares a timer started now, and `ttr_stats_add_time(counter, name)` adds the
+ * nanoseconds passed since then to a field.
+ */
+#ifdef TTR_ENABLE_STATS
+extern ttr_stats_t ttr_stats;
+
+/**
+ * Get a monotonic time in nanoseconds.
+ */
+unsigned long long ttr_stats_now(void);
+
+#define ttr_stats_add(counter, value) __atomic_fetch_add(&ttr_stats.counter, (value), __ATOMIC_RELAXED)
+#define ttr_stats_timer(name) unsigned long long name = ttr_stats_now()
+#define ttr_stats_add_time(counter, timer) ttr_stats_add(counter, ttr_stats_now() - (timer))
+#else
+#define ttr_stats_add(counter, value) ((void)0)
+#define ttr_stats_timer(name)
+#define ttr_stats_add_time(counter, timer) ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_STATS_H */
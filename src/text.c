@@ -0,0 +1,391 @@
+#include "text.h"
+#include "metrics.h"
+#include "scale.h"
+#include "stats.h"
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define max(a, b) ({ \
+    typeof(a) _a = (a); \
+    typeof(b) _b = (b); \
+    _a > _b ? _a : _b; \
+})
+
+#define min(a, b) ({ \
+    typeof(a) _a = (a); \
+    typeof(b) _b = (b); \
+    _a < _b ? _a : _b; \
+})
+
+// Pixel box of what changed, grown as glyphs are added, and empty while left > right.
+typedef struct dirty_bounds {
+    int left;
+    int top;
+    int right;
+    int bottom;
+} dirty_bounds;
+
+static int text_reserve_glyphs(ttr_text_glyphs_t* glyphs, unsigned int count) {
+    if (count <= glyphs->capacity && glyphs->info) {
+        return 0;
+    }
+
+    unsigned int capacity = max(count, max(glyphs->capacity * 2, 16u));
+    hb_glyph_info_t* info = realloc(glyphs->info, capacity * sizeof(hb_glyph_info_t));
+    if (!info) {
+        return -1;
+    }
+    glyphs->info = info;
+
+    hb_glyph_position_t* pos = realloc(glyphs->pos, capacity * sizeof(hb_glyph_position_t));
+    if (!pos) {
+        return -1;
+    }
+    glyphs->pos = pos;
+
+    hb_glyph_extents_t* extents = realloc(glyphs->extents, capacity * sizeof(hb_glyph_extents_t));
+    if (!extents) {
+        return -1;
+    }
+    glyphs->extents = extents;
+
+    glyphs->capacity = capacity;
+    return 0;
+}
+
+static bool text_unsafe_to_break(const ttr_text_glyphs_t* glyphs, unsigned int index) {
+    return index < glyphs->count && (hb_glyph_info_get_glyph_flags(&glyphs->info[index]) & HB_GLYPH_FLAG_UNSAFE_TO_BREAK);
+}
+
+// First glyph of the cluster before the one starting at `index`.
+static unsigned int text_previous_cluster(const ttr_text_glyphs_t* glyphs, unsigned int index) {
+    if (index == 0) {
+        return 0;
+    }
+    uint32_t cluster = glyphs->info[index - 1].cluster;
+    while (index > 0 && glyphs->info[index - 1].cluster == cluster) {
+        index--;
+    }
+    return index;
+}
+
+// First glyph of the cluster after the one starting at `index`.
+static unsigned int text_next_cluster(const ttr_text_glyphs_t* glyphs, unsigned int index) {
+    if (index >= glyphs->count) {
+        return glyphs->count;
+    }
+    uint32_t cluster = glyphs->info[index].cluster;
+    while (index < glyphs->count && glyphs->info[index].cluster == cluster) {
+        index++;
+    }
+    return index;
+}
+
+static bool text_same_glyph(const ttr_text_glyphs_t* a, unsigned int i, const ttr_text_glyphs_t* b, unsigned int j) {
+    return a->info[i].codepoint == b->info[j].codepoint
+        && a->pos[i].x_offset == b->pos[j].x_offset
+        && a->pos[i].y_offset == b->pos[j].y_offset;
+}
+
+// Grow `dirty` by the pixels glyph `index` covers with its pen at `pen_x`, with a pixel of margin for the rounding
+// of glyphs drawn from caches.
+static void text_add_dirty_glyph(const ttr_text_t* text, dirty_bounds* dirty, const ttr_text_glyphs_t* glyphs, unsigned int index, int pen_x) {
+    const hb_glyph_extents_t* extents = &glyphs->extents[index];
+    if (extents->width == 0 || extents->height == 0) {
+        return;
+    }
+
+    const hb_glyph_position_t* pos = &glyphs->pos[index];
+    int baseline = ttr_scale_up(ttr_scale_down_round(text->ascender));
+
+    int x = pen_x + pos->x_offset + extents->x_bearing;
+    int y = baseline - pos->y_offset - extents->y_bearing;
+
+    dirty->left = min(dirty->left, ttr_scale_down_floor(x) - 1);
+    dirty->right = max(dirty->right, ttr_scale_down_ceil(x + extents->width) + 1);
+    dirty->top = min(dirty->top, ttr_scale_down_floor(y) - 1);
+    dirty->bottom = max(dirty->bottom, ttr_scale_down_ceil(y - extents->height) + 1);
+}
+
+// Find the pixels that differ between the glyphs drawn before and after an update. Glyphs at the start and end that
+// are the same at the same position are skipped; every other glyph of both is added.
+static void text_find_dirty(const ttr_text_t* text, const ttr_text_glyphs_t* before, int before_advance, const ttr_text_glyphs_t* after, int after_advance, ttr_rect_t* rect) {
+    unsigned int start = 0;
+    int before_start_pen = 0;
+    int after_start_pen = 0;
+    while (start < before->count && start < after->count && text_same_glyph(before, start, after, start)
+           && before->pos[start].x_advance == after->pos[start].x_advance) {
+        before_start_pen += before->pos[start].x_advance;
+        after_start_pen += after->pos[start].x_advance;
+        start++;
+    }
+    // Glyph `start` may be the same with another advance, which only moves the glyphs after it.
+    if (start < before->count && start < after->count && text_same_glyph(before, start, after, start)) {
+        before_start_pen += before->pos[start].x_advance;
+        after_start_pen += after->pos[start].x_advance;
+        start++;
+    }
+
+    unsigned int before_end = before->count;
+    unsigned int after_end = after->count;
+    int before_pen = before_advance;
+    int after_pen = after_advance;
+    while (before_end > start && after_end > start) {
+        int before_glyph_pen = before_pen - before->pos[before_end - 1].x_advance;
+        int after_glyph_pen = after_pen - after->pos[after_end - 1].x_advance;
+        if (before_glyph_pen != after_glyph_pen || !text_same_glyph(before, before_end - 1, after, after_end - 1)) {
+            break;
+        }
+        before_pen = before_glyph_pen;
+        after_pen = after_glyph_pen;
+        before_end--;
+        after_end--;
+    }
+
+    dirty_bounds dirty = { INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+
+    for (unsigned int i = start; i < before_end; i++) {
+        text_add_dirty_glyph(text, &dirty, before, i, before_start_pen);
+        before_start_pen += before->pos[i].x_advance;
+    }
+    for (unsigned int i = start; i < after_end; i++) {
+        text_add_dirty_glyph(text, &dirty, after, i, after_start_pen);
+        after_start_pen += after->pos[i].x_advance;
+    }
+
+    if (dirty.left >= dirty.right || dirty.top >= dirty.bottom) {
+        *rect = (ttr_rect_t) { 0 };
+        return;
+    }
+
+    dirty.left = max(dirty.left, 0);
+    dirty.top = max(dirty.top, 0);
+    *rect = (ttr_rect_t) {
+        .x = dirty.left,
+        .y = dirty.top,
+        .width = max(dirty.right - dirty.left, 0),
+        .height = max(dirty.bottom - dirty.top, 0),
+    };
+}
+
+ttr_text_t* ttr_create_text(hb_font_t* font) {
+    ttr_text_t* text = calloc(1, sizeof(ttr_text_t));
+    if (!text) {
+        return NULL;
+    }
+
+    text->run.font = hb_font_reference(font);
+    text->run.buffer = hb_buffer_create();
+    text->run.direction = HB_DIRECTION_LTR;
+
+    hb_font_extents_t extents;
+    hb_font_get_h_extents(font, &extents);
+    text->ascender = extents.ascender;
+    text->descender = -extents.descender;
+
+    if (text_reserve_glyphs(&text->glyphs[0], 0) != 0 || text_reserve_glyphs(&text->glyphs[1], 0) != 0) {
+        ttr_destroy_text(text);
+        return NULL;
+    }
+
+    return text;
+}
+
+void ttr_destroy_text(ttr_text_t* text) {
+    if (!text) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < 2; i++) {
+        free(text->glyphs[i].info);
+        free(text->glyphs[i].pos);
+        free(text->glyphs[i].extents);
+    }
+    free(text->content);
+    hb_buffer_destroy(text->run.buffer);
+    hb_font_destroy(text->run.font);
+    free(text);
+}
+
+int ttr_text_set(ttr_text_t* text, const char* content, ttr_rect_t* dirty) {
+    unsigned int length = strlen(content);
+    unsigned int old_length = text->length;
+
+    unsigned int prefix = 0;
+    while (prefix < old_length && prefix < length && text->content[prefix] == content[prefix]) {
+        prefix++;
+    }
+    if (text->shaped && prefix == old_length && prefix == length) {
+        if (dirty) {
+            *dirty = (ttr_rect_t) { 0 };
+        }
+        return 0;
+    }
+
+    unsigned int suffix = 0;
+    while (suffix < old_length - prefix && suffix < length - prefix
+           && text->content[old_length - 1 - suffix] == content[length - 1 - suffix]) {
+        suffix++;
+    }
+
+    if (length + 1 > text->content_capacity) {
+        unsigned int capacity = max(length + 1, text->content_capacity * 2);
+        char* buffer = realloc(text->content, capacity);
+        if (!buffer) {
+            return -1;
+        }
+        text->content = buffer;
+        text->content_capacity = capacity;
+    }
+
+    const ttr_text_glyphs_t* before = &text->glyphs[text->current];
+    ttr_text_glyphs_t* after = &text->glyphs[!text->current];
+    hb_buffer_t* buffer = text->run.buffer;
+
+    // Glyphs of the content before the update to shape again, and the bytes they were shaped from.
+    unsigned int glyph_start = 0;
+    unsigned int glyph_end = before->count;
+    unsigned int segment_start = 0;
+    unsigned int segment_end = old_length;
+
+    // Glyphs of left to right text are in the order of their clusters, so a changed segment can be shaped apart.
+    // It starts a cluster before the change and ends a cluster after it, so that glyphs kerned or joined with the
+    // ones changed are shaped again, and grows while HarfBuzz reports glyphs that can't be shaped apart.
+    bool incremental = text->shaped && text->props.direction == HB_DIRECTION_LTR && before->count > 0;
+    if (incremental) {
+        glyph_start = 0;
+        while (glyph_start < before->count && before->info[glyph_start].cluster < prefix) {
+            glyph_start++;
+        }
+        while (glyph_start > 0 && (glyph_start == before->count || before->info[glyph_start].cluster > prefix)) {
+            glyph_start = text_previous_cluster(before, glyph_start);
+        }
+        glyph_start = text_previous_cluster(before, glyph_start);
+        while (glyph_start > 0 && text_unsafe_to_break(before, glyph_start)) {
+            glyph_start = text_previous_cluster(before, glyph_start);
+        }
+
+        glyph_end = glyph_start;
+        while (glyph_end < before->count && before->info[glyph_end].cluster < old_length - suffix) {
+            glyph_end++;
+        }
+        glyph_end = text_next_cluster(before, glyph_end);
+        while (text_unsafe_to_break(before, glyph_end)) {
+            glyph_end = text_next_cluster(before, glyph_end);
+        }
+
+        segment_start = before->info[glyph_start].cluster;
+        segment_end = glyph_end < before->count ? before->info[glyph_end].cluster : old_length;
+    }
+
+    // Bytes after the changed segment moved by the difference in length.
+    int delta = (int)length - (int)old_length;
+
+    hb_buffer_clear_contents(buffer);
+    hb_buffer_add_utf8(buffer, content, length, segment_start, segment_end + delta - segment_start);
+    hb_buffer_guess_segment_properties(buffer);
+
+    if (incremental) {
+        // A segment bringing in another script changes how the whole content is shaped.
+        hb_script_t script = hb_buffer_get_script(buffer);
+        if (script != HB_SCRIPT_INVALID && script != text->props.script) {
+            incremental = false;
+            glyph_start = 0;
+            glyph_end = before->count;
+            segment_start = 0;
+            hb_buffer_clear_contents(buffer);
+            hb_buffer_add_utf8(buffer, content, length, 0, length);
+            hb_buffer_guess_segment_properties(buffer);
+        } else {
+            hb_buffer_set_segment_properties(buffer, &text->props);
+        }
+    }
+
+    ttr_stats_timer(shape_start);
+    hb_shape(text->run.font, buffer, NULL, 0);
+    ttr_stats_add_time(shape_ns, shape_start);
+    ttr_stats_add(shape_calls, 1);
+
+    unsigned int segment_count;
+    const hb_glyph_info_t* segment_info = hb_buffer_get_glyph_infos(buffer, &segment_count);
+    const hb_glyph_position_t* segment_pos = hb_buffer_get_glyph_positions(buffer, &segment_count);
+
+    unsigned int suffix_count = before->count - glyph_end;
+    if (text_reserve_glyphs(after, glyph_start + segment_count + suffix_count) != 0) {
+        return -1;
+    }
+
+    memcpy(after->info, before->info, glyph_start * sizeof(hb_glyph_info_t));
+    memcpy(after->pos, before->pos, glyph_start * sizeof(hb_glyph_position_t));
+    memcpy(after->extents, before->extents, glyph_start * sizeof(hb_glyph_extents_t));
+
+    if (segment_count > 0) {
+        memcpy(&after->info[glyph_start], segment_info, segment_count * sizeof(hb_glyph_info_t));
+        memcpy(&after->pos[glyph_start], segment_pos, segment_count * sizeof(hb_glyph_position_t));
+    }
+
+    ttr_stats_timer(extents_start);
+    ttr_metrics_table_t* metrics = ttr_font_get_metrics_table(text->run.font);
+    for (unsigned int i = glyph_start; i < glyph_start + segment_count; i++) {
+        ttr_metrics_get(metrics, text->run.font, after->info[i].codepoint, &after->extents[i]);
+    }
+    ttr_stats_add_time(extents_ns, extents_start);
+
+    unsigned int suffix_start = glyph_start + segment_count;
+    memcpy(&after->info[suffix_start], &before->info[glyph_end], suffix_count * sizeof(hb_glyph_info_t));
+    memcpy(&after->pos[suffix_start], &before->pos[glyph_end], suffix_count * sizeof(hb_glyph_position_t));
+    memcpy(&after->extents[suffix_start], &before->extents[glyph_end], suffix_count * sizeof(hb_glyph_extents_t));
+    for (unsigned int i = suffix_start; i < suffix_start + suffix_count; i++) {
+        after->info[i].cluster += delta;
+    }
+
+    after->count = suffix_start + suffix_count;
+
+    if (!incremental) {
+        hb_buffer_get_segment_properties(buffer, &text->props);
+        text->run.direction = text->props.direction;
+    }
+
+    int advance = 0;
+    int x_max = 0;
+    for (unsigned int i = 0; i < after->count; i++) {
+        if (after->extents[i].width != 0) {
+            x_max = max(x_max, advance + after->pos[i].x_offset + after->extents[i].x_bearing + after->extents[i].width);
+        }
+        advance += after->pos[i].x_advance;
+    }
+
+    if (dirty) {
+        text_find_dirty(text, before, text->advance, after, advance, dirty);
+    }
+
+    text->advance = advance;
+    text->x_max = x_max;
+    memmove(text->content, content, length + 1);
+    text->length = length;
+    text->current = !text->current;
+    text->shaped = true;
+
+    text->run.glyph_count = after->count;
+    text->run.glyph_info = after->info;
+    text->run.glyph_pos = after->pos;
+    text->run.glyph_extents = after->extents;
+
+    return 0;
+}
+
+void ttr_text_measure(const ttr_text_t* text, unsigned int *width, unsigned int *height, unsigned int *baseline) {
+    if (width != NULL) {
+        *width = ttr_scale_down_ceil(max(text->advance, text->x_max));
+    }
+    if (height != NULL) {
+        *height = ttr_scale_down_ceil(text->ascender + text->descender);
+    }
+    if (baseline != NULL) {
+        *baseline = ttr_scale_down_round(text->ascender);
+    }
+}
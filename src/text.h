@@ -0,0 +1,50 @@
+#ifndef TTR_TEXT_H
+#define TTR_TEXT_H 1
+
+#include <stdbool.h>
+#include <hb.h>
+
+#include "tiny_text_renderer.h"
+#include "run.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ttr_text_glyphs_t {
+    hb_glyph_info_t* info;
+    hb_glyph_position_t* pos;
+    hb_glyph_extents_t* extents;
+    unsigned int count;
+    unsigned int capacity;
+} ttr_text_glyphs_t;
+
+struct ttr_text_t {
+    // Run pointing at the current glyphs, with the buffer segments are shaped in.
+    ttr_run_t run;
+
+    // Properties the whole content was last shaped with, that changed segments are shaped with as well.
+    hb_segment_properties_t props;
+    bool shaped;
+
+    char* content;
+    unsigned int length;
+    unsigned int content_capacity;
+
+    // Glyphs of the current and previous content, swapped on each update.
+    ttr_text_glyphs_t glyphs[2];
+    unsigned int current;
+
+    // Distance from the top to the baseline and from the baseline to the bottom, and right edge of the advances
+    // and of the ink, in font scale.
+    int ascender;
+    int descender;
+    int advance;
+    int x_max;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_TEXT_H */
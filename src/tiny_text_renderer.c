@@ -1,11 +1,25 @@
 #include "tiny_text_renderer.h"
 
+#include <limits.h>
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "scale.h"
 #include "glyph.h"
+#include "glyph_cache.h"
+#include "atlas.h"
+#include "blit.h"
+#include "context.h"
+#include "run.h"
+#include "paragraph.h"
+#include "text.h"
+#include "pack.h"
+#include "font_chain.h"
+#include "utf8.h"
+#include "sdf.h"
+#include "stats.h"
 
 #define max(a, b) ({ \
     typeof(a) _a = (a); \
@@ -23,9 +37,7 @@
 hb_font_t* ttr_create_font(const char* font_data, unsigned int font_data_size, unsigned int height) {
     hb_blob_t *blob = hb_blob_create((const char*)font_data, font_data_size, HB_MEMORY_MODE_READONLY, NULL, NULL);
     hb_face_t *face = hb_face_create(blob, 0);
-    hb_font_t *font = hb_font_create(face);
-
-    hb_font_set_scale(font, ttr_scale_up(height), ttr_scale_up(height));
+    hb_font_t *font = ttr_create_font_for_face(face, height);
 
     hb_blob_destroy(blob);
     hb_face_destroy(face);
@@ -33,178 +45,920 @@ hb_font_t* ttr_create_font(const char* font_data, unsigned int font_data_size, u
     return font;
 }
 
+hb_font_t* ttr_create_font_for_face(hb_face_t* face, unsigned int height) {
+    hb_font_t *font = hb_font_create(face);
+
+    hb_font_set_scale(font, ttr_scale_up(height), ttr_scale_up(height));
+
+    return font;
+}
+
 void ttr_destroy_font(hb_font_t* font) {
     hb_font_destroy(font);
 }
 
 
-static void ttr_measure_internal(hb_font_t *font, hb_direction_t direction, unsigned int glyph_count, hb_glyph_info_t *glyph_info, hb_glyph_position_t *glyph_pos, unsigned int *width, unsigned int *height, unsigned int *baseline) {
-    bool calculate_width_height = (width != NULL && height != NULL);
-    bool calculate_baseline = (baseline != NULL);
+ttr_run_t* ttr_context_shape_text(ttr_context_t* ctx, hb_font_t* font, const char *text) {
+    ttr_run_t* run = &ctx->run;
+
+    run->font = font;
+    if (ttr_run_shape(run, text) != 0) {
+        return NULL;
+    }
+
+    return run;
+}
+
+void ttr_measure_text(ttr_context_t* ctx, hb_font_t* font, const char *text, unsigned int *width, unsigned int *height, unsigned int *baseline) {
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
+        return;
+    }
+
+    ttr_run_t* run = ttr_context_shape_text(ctx, font, text);
+    if (run) {
+        ttr_run_measure(run, width, height, baseline);
+    }
+
+    ttr_destroy_context(owned_ctx);
+}
+
+// Pixels of the destination that can be drawn, right and bottom edges excluded.
+typedef struct clip_bounds {
+    int left;
+    int top;
+    int right;
+    int bottom;
+} clip_bounds;
+
+typedef struct draw_glyph_span_data {
+    clip_bounds bounds;
+
+    int offset_x;
+    int offset_y;
+
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data);
+    void* user_data;
+} draw_glyph_span_data;
 
-    int x_min = 0, x_max = 0;
-    int y_min = 0, y_max = 0;
+static void ttr_draw_glyph_span(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data) {
+    draw_glyph_span_data* data = (draw_glyph_span_data*)user_data;
 
-    // if (calculate_baseline) {
-    //     hb_font_extents_t extents;
-    //     if (hb_font_get_h_extents(font, &extents)) {
-    //         *baseline = extents.ascender;
-    //         calculate_baseline = false;
-    //     }
-    // }
+    const clip_bounds* bounds = &data->bounds;
 
-    if (!calculate_width_height && !calculate_baseline) {
+    const int image_y = (int)y + data->offset_y;
+    if (image_y < bounds->top || image_y >= bounds->bottom) {
         return;
     }
 
-    int cursor_x = 0;
-    int cursor_y = 0;
-    for (unsigned int i = 0; i < glyph_count; i++) {
+    int image_x = (int)x_start + data->offset_x;
+    if (image_x < bounds->left) {
+        // Positive, and taken in unsigned arithmetic so that it can't overflow.
+        const unsigned int skip = (unsigned int)bounds->left - (unsigned int)image_x;
+        if (len <= skip) {
+            return;
+        }
+        coverage += skip;
+        len -= skip;
+        image_x = bounds->left;
+    }
+    if (image_x >= bounds->right) {
+        return;
+    }
+    len = min(len, (unsigned int)(bounds->right - image_x));
+
+    data->draw_span(image_y, image_x, len, coverage, data->user_data);
+}
+
+// Intersect the destination with `clip`, returning false if nothing can be drawn.
+static bool ttr_clip_bounds_init(clip_bounds* bounds, unsigned int width, unsigned int height, const ttr_rect_t* clip) {
+    // A width or height of 0 doesn't limit drawing along that axis.
+    *bounds = (clip_bounds) { 0, 0, width > 0 ? (int)width : INT_MAX, height > 0 ? (int)height : INT_MAX };
+    if (clip) {
+        bounds->left = max(bounds->left, (int)min(clip->x, (unsigned int)INT_MAX));
+        bounds->top = max(bounds->top, (int)min(clip->y, (unsigned int)INT_MAX));
+        bounds->right = min(bounds->right, (int)min((unsigned long long)clip->x + clip->width, (unsigned long long)INT_MAX));
+        bounds->bottom = min(bounds->bottom, (int)min((unsigned long long)clip->y + clip->height, (unsigned long long)INT_MAX));
+    }
+    return bounds->left < bounds->right && bounds->top < bounds->bottom;
+}
+
+// Draw glyphs `start` to `end` of a run from the pen position `cursor_x`, `cursor_y` in font scale, copying them
+// from `atlas` if not NULL, or else from the glyph cache of the font if any.
+static void ttr_run_draw_glyph_range(
+    ttr_context_t* ctx,
+    ttr_atlas_t* atlas,
+    const ttr_run_t* run,
+    unsigned int start,
+    unsigned int end,
+    int cursor_x,
+    int cursor_y,
+    const clip_bounds* bounds,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data)
+{
+    hb_font_t* font = run->font;
+    hb_glyph_info_t *glyph_info = run->glyph_info;
+    hb_glyph_position_t *glyph_pos = run->glyph_pos;
+
+    ttr_glyph_cache_t* cache = atlas ? NULL : ttr_font_get_glyph_cache(font);
+
+    ttr_stats_add(glyphs_drawn, end - start);
+
+    for (unsigned int i = start; i < end; i++) {
         hb_codepoint_t glyphid  = glyph_info[i].codepoint;
+        hb_glyph_extents_t extents = run->glyph_extents[i];
 
-        hb_glyph_extents_t extents;
-        if (hb_font_get_glyph_extents(font, glyphid, &extents)) {
-            y_min = min(y_min, cursor_y + glyph_pos[i].y_offset + extents.y_bearing + extents.height);
-            y_max = max(y_max, cursor_y + glyph_pos[i].y_offset + extents.y_bearing);
+        int glyph_start_x = cursor_x + glyph_pos[i].x_offset + extents.x_bearing;
+        int glyph_start_y = cursor_y - glyph_pos[i].y_offset - extents.y_bearing;
 
-            x_min = min(x_min, cursor_x + glyph_pos[i].x_offset + extents.x_bearing);
-            x_max = max(x_max, cursor_x + glyph_pos[i].x_offset + extents.x_bearing + extents.width);
+        if (cache || atlas) {
+            // Limit the number of distinct subpixel offsets a glyph is cached at.
+            glyph_start_x = ttr_round_scaled_to_phase(glyph_start_x, TTR_GLYPH_CACHE_SUBPIXEL_PHASES);
+            glyph_start_y = ttr_round_scaled_to_phase(glyph_start_y, TTR_GLYPH_CACHE_SUBPIXEL_PHASES);
         }
 
         cursor_x += glyph_pos[i].x_advance;
         cursor_y += glyph_pos[i].y_advance;
-    }
 
-    if (calculate_width_height) {
-        *width = ttr_scale_down_ceil(x_max - x_min);
-        *height = ttr_scale_down_ceil(y_max - y_min);
-    }
+        unsigned int fraction_x = ttr_fraction_scaled(glyph_start_x);
+        unsigned int fraction_y = ttr_fraction_scaled(glyph_start_y);
+
+        draw_glyph_span_data data = {
+            .bounds = *bounds,
+            .offset_x = ttr_scale_down_floor(glyph_start_x),
+            .offset_y = ttr_scale_down_floor(glyph_start_y),
+            .draw_span = draw_span,
+            .user_data = user_data
+        };
 
-    if (calculate_baseline) {
-        if (HB_DIRECTION_IS_VERTICAL(direction)) {
-            *baseline = ttr_scale_down_round(-x_min);
+        // Skip glyphs out of bounds before their outline is decoded.
+        unsigned int glyph_width, glyph_height;
+        ttr_glyph_bitmap_size(extents, fraction_x, fraction_y, &glyph_width, &glyph_height);
+        if (data.offset_x >= bounds->right || data.offset_x + (int)glyph_width <= bounds->left
+            || data.offset_y >= bounds->bottom || data.offset_y + (int)glyph_height <= bounds->top) {
+            continue;
+        }
+
+        if (atlas) {
+            ttr_draw_atlas_glyph(atlas, ctx, font, glyphid, extents, fraction_x, fraction_y, ttr_draw_glyph_span, &data);
+        } else if (cache) {
+            ttr_draw_cached_glyph(cache, ctx, font, glyphid, extents, fraction_x, fraction_y, ttr_draw_glyph_span, &data);
         } else {
-            *baseline = ttr_scale_down_round(y_max);
+            // Only rasterize the rows within bounds.
+            unsigned int row_begin = max(bounds->top - data.offset_y, 0);
+            unsigned int row_end = (unsigned int)bounds->bottom - data.offset_y;
+            ttr_draw_glyph_rows(ctx, font, glyphid, extents, fraction_x, fraction_y, row_begin, row_end, ttr_draw_glyph_span, &data);
         }
     }
 }
 
-void ttr_measure_text(hb_font_t* font, const char *text, unsigned int *width, unsigned int *height, unsigned int *baseline) {
-    hb_buffer_t *buf = hb_buffer_create();
-    hb_buffer_add_utf8(buf, text, -1, 0, -1);
+// Draw the glyphs of a run, copying them from `atlas` if not NULL, or else from the glyph cache of the font if any.
+static void ttr_run_draw_glyphs(
+    ttr_context_t* ctx,
+    ttr_atlas_t* atlas,
+    const ttr_run_t* run,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    const ttr_rect_t* clip,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data)
+{
+    clip_bounds bounds;
+    if (!ttr_clip_bounds_init(&bounds, width, height, clip)) {
+        return;
+    }
+
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
+        return;
+    }
 
-    hb_buffer_guess_segment_properties(buf);
+    hb_direction_t direction = run->direction;
+
+    unsigned int baseline = 0;
+    ttr_run_measure(run, NULL, NULL, &baseline);
 
-    hb_shape(font, buf, NULL, 0);
+    int cursor_x = ttr_scale_up(x_offset + (HB_DIRECTION_IS_VERTICAL(direction) ? baseline : 0));
+    int cursor_y = ttr_scale_up(y_offset + (HB_DIRECTION_IS_HORIZONTAL(direction) ? baseline : 0));
 
-    unsigned int glyph_count;
-    hb_glyph_info_t *glyph_info    = hb_buffer_get_glyph_infos(buf, &glyph_count);
-    hb_glyph_position_t *glyph_pos = hb_buffer_get_glyph_positions(buf, &glyph_count);
-    hb_direction_t direction = hb_buffer_get_direction(buf);
+    ttr_run_draw_glyph_range(ctx, atlas, run, 0, run->glyph_count, cursor_x, cursor_y, &bounds, draw_span, user_data);
 
-    ttr_measure_internal(font, direction, glyph_count, glyph_info, glyph_pos, width, height, baseline);
+    ttr_destroy_context(owned_ctx);
+}
 
-    hb_buffer_destroy(buf);
+void ttr_run_draw_with_span_callback(
+    ttr_context_t* ctx,
+    const ttr_run_t* run,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    const ttr_rect_t* clip,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data)
+{
+    ttr_run_draw_glyphs(ctx, NULL, run, x_offset, y_offset, width, height, clip, draw_span, user_data);
 }
 
-typedef struct draw_glyph_pixel_data {
-    unsigned int width;
-    unsigned int height;
+void ttr_draw_text_with_span_callback(
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    const char *text,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    const ttr_rect_t* clip,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data)
+{
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
+        return;
+    }
 
-    unsigned int offset_x;
-    unsigned int offset_y;
+    ttr_run_t* run = ttr_context_shape_text(ctx, font, text);
+    if (run) {
+        ttr_run_draw_with_span_callback(ctx, run, x_offset, y_offset, width, height, clip, draw_span, user_data);
+    }
 
+    ttr_destroy_context(owned_ctx);
+}
+
+void ttr_run_glyphs_begin(ttr_glyph_iterator_t* iterator, ttr_context_t* ctx, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip) {
+    clip_bounds bounds;
+    bool visible = ttr_clip_bounds_init(&bounds, width, height, clip);
+
+    unsigned int baseline = 0;
+    ttr_run_measure(run, NULL, NULL, &baseline);
+
+    *iterator = (ttr_glyph_iterator_t) {
+        .ctx = ctx,
+        .run = run,
+        // Nothing is drawn when the destination and clip don't intersect.
+        .index = visible ? 0 : run->glyph_count,
+        .cursor_x = ttr_scale_up(x_offset + (HB_DIRECTION_IS_VERTICAL(run->direction) ? baseline : 0)),
+        .cursor_y = ttr_scale_up(y_offset + (HB_DIRECTION_IS_HORIZONTAL(run->direction) ? baseline : 0)),
+        .left = bounds.left,
+        .top = bounds.top,
+        .right = bounds.right,
+        .bottom = bounds.bottom
+    };
+}
+
+int ttr_run_glyphs_next(ttr_glyph_iterator_t* iterator, ttr_glyph_bitmap_t* bitmap) {
+    ttr_context_t* ctx = iterator->ctx;
+    const ttr_run_t* run = iterator->run;
+
+    while (iterator->index < run->glyph_count) {
+        unsigned int i = iterator->index++;
+        const hb_glyph_position_t* pos = &run->glyph_pos[i];
+        hb_glyph_extents_t extents = run->glyph_extents[i];
+
+        int glyph_start_x = iterator->cursor_x + pos->x_offset + extents.x_bearing;
+        int glyph_start_y = iterator->cursor_y - pos->y_offset - extents.y_bearing;
+
+        iterator->cursor_x += pos->x_advance;
+        iterator->cursor_y += pos->y_advance;
+
+        ttr_stats_add(glyphs_drawn, 1);
+
+        if (extents.width == 0 || extents.height == 0) {
+            continue;
+        }
+
+        unsigned int fraction_x = ttr_fraction_scaled(glyph_start_x);
+        unsigned int fraction_y = ttr_fraction_scaled(glyph_start_y);
+        int left = ttr_scale_down_floor(glyph_start_x);
+        int top = ttr_scale_down_floor(glyph_start_y);
+
+        unsigned int glyph_width, glyph_height;
+        ttr_glyph_bitmap_size(extents, fraction_x, fraction_y, &glyph_width, &glyph_height);
+        if (left >= iterator->right || left + (int)glyph_width <= iterator->left
+            || top >= iterator->bottom || top + (int)glyph_height <= iterator->top) {
+            continue;
+        }
+
+        // Only rasterize the rows within bounds, and only hand over the columns within them. Bounds of a destination
+        // without width or height are INT_MAX, which glyphs left of or above it would overflow.
+        unsigned int row_begin = max(iterator->top - top, 0);
+        unsigned int row_end = min((long long)iterator->bottom - top, (long long)glyph_height);
+        unsigned int column_begin = max(iterator->left - left, 0);
+        unsigned int column_end = min((long long)iterator->right - left, (long long)glyph_width);
+
+        size_t size = (size_t)(row_end - row_begin) * glyph_width;
+        if (size > ctx->glyph_bitmap_capacity) {
+            uint8_t* pixels = realloc(ctx->glyph_bitmap, size);
+            if (!pixels) {
+                return -1;
+            }
+            ctx->glyph_bitmap = pixels;
+            ctx->glyph_bitmap_capacity = size;
+        }
+
+        if (ttr_rasterize_glyph_rows(ctx, run->font, run->glyph_info[i].codepoint, extents, fraction_x, fraction_y, row_begin, row_end, ctx->glyph_bitmap) != 0) {
+            return -1;
+        }
+
+        *bitmap = (ttr_glyph_bitmap_t) {
+            .x = left + column_begin,
+            .y = top + row_begin,
+            .width = column_end - column_begin,
+            .height = row_end - row_begin,
+            .stride = glyph_width,
+            .coverage = ctx->glyph_bitmap + column_begin
+        };
+        return 1;
+    }
+
+    return 0;
+}
+
+typedef struct draw_pixel_data {
     void (*draw_pixel_at)(unsigned int x, unsigned int y, uint8_t mask, void* user_data);
     void* user_data;
-} draw_glyph_pixel_data;
+} draw_pixel_data;
 
-static void ttr_draw_glyph_pixel_at(unsigned int x, unsigned int y, uint8_t mask, void* user_data) {
-    draw_glyph_pixel_data* data = (draw_glyph_pixel_data*)user_data;
+static void ttr_draw_span_as_pixels(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data) {
+    draw_pixel_data* data = (draw_pixel_data*)user_data;
 
-    unsigned int width = data->width;
-    unsigned int height = data->height;
+    for (unsigned int i = 0; i < len; i++) {
+        data->draw_pixel_at(x_start + i, y, coverage[i], data->user_data);
+    }
+}
 
-    const int image_x = x + data->offset_x;
-    const int image_y = y + data->offset_y;
+void ttr_run_draw_with_callback(
+    ttr_context_t* ctx,
+    const ttr_run_t* run,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    const ttr_rect_t* clip,
+    void (*draw_pixel_at)(unsigned int x, unsigned int y, uint8_t mask, void* user_data),
+    void* user_data)
+{
+    draw_pixel_data data = { draw_pixel_at, user_data };
+    ttr_run_draw_with_span_callback(ctx, run, x_offset, y_offset, width, height, clip, ttr_draw_span_as_pixels, &data);
+}
 
-    if (image_x < 0 || image_y < 0
-        || (width > 0 && image_x >= width)
-        || (height > 0 && image_y >= height)) {
+void ttr_draw_text_with_callback(
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    const char *text,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    const ttr_rect_t* clip,
+    void (*draw_pixel_at)(unsigned int x, unsigned int y, uint8_t mask, void* user_data),
+    void* user_data)
+{
+    draw_pixel_data data = { draw_pixel_at, user_data };
+    ttr_draw_text_with_span_callback(ctx, font, text, x_offset, y_offset, width, height, clip, ttr_draw_span_as_pixels, &data);
+}
+
+typedef struct draw_span_on_buffer_data {
+    uint8_t* pixels;
+    unsigned int width;
+} draw_span_on_buffer_data;
+
+static void ttr_draw_span_on_buffer(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data) {
+    draw_span_on_buffer_data* data = (draw_span_on_buffer_data*)user_data;
+
+    uint8_t* pixels = &data->pixels[(y * data->width) + x_start];
+    for (unsigned int i = 0; i < len; i++) {
+        pixels[i] = min(pixels[i] + coverage[i], 255);
+    }
+}
+
+void ttr_run_draw_on_buffer(ttr_context_t* ctx, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels) {
+    draw_span_on_buffer_data data = { pixels, width };
+    ttr_run_draw_with_span_callback(ctx, run, x_offset, y_offset, width, height, clip, ttr_draw_span_on_buffer, &data);
+}
+
+void ttr_draw_text_on_buffer(ttr_context_t* ctx, hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels) {
+    draw_span_on_buffer_data data = { pixels, width };
+    ttr_draw_text_with_span_callback(ctx, font, text, x_offset, y_offset, width, height, clip, ttr_draw_span_on_buffer, &data);
+}
+
+typedef struct draw_span_on_band_data {
+    uint8_t* pixels;
+    unsigned int width;
+    unsigned int top;
+} draw_span_on_band_data;
+
+static void ttr_draw_span_on_band(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data) {
+    draw_span_on_band_data* data = (draw_span_on_band_data*)user_data;
+
+    uint8_t* pixels = &data->pixels[((y - data->top) * data->width) + x_start];
+    for (unsigned int i = 0; i < len; i++) {
+        pixels[i] = min(pixels[i] + coverage[i], 255);
+    }
+}
+
+void ttr_run_draw_banded(
+    ttr_context_t* ctx,
+    const ttr_run_t* run,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    unsigned int band_height,
+    uint8_t* band,
+    void (*band_ready)(unsigned int y, unsigned int rows, const uint8_t* band, void* user_data),
+    void* user_data)
+{
+    if (width == 0 || band_height == 0) {
+        return;
+    }
+
+    if (height == 0) {
+        unsigned int text_width, text_height;
+        ttr_run_measure(run, &text_width, &text_height, NULL);
+        height = y_offset + text_height;
+    }
+
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
         return;
     }
 
-    data->draw_pixel_at(image_x, image_y, mask, data->user_data);
+    for (unsigned int top = 0; top < height; top += band_height) {
+        unsigned int rows = min(band_height, height - top);
+        memset(band, 0, (size_t)width * rows);
+
+        // Clipping to the band only rasterizes the rows of the glyphs that fall within it.
+        ttr_rect_t clip = { 0, top, width, rows };
+        draw_span_on_band_data data = { band, width, top };
+        ttr_run_draw_with_span_callback(ctx, run, x_offset, y_offset, width, height, &clip, ttr_draw_span_on_band, &data);
+
+        band_ready(top, rows, band, user_data);
+    }
+
+    ttr_destroy_context(owned_ctx);
 }
 
-void ttr_draw_text_with_callback(
+void ttr_draw_text_banded(
+    ttr_context_t* ctx,
     hb_font_t* font,
     const char *text,
     unsigned int x_offset,
     unsigned int y_offset,
     unsigned int width,
     unsigned int height,
-    void (*draw_pixel_at)(unsigned int x, unsigned int y, uint8_t mask, void* user_data),
+    unsigned int band_height,
+    uint8_t* band,
+    void (*band_ready)(unsigned int y, unsigned int rows, const uint8_t* band, void* user_data),
     void* user_data)
 {
-    hb_buffer_t *buf = hb_buffer_create();
-    hb_buffer_add_utf8(buf, text, -1, 0, -1);
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
+        return;
+    }
+
+    ttr_run_t* run = ttr_context_shape_text(ctx, font, text);
+    if (run) {
+        ttr_run_draw_banded(ctx, run, x_offset, y_offset, width, height, band_height, band, band_ready, user_data);
+    }
 
-    hb_buffer_guess_segment_properties(buf);
+    ttr_destroy_context(owned_ctx);
+}
 
-    hb_shape(font, buf, NULL, 0);
+void ttr_run_draw_on_surface(ttr_context_t* ctx, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, const ttr_surface_t* surface, const ttr_rect_t* clip) {
+    ttr_blit_t blit;
+    if (ttr_blit_init(&blit, surface) != 0) {
+        return;
+    }
+    ttr_run_draw_with_span_callback(ctx, run, x_offset, y_offset, surface->width, surface->height, clip, ttr_blit_span, &blit);
+}
 
-    unsigned int glyph_count;
-    hb_glyph_info_t *glyph_info    = hb_buffer_get_glyph_infos(buf, &glyph_count);
-    hb_glyph_position_t *glyph_pos = hb_buffer_get_glyph_positions(buf, &glyph_count);
-    hb_direction_t direction = hb_buffer_get_direction(buf);
+void ttr_draw_text_on_surface(ttr_context_t* ctx, hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, const ttr_surface_t* surface, const ttr_rect_t* clip) {
+    ttr_blit_t blit;
+    if (ttr_blit_init(&blit, surface) != 0) {
+        return;
+    }
+    ttr_draw_text_with_span_callback(ctx, font, text, x_offset, y_offset, surface->width, surface->height, clip, ttr_blit_span, &blit);
+}
 
-    unsigned int baseline = 0;
-    ttr_measure_internal(font, direction, glyph_count, glyph_info, glyph_pos, NULL, NULL, &baseline);
+void ttr_run_draw_from_atlas(ttr_context_t* ctx, ttr_atlas_t* atlas, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels) {
+    draw_span_on_buffer_data data = { pixels, width };
+    ttr_run_draw_glyphs(ctx, atlas, run, x_offset, y_offset, width, height, clip, ttr_draw_span_on_buffer, &data);
+}
 
-    int cursor_x = ttr_scale_up(x_offset + (HB_DIRECTION_IS_VERTICAL(direction) ? baseline : 0));
-    int cursor_y = ttr_scale_up(y_offset + (HB_DIRECTION_IS_HORIZONTAL(direction) ? baseline : 0));
-    for (unsigned int i = 0; i < glyph_count; i++) {
-        hb_codepoint_t glyphid  = glyph_info[i].codepoint;
+void ttr_draw_text_from_atlas(ttr_context_t* ctx, ttr_atlas_t* atlas, hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels) {
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
+        return;
+    }
+
+    ttr_run_t* run = ttr_context_shape_text(ctx, font, text);
+    if (run) {
+        ttr_run_draw_from_atlas(ctx, atlas, run, x_offset, y_offset, width, height, clip, pixels);
+    }
+
+    ttr_destroy_context(owned_ctx);
+}
+
+void ttr_paragraph_draw_with_span_callback(
+    ttr_context_t* ctx,
+    const ttr_paragraph_t* paragraph,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    const ttr_rect_t* clip,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data)
+{
+    clip_bounds bounds;
+    if (!ttr_clip_bounds_init(&bounds, width, height, clip)) {
+        return;
+    }
 
-        hb_glyph_extents_t extents;
-        if (!hb_font_get_glyph_extents(font, glyphid, &extents)) {
-            // Error?
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < paragraph->line_count; i++) {
+        const ttr_line_t* line = &paragraph->lines[i];
+
+        // Skip lines well out of bounds without looking at their glyphs, leaving a line of margin for glyphs
+        // reaching out of their box. Lines go down, so none after one below the bounds can be drawn.
+        long long line_top = (long long)y_offset + line->bounds.y;
+        if (line_top - line->bounds.height >= bounds.bottom) {
+            break;
+        }
+        if (line_top + 2 * line->bounds.height <= bounds.top) {
             continue;
         }
 
-        int glyph_start_x = cursor_x + glyph_pos[i].x_offset + extents.x_bearing;
-        int glyph_start_y = cursor_y - glyph_pos[i].y_offset - extents.y_bearing;
+        int cursor_x = ttr_scale_up(x_offset + line->bounds.x);
+        int cursor_y = ttr_scale_up(y_offset + line->baseline);
 
-        draw_glyph_pixel_data data = {
-            .width = width,
-            .height = height,
-            .offset_x = ttr_scale_down_floor(glyph_start_x),
-            .offset_y = ttr_scale_down_floor(glyph_start_y),
-            .draw_pixel_at = draw_pixel_at,
-            .user_data = user_data
-        };
-        ttr_draw_glyph(font, glyphid, extents, ttr_fraction_scaled(glyph_start_x), ttr_fraction_scaled(glyph_start_y), ttr_draw_glyph_pixel_at, &data);
+        ttr_run_draw_glyph_range(ctx, NULL, paragraph->run, line->glyph_start, line->glyph_start + line->glyph_count, cursor_x, cursor_y, &bounds, draw_span, user_data);
+    }
 
-        cursor_x += glyph_pos[i].x_advance;
-        cursor_y += glyph_pos[i].y_advance;
+    ttr_destroy_context(owned_ctx);
+}
+
+void ttr_paragraph_draw_on_buffer(ttr_context_t* ctx, const ttr_paragraph_t* paragraph, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels) {
+    draw_span_on_buffer_data data = { pixels, width };
+    ttr_paragraph_draw_with_span_callback(ctx, paragraph, x_offset, y_offset, width, height, clip, ttr_draw_span_on_buffer, &data);
+}
+
+void ttr_paragraph_draw_on_surface(ttr_context_t* ctx, const ttr_paragraph_t* paragraph, unsigned int x_offset, unsigned int y_offset, const ttr_surface_t* surface, const ttr_rect_t* clip) {
+    ttr_blit_t blit;
+    if (ttr_blit_init(&blit, surface) != 0) {
+        return;
+    }
+    ttr_paragraph_draw_with_span_callback(ctx, paragraph, x_offset, y_offset, surface->width, surface->height, clip, ttr_blit_span, &blit);
+}
+
+void ttr_text_draw_with_span_callback(
+    ttr_context_t* ctx,
+    const ttr_text_t* text,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    const ttr_rect_t* clip,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data)
+{
+    clip_bounds bounds;
+    if (!ttr_clip_bounds_init(&bounds, width, height, clip)) {
+        return;
+    }
+
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
+        return;
     }
 
-    hb_buffer_destroy(buf);
+    unsigned int baseline;
+    ttr_text_measure(text, NULL, NULL, &baseline);
+
+    int cursor_x = ttr_scale_up(x_offset);
+    int cursor_y = ttr_scale_up(y_offset + baseline);
+
+    ttr_run_draw_glyph_range(ctx, NULL, &text->run, 0, text->run.glyph_count, cursor_x, cursor_y, &bounds, draw_span, user_data);
+
+    ttr_destroy_context(owned_ctx);
 }
 
-typedef struct draw_pixel_on_buffer_data {
-    uint8_t* pixels;
-    unsigned int width;
-} draw_pixel_on_buffer_data;
+void ttr_text_draw_on_buffer(ttr_context_t* ctx, const ttr_text_t* text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels) {
+    draw_span_on_buffer_data data = { pixels, width };
+    ttr_text_draw_with_span_callback(ctx, text, x_offset, y_offset, width, height, clip, ttr_draw_span_on_buffer, &data);
+}
+
+void ttr_text_draw_on_surface(ttr_context_t* ctx, const ttr_text_t* text, unsigned int x_offset, unsigned int y_offset, const ttr_surface_t* surface, const ttr_rect_t* clip) {
+    ttr_blit_t blit;
+    if (ttr_blit_init(&blit, surface) != 0) {
+        return;
+    }
+    ttr_text_draw_with_span_callback(ctx, text, x_offset, y_offset, surface->width, surface->height, clip, ttr_blit_span, &blit);
+}
+
+void ttr_font_chain_measure_text(ttr_context_t* ctx, const ttr_font_chain_t* chain, const char *text, unsigned int *width, unsigned int *height, unsigned int *baseline) {
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
+        return;
+    }
+
+    unsigned int run_count;
+    if (ttr_font_chain_shape(ctx, chain, text, &run_count) == 0) {
+        ttr_font_chain_measure_runs(ctx->chain_runs, run_count, width, height, baseline);
+    }
+
+    ttr_destroy_context(owned_ctx);
+}
+
+void ttr_font_chain_draw_text_with_span_callback(
+    ttr_context_t* ctx,
+    const ttr_font_chain_t* chain,
+    const char *text,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    const ttr_rect_t* clip,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data)
+{
+    clip_bounds bounds;
+    if (!ttr_clip_bounds_init(&bounds, width, height, clip)) {
+        return;
+    }
 
-static void ttr_draw_pixel_on_buffer(unsigned int x, unsigned int y, uint8_t mask, void* user_data) {
-    draw_pixel_on_buffer_data* data = (draw_pixel_on_buffer_data*)user_data;
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
+        return;
+    }
+
+    unsigned int run_count;
+    if (ttr_font_chain_shape(ctx, chain, text, &run_count) == 0) {
+        unsigned int baseline = 0;
+        ttr_font_chain_measure_runs(ctx->chain_runs, run_count, NULL, NULL, &baseline);
+
+        int cursor_x = ttr_scale_up(x_offset);
+        int cursor_y = ttr_scale_up(y_offset + baseline);
+        for (unsigned int i = 0; i < run_count; i++) {
+            const ttr_run_t* run = &ctx->chain_runs[i];
+            ttr_run_draw_glyph_range(ctx, NULL, run, 0, run->glyph_count, cursor_x, cursor_y, &bounds, draw_span, user_data);
+            cursor_x += ttr_run_advance(run);
+        }
+    }
+
+    ttr_destroy_context(owned_ctx);
+}
+
+void ttr_font_chain_draw_text_on_buffer(ttr_context_t* ctx, const ttr_font_chain_t* chain, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels) {
+    draw_span_on_buffer_data data = { pixels, width };
+    ttr_font_chain_draw_text_with_span_callback(ctx, chain, text, x_offset, y_offset, width, height, clip, ttr_draw_span_on_buffer, &data);
+}
+
+// Copy the coverage of a glyph of a pack with its pen at `pen_x`, `baseline` in pixels, handing rows within bounds
+// to `draw_span` whole.
+static void ttr_draw_pack_glyph(
+    const ttr_pack_t* pack,
+    const ttr_pack_glyph_t* glyph,
+    int pen_x,
+    int baseline,
+    const clip_bounds* bounds,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data)
+{
+    draw_glyph_span_data data = {
+        .bounds = *bounds,
+        .offset_x = pen_x + glyph->left,
+        .offset_y = baseline + glyph->top,
+        .draw_span = draw_span,
+        .user_data = user_data
+    };
+
+    if (glyph->width == 0 || data.offset_x >= bounds->right || data.offset_x + glyph->width <= bounds->left) {
+        return;
+    }
+
+    int row_begin = max(bounds->top - data.offset_y, 0);
+    // Bounds of a destination without height are INT_MAX, which glyphs above its top would overflow.
+    int row_end = min((long long)bounds->bottom - data.offset_y, (long long)glyph->height);
+
+    const uint8_t* coverage = ttr_pack_at(pack, glyph->bitmap_offset);
+    for (int row = row_begin; row < row_end; row++) {
+        ttr_draw_coverage_row(row, &coverage[row * glyph->width], glyph->width, ttr_draw_glyph_span, &data);
+    }
+}
+
+void ttr_pack_draw_text_with_span_callback(
+    ttr_context_t* ctx,
+    const ttr_pack_t* pack,
+    hb_font_t* font,
+    unsigned int size,
+    const char *text,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    const ttr_rect_t* clip,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data)
+{
+    clip_bounds bounds;
+    if (!ttr_clip_bounds_init(&bounds, width, height, clip)) {
+        return;
+    }
+
+    const ttr_pack_strike_t* strike = ttr_pack_find_strike(pack, size);
+
+    const ttr_pack_string_t* string = strike ? ttr_pack_find_string(pack, strike, text) : NULL;
+    if (string) {
+        const ttr_pack_glyph_t* glyphs = ttr_pack_at(pack, strike->glyphs_offset);
+        const ttr_pack_placement_t* placements = ttr_pack_at(pack, string->placements_offset);
+        int baseline = y_offset + string->baseline;
+
+        ttr_stats_add(glyphs_drawn, string->placement_count);
+        for (uint32_t i = 0; i < string->placement_count; i++) {
+            int pen_x = x_offset + ttr_scale_down_round(placements[i].x);
+            int pen_y = baseline - ttr_scale_down_round(placements[i].y);
+            ttr_draw_pack_glyph(pack, &glyphs[placements[i].glyph_index], pen_x, pen_y, &bounds, draw_span, user_data);
+        }
+        return;
+    }
+
+    if (!font) {
+        if (!strike) {
+            return;
+        }
+
+        // Place the baseline below the highest glyph, like the baseline of shaped text.
+        int baseline = 0;
+        for (const char* next = text; *next;) {
+            hb_codepoint_t codepoint;
+            next = ttr_decode_utf8(next, &codepoint);
+            const ttr_pack_glyph_t* glyph = ttr_pack_find_codepoint(pack, strike, codepoint);
+            if (glyph && glyph->width > 0) {
+                baseline = max(baseline, -glyph->top);
+            }
+        }
+        baseline += y_offset;
+
+        int cursor_x = ttr_scale_up(x_offset);
+        for (const char* next = text; *next;) {
+            hb_codepoint_t codepoint;
+            next = ttr_decode_utf8(next, &codepoint);
+            const ttr_pack_glyph_t* glyph = ttr_pack_find_codepoint(pack, strike, codepoint);
+            if (glyph) {
+                ttr_stats_add(glyphs_drawn, 1);
+                ttr_draw_pack_glyph(pack, glyph, ttr_scale_down_round(cursor_x), baseline, &bounds, draw_span, user_data);
+                cursor_x += glyph->x_advance;
+            }
+        }
+        return;
+    }
+
+    // Shape the text, and only rasterize the glyphs the pack doesn't have.
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
+        return;
+    }
+
+    ttr_run_t* run = ttr_context_shape_text(ctx, font, text);
+    if (run) {
+        unsigned int baseline = 0;
+        ttr_run_measure(run, NULL, NULL, &baseline);
+
+        int cursor_x = ttr_scale_up(x_offset + (HB_DIRECTION_IS_VERTICAL(run->direction) ? baseline : 0));
+        int cursor_y = ttr_scale_up(y_offset + (HB_DIRECTION_IS_HORIZONTAL(run->direction) ? baseline : 0));
+
+        for (unsigned int i = 0; i < run->glyph_count; i++) {
+            const hb_glyph_position_t* pos = &run->glyph_pos[i];
+            const ttr_pack_glyph_t* glyph = strike ? ttr_pack_find_glyph(pack, strike, run->glyph_info[i].codepoint) : NULL;
+            if (glyph) {
+                ttr_stats_add(glyphs_drawn, 1);
+                int pen_x = ttr_scale_down_round(cursor_x + pos->x_offset);
+                int pen_y = ttr_scale_down_round(cursor_y - pos->y_offset);
+                ttr_draw_pack_glyph(pack, glyph, pen_x, pen_y, &bounds, draw_span, user_data);
+            } else {
+                ttr_run_draw_glyph_range(ctx, NULL, run, i, i + 1, cursor_x, cursor_y, &bounds, draw_span, user_data);
+            }
+
+            cursor_x += pos->x_advance;
+            cursor_y += pos->y_advance;
+        }
+    }
+
+    ttr_destroy_context(owned_ctx);
+}
+
+void ttr_pack_draw_text_on_buffer(ttr_context_t* ctx, const ttr_pack_t* pack, hb_font_t* font, unsigned int size, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels) {
+    draw_span_on_buffer_data data = { pixels, width };
+    ttr_pack_draw_text_with_span_callback(ctx, pack, font, size, text, x_offset, y_offset, width, height, clip, ttr_draw_span_on_buffer, &data);
+}
+
+void ttr_run_draw_sdf_with_span_callback(
+    ttr_context_t* ctx,
+    const ttr_run_t* run,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    const ttr_rect_t* clip,
+    unsigned int softness,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data)
+{
+    ttr_sdf_cache_t* cache = ttr_font_get_sdf_cache(run->font);
+    if (!cache) {
+        ttr_run_draw_glyphs(ctx, NULL, run, x_offset, y_offset, width, height, clip, draw_span, user_data);
+        return;
+    }
+
+    clip_bounds bounds;
+    if (!ttr_clip_bounds_init(&bounds, width, height, clip)) {
+        return;
+    }
+
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
+        return;
+    }
+
+    unsigned int baseline = 0;
+    ttr_run_measure(run, NULL, NULL, &baseline);
+
+    int cursor_x = ttr_scale_up(x_offset + (HB_DIRECTION_IS_VERTICAL(run->direction) ? baseline : 0));
+    int cursor_y = ttr_scale_up(y_offset + (HB_DIRECTION_IS_HORIZONTAL(run->direction) ? baseline : 0));
+
+    // Soft edges reach out of the glyph box by up to half their width.
+    int margin = softness / 128 + 1;
+
+    for (unsigned int i = 0; i < run->glyph_count; i++) {
+        const hb_glyph_position_t* pos = &run->glyph_pos[i];
+        hb_glyph_extents_t extents = run->glyph_extents[i];
+
+        int pen_x = cursor_x + pos->x_offset;
+        int pen_y = cursor_y - pos->y_offset;
+
+        // Skip glyphs out of bounds before their field is looked up.
+        int glyph_left = ttr_scale_down_floor(pen_x + extents.x_bearing) - margin;
+        int glyph_top = ttr_scale_down_floor(pen_y - extents.y_bearing) - margin;
+        int glyph_right = ttr_scale_down_ceil(pen_x + extents.x_bearing + extents.width) + margin;
+        int glyph_bottom = ttr_scale_down_ceil(pen_y - extents.y_bearing - extents.height) + margin;
+        if (glyph_left < bounds.right && glyph_right > bounds.left && glyph_top < bounds.bottom && glyph_bottom > bounds.top) {
+            const ttr_sdf_glyph_t* glyph = ttr_sdf_cache_get(cache, ctx, run->font, run->glyph_info[i].codepoint);
+            if (glyph) {
+                ttr_stats_add(glyphs_drawn, 1);
+                ttr_sdf_draw_glyph(cache, glyph, run->font, pen_x, pen_y, softness, bounds.left, bounds.top, bounds.right, bounds.bottom, draw_span, user_data);
+            } else {
+                ttr_run_draw_glyph_range(ctx, NULL, run, i, i + 1, cursor_x, cursor_y, &bounds, draw_span, user_data);
+            }
+        }
+
+        cursor_x += pos->x_advance;
+        cursor_y += pos->y_advance;
+    }
+
+    ttr_destroy_context(owned_ctx);
+}
+
+void ttr_draw_text_sdf_with_span_callback(
+    ttr_context_t* ctx,
+    hb_font_t* font,
+    const char *text,
+    unsigned int x_offset,
+    unsigned int y_offset,
+    unsigned int width,
+    unsigned int height,
+    const ttr_rect_t* clip,
+    unsigned int softness,
+    void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data),
+    void* user_data)
+{
+    ttr_context_t* owned_ctx = ctx ? NULL : (ctx = ttr_create_context());
+    if (!ctx) {
+        return;
+    }
+
+    ttr_run_t* run = ttr_context_shape_text(ctx, font, text);
+    if (run) {
+        ttr_run_draw_sdf_with_span_callback(ctx, run, x_offset, y_offset, width, height, clip, softness, draw_span, user_data);
+    }
+
+    ttr_destroy_context(owned_ctx);
+}
 
-    const int image_i = (y * data->width) + x;
-    data->pixels[image_i] = min(data->pixels[image_i] + mask, 255);
+void ttr_run_draw_sdf_on_buffer(ttr_context_t* ctx, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, unsigned int softness, uint8_t* pixels) {
+    draw_span_on_buffer_data data = { pixels, width };
+    ttr_run_draw_sdf_with_span_callback(ctx, run, x_offset, y_offset, width, height, clip, softness, ttr_draw_span_on_buffer, &data);
 }
 
-void ttr_draw_text_on_buffer(hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, uint8_t* pixels) {
-    draw_pixel_on_buffer_data data = { pixels, width };
-    ttr_draw_text_with_callback(font, text, x_offset, y_offset, width, height, ttr_draw_pixel_on_buffer, &data);
+void ttr_draw_text_sdf_on_buffer(ttr_context_t* ctx, hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, unsigned int softness, uint8_t* pixels) {
+    draw_span_on_buffer_data data = { pixels, width };
+    ttr_draw_text_sdf_with_span_callback(ctx, font, text, x_offset, y_offset, width, height, clip, softness, ttr_draw_span_on_buffer, &data);
 }
@@ -1,6 +1,7 @@
 #ifndef TINY_FONT_RENDERER_H
 #define TINY_FONT_RENDERER_H 1
 
+#include <stddef.h>
 #include <hb.h>
 
 #ifdef __cplusplus
@@ -10,10 +11,428 @@ extern "C" {
 hb_font_t* ttr_create_font(const char* font_data, unsigned int font_data_size, unsigned int height);
 void ttr_destroy_font(hb_font_t* font);
 
-void ttr_measure_text(hb_font_t* font, const char *text, unsigned int *width, unsigned int *height, unsigned int *baseline);
+/**
+ * Open face `index` of a font file, memory mapped where supported and unmapped once the face and all fonts made from
+ * it are destroyed. Returns NULL if the file can't be read or isn't a font.
+ */
+hb_face_t* ttr_open_face_file(const char* file_name, unsigned int index);
+void ttr_destroy_face(hb_face_t* face);
 
-void ttr_draw_text_on_buffer(hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, uint8_t* pixels);
-void ttr_draw_text_with_callback(hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, void (*draw_pixel_at)(unsigned int x, unsigned int y, uint8_t mask, void* user_data), void* user_data);
+/**
+ * Create a font of `height` pixels sharing the parsed tables of `face`, so that fonts of many sizes only parse it
+ * once. The font keeps a reference to the face.
+ */
+hb_font_t* ttr_create_font_for_face(hb_face_t* face, unsigned int height);
+
+/**
+ * Working memory for measuring and drawing, reused across calls so that rendering doesn't allocate once warmed up.
+ * A context must only be used by one thread at a time. Methods taking a context also accept NULL, in which case
+ * a temporary context is created for that call.
+ */
+typedef struct ttr_context_t ttr_context_t;
+
+ttr_context_t* ttr_create_context(void);
+void ttr_destroy_context(ttr_context_t* ctx);
+
+/**
+ * A rectangle in pixels of the destination. Draw methods only draw within `clip` when it isn't NULL, and skip glyphs
+ * entirely outside of it before decoding their outline, so that drawing long text mostly out of view stays cheap.
+ */
+typedef struct ttr_rect_t {
+    unsigned int x;
+    unsigned int y;
+    unsigned int width;
+    unsigned int height;
+} ttr_rect_t;
+
+void ttr_measure_text(ttr_context_t* ctx, hb_font_t* font, const char *text, unsigned int *width, unsigned int *height, unsigned int *baseline);
+
+void ttr_draw_text_on_buffer(ttr_context_t* ctx, hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels);
+void ttr_draw_text_with_callback(ttr_context_t* ctx, hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, void (*draw_pixel_at)(unsigned int x, unsigned int y, uint8_t mask, void* user_data), void* user_data);
+
+/**
+ * Like `ttr_draw_text_with_callback`, but called once for each horizontal run of `len` pixels with non-zero coverage,
+ * already clipped to `width`, `height` and `clip`.
+ */
+void ttr_draw_text_with_span_callback(ttr_context_t* ctx, hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data), void* user_data);
+
+/**
+ * Pixel formats of the surfaces drawn on by `ttr_draw_text_on_surface`.
+ */
+typedef enum ttr_pixel_format_t {
+    // 16 bits per pixel in native byte order, red in the 5 high bits, then 6 bits of green and 5 of blue.
+    TTR_PIXEL_FORMAT_RGB565,
+    // 3 bytes per pixel, red first.
+    TTR_PIXEL_FORMAT_RGB888,
+    // 4 bytes per pixel, red first and alpha last, with color premultiplied by alpha.
+    TTR_PIXEL_FORMAT_RGBA8888,
+    // 8 pixels per byte, leftmost in the high bit. Pixels at least half covered are set to the bit of the color.
+    TTR_PIXEL_FORMAT_MONO1,
+    // 2 gray pixels per byte, leftmost in the high nibble.
+    TTR_PIXEL_FORMAT_GRAY4,
+} ttr_pixel_format_t;
+
+/**
+ * A pixel buffer that text is blended on with a color.
+ */
+typedef struct ttr_surface_t {
+    ttr_pixel_format_t format;
+    uint8_t* pixels;
+    unsigned int width;
+    unsigned int height;
+    // Bytes from the start of a row to the next, or 0 for rows without padding. Must be even for RGB565.
+    unsigned int stride;
+    // Color of the text as 0xAARRGGBB, not premultiplied. Gray formats use its luminance, 1bpp sets bits for
+    // a luminance of at least half.
+    uint32_t color;
+} ttr_surface_t;
+
+/**
+ * Like `ttr_draw_text_on_buffer`, but blending the text on a surface of any of the supported pixel formats.
+ * Rows are blended with SSE2 or NEON when available.
+ */
+void ttr_draw_text_on_surface(ttr_context_t* ctx, hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, const ttr_surface_t* surface, const ttr_rect_t* clip);
+
+/**
+ * A string to draw with `ttr_draw_text_batch`, with the same parameters as `ttr_draw_text_on_buffer`.
+ */
+typedef struct ttr_text_job_t {
+    hb_font_t* font;
+    const char* text;
+    unsigned int x_offset;
+    unsigned int y_offset;
+    unsigned int width;
+    unsigned int height;
+    uint8_t* pixels;
+    const ttr_rect_t* clip;
+} ttr_text_job_t;
+
+/**
+ * Draw many strings on `thread_count` threads, counting the calling one, or one per CPU if 0.
+ * Threads take jobs from their share of the array and steal from others once done with it.
+ * Jobs may share fonts and caches, but jobs drawing into the same buffer must not overlap.
+ * Without `TTR_THREADS`, all jobs are drawn on the calling thread.
+ */
+void ttr_draw_text_batch(const ttr_text_job_t* jobs, unsigned int job_count, unsigned int thread_count);
+
+/**
+ * A long text being drawn in the background by `ttr_draw_text_async`.
+ */
+typedef struct ttr_render_t ttr_render_t;
+
+/**
+ * Draw a long text on a buffer in the background, split into lines at newlines that are placed one line height of
+ * the font apart, like a paragraph laid out without a width limit. Lines of more than a few hundred bytes are cut
+ * into pieces after spaces, except right to left lines. A thread shapes one piece after the other, `thread_count`
+ * threads, or one per CPU if 0, rasterize shaped pieces into strips of coverage, and a thread adds finished strips
+ * to the buffer as they come. Stages hand pieces over through bounded queues, so that at most a few pieces per
+ * rasterizing thread are in flight however long the text. `done` is called, if not NULL, from a thread of
+ * the render once everything has been drawn, with 0 on success or -1 if some lines couldn't be drawn for lack of
+ * memory. The text, clip and buffer must stay valid, and the buffer must not be touched, until the render is done.
+ * Without `TTR_THREADS`, or if threads can't be started, the text is drawn on the calling thread before returning.
+ * Returns NULL on allocation failure, in which case nothing is drawn and `done` isn't called.
+ */
+ttr_render_t* ttr_draw_text_async(hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels, unsigned int thread_count, void (*done)(int result, void* user_data), void* user_data);
+
+/**
+ * Whether a render is done, without waiting for it.
+ */
+int ttr_render_is_done(ttr_render_t* render);
+
+/**
+ * Wait for a render to be done, returning 0 on success or -1 if some lines couldn't be drawn for lack of memory.
+ * Only one thread may wait on a render.
+ */
+int ttr_render_wait(ttr_render_t* render);
+
+/**
+ * Wait for a render to be done and free it.
+ */
+void ttr_destroy_render(ttr_render_t* render);
+
+/**
+ * Text shaped once, to be measured and drawn any number of times.
+ * The run keeps a reference to the font it was shaped with.
+ */
+typedef struct ttr_run_t ttr_run_t;
+
+ttr_run_t* ttr_shape_text(hb_font_t* font, const char *text);
+void ttr_destroy_run(ttr_run_t* run);
+
+void ttr_run_measure(const ttr_run_t* run, unsigned int *width, unsigned int *height, unsigned int *baseline);
+
+void ttr_run_draw_on_buffer(ttr_context_t* ctx, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels);
+void ttr_run_draw_with_callback(ttr_context_t* ctx, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, void (*draw_pixel_at)(unsigned int x, unsigned int y, uint8_t mask, void* user_data), void* user_data);
+void ttr_run_draw_on_surface(ttr_context_t* ctx, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, const ttr_surface_t* surface, const ttr_rect_t* clip);
+void ttr_run_draw_with_span_callback(ttr_context_t* ctx, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data), void* user_data);
+
+/**
+ * Draw text a band of rows at a time, for devices that can't hold a whole `width` by `height` image.
+ * `band` must hold `width * band_height` bytes of coverage. For each band from the top, it is cleared, the rows of
+ * glyphs within it are rasterized into it, and it is handed to `band_ready` with the first row `y` it holds and the
+ * number of `rows` it holds, which is less than `band_height` for the last band when `height` isn't a multiple of it.
+ * A `height` of 0 stops after the last row of text. Text is shaped once; working memory stays bounded by the width
+ * of a glyph times the band height, unless the font has a glyph cache, which keeps whole glyphs.
+ */
+void ttr_draw_text_banded(ttr_context_t* ctx, hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, unsigned int band_height, uint8_t* band, void (*band_ready)(unsigned int y, unsigned int rows, const uint8_t* band, void* user_data), void* user_data);
+void ttr_run_draw_banded(ttr_context_t* ctx, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, unsigned int band_height, uint8_t* band, void (*band_ready)(unsigned int y, unsigned int rows, const uint8_t* band, void* user_data), void* user_data);
+
+/**
+ * Shape text into the run kept by the context, valid until the context shapes text again. Returns NULL on failure.
+ */
+ttr_run_t* ttr_context_shape_text(ttr_context_t* ctx, hb_font_t* font, const char *text);
+
+/**
+ * Glyphs of a run rasterized one at a time into the working memory of a context, for code compositing whole rows of
+ * coverage itself, such as the `ttr::Renderer` template of `tiny_text_renderer.hpp`. Fields are private.
+ */
+typedef struct ttr_glyph_iterator_t {
+    ttr_context_t* ctx;
+    const ttr_run_t* run;
+    unsigned int index;
+    int cursor_x;
+    int cursor_y;
+    int left;
+    int top;
+    int right;
+    int bottom;
+} ttr_glyph_iterator_t;
+
+/**
+ * Coverage of a glyph within the destination: `height` rows of `width` bytes, `stride` bytes apart, for the pixels
+ * from `x`, `y`, pixels with zero coverage included. Valid until the context is used again.
+ */
+typedef struct ttr_glyph_bitmap_t {
+    unsigned int x;
+    unsigned int y;
+    unsigned int width;
+    unsigned int height;
+    unsigned int stride;
+    const uint8_t* coverage;
+} ttr_glyph_bitmap_t;
+
+/**
+ * Start iterating over the glyphs of a run drawn like with `ttr_run_draw_on_buffer`. The context can't be NULL.
+ * Glyph caches attached to the font are not used.
+ */
+void ttr_run_glyphs_begin(ttr_glyph_iterator_t* iterator, ttr_context_t* ctx, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip);
+
+/**
+ * Rasterize the next glyph with pixels within the destination and clip. Returns 1 with `bitmap` set, 0 once all
+ * glyphs are done, or -1 on allocation failure.
+ */
+int ttr_run_glyphs_next(ttr_glyph_iterator_t* iterator, ttr_glyph_bitmap_t* bitmap);
+
+/**
+ * Text shaped once and broken into lines no wider than `max_width` pixels, or only at newlines if 0. Lines are broken
+ * after spaces, hyphens and newlines, or within a word that doesn't fit on a line by itself. Only horizontal text is
+ * laid out; right to left lines are aligned to the right. Like a run, it keeps a reference to its font.
+ */
+typedef struct ttr_paragraph_t ttr_paragraph_t;
+
+/**
+ * A line of a paragraph, with positions in pixels from the top left of the paragraph.
+ */
+typedef struct ttr_line_t {
+    // Glyphs of the line in the shaped run, without trailing white space and newline.
+    unsigned int glyph_start;
+    unsigned int glyph_count;
+    // Bytes of the text on the line, with trailing white space and newline.
+    unsigned int text_start;
+    unsigned int text_length;
+    // Box of the line, as wide as its glyphs and as high as the line spacing of the font.
+    ttr_rect_t bounds;
+    unsigned int baseline;
+} ttr_line_t;
+
+ttr_paragraph_t* ttr_layout_paragraph(hb_font_t* font, const char *text, unsigned int max_width);
+void ttr_destroy_paragraph(ttr_paragraph_t* paragraph);
+
+/**
+ * Break the lines again for another width without shaping the text again. Returns 0 on success.
+ */
+int ttr_paragraph_set_max_width(ttr_paragraph_t* paragraph, unsigned int max_width);
+
+void ttr_paragraph_measure(const ttr_paragraph_t* paragraph, unsigned int *width, unsigned int *height);
+const ttr_line_t* ttr_paragraph_get_lines(const ttr_paragraph_t* paragraph, unsigned int* line_count);
+
+void ttr_paragraph_draw_on_buffer(ttr_context_t* ctx, const ttr_paragraph_t* paragraph, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels);
+void ttr_paragraph_draw_with_span_callback(ttr_context_t* ctx, const ttr_paragraph_t* paragraph, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data), void* user_data);
+void ttr_paragraph_draw_on_surface(ttr_context_t* ctx, const ttr_paragraph_t* paragraph, unsigned int x_offset, unsigned int y_offset, const ttr_surface_t* surface, const ttr_rect_t* clip);
+
+/**
+ * A line of text updated in place, such as a clock or a live value, that only shapes again the part of its content
+ * that changed. It is drawn with its baseline at the ascender of the font from the top, so that its box doesn't move
+ * with the glyphs it holds. Like a run, it keeps a reference to its font.
+ */
+typedef struct ttr_text_t ttr_text_t;
+
+ttr_text_t* ttr_create_text(hb_font_t* font);
+void ttr_destroy_text(ttr_text_t* text);
+
+/**
+ * Replace the content of the text. `dirty`, if not NULL, is set to the pixels to draw again relative to the top left
+ * of the text, empty if nothing changed. To update a display, clear the dirty rectangle moved by the offsets the
+ * text is drawn at, and draw the text again with it as clip so that only the glyphs within it are rasterized.
+ * Returns 0 on success, or -1 on allocation failure with the previous content kept.
+ */
+int ttr_text_set(ttr_text_t* text, const char* content, ttr_rect_t* dirty);
+
+void ttr_text_measure(const ttr_text_t* text, unsigned int *width, unsigned int *height, unsigned int *baseline);
+
+void ttr_text_draw_on_buffer(ttr_context_t* ctx, const ttr_text_t* text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels);
+void ttr_text_draw_with_span_callback(ttr_context_t* ctx, const ttr_text_t* text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data), void* user_data);
+void ttr_text_draw_on_surface(ttr_context_t* ctx, const ttr_text_t* text, unsigned int x_offset, unsigned int y_offset, const ttr_surface_t* surface, const ttr_rect_t* clip);
+
+/**
+ * An ordered list of fonts to fall back on for characters the first ones don't map, such as a Latin font followed by
+ * fonts for other scripts and symbols. The codepoints each font maps are read from its character map once when the
+ * chain is created, so that finding the font of a character is a table lookup. Text is split into runs of the first
+ * font mapping their characters, keeping combining marks and joiners with the character before them, and each run
+ * is shaped with its font. Characters no font maps are shaped with the font before them, or else the first font.
+ * Runs are placed one after the other from left to right without reordering, so the fonts should be created at the
+ * same height. The chain keeps a reference to its fonts, and can be shared by contexts since it is never modified.
+ */
+typedef struct ttr_font_chain_t ttr_font_chain_t;
+
+ttr_font_chain_t* ttr_create_font_chain(hb_font_t* const* fonts, unsigned int font_count);
+void ttr_destroy_font_chain(ttr_font_chain_t* chain);
+
+/**
+ * Index in the chain of the first font mapping `codepoint`, or -1 if no font does.
+ */
+int ttr_font_chain_get_font_for_codepoint(const ttr_font_chain_t* chain, hb_codepoint_t codepoint);
+
+void ttr_font_chain_measure_text(ttr_context_t* ctx, const ttr_font_chain_t* chain, const char *text, unsigned int *width, unsigned int *height, unsigned int *baseline);
+
+void ttr_font_chain_draw_text_on_buffer(ttr_context_t* ctx, const ttr_font_chain_t* chain, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels);
+void ttr_font_chain_draw_text_with_span_callback(ttr_context_t* ctx, const ttr_font_chain_t* chain, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data), void* user_data);
+
+/**
+ * Cache of rendered glyph coverage, bounded to `max_bytes` and evicting the least recently used glyphs.
+ * Attach it to one or more fonts with `ttr_font_set_glyph_cache`; the cache must outlive those fonts.
+ * Glyphs drawn with a cache are positioned at a quarter pixel precision. Not used by fonts with variations set.
+ */
+typedef struct ttr_glyph_cache_t ttr_glyph_cache_t;
+
+ttr_glyph_cache_t* ttr_create_glyph_cache(size_t max_bytes);
+void ttr_destroy_glyph_cache(ttr_glyph_cache_t* cache);
+void ttr_glyph_cache_get_stats(ttr_glyph_cache_t* cache, unsigned long* hits, unsigned long* misses);
+
+void ttr_font_set_glyph_cache(hb_font_t* font, ttr_glyph_cache_t* cache);
+
+/**
+ * Atlas of rendered glyph coverage in a single `width` by `height` 8-bit image, for composing strings by copying
+ * rectangles. Glyphs are packed along a skyline as they are first drawn. When a glyph doesn't fit anymore, the atlas
+ * is cleared and filled again from then on, so it should be sized for the glyphs of a whole frame.
+ * Glyphs drawn from an atlas are positioned at the same subpixel precision as with a glyph cache. Glyphs of fonts
+ * with variations set are drawn directly rather than copied from the atlas.
+ */
+typedef struct ttr_atlas_t ttr_atlas_t;
+
+ttr_atlas_t* ttr_create_atlas(unsigned int width, unsigned int height);
+void ttr_destroy_atlas(ttr_atlas_t* atlas);
+void ttr_atlas_get_stats(ttr_atlas_t* atlas, unsigned long* hits, unsigned long* misses, unsigned long* resets);
+
+/**
+ * Like `ttr_draw_text_on_buffer` and `ttr_run_draw_on_buffer`, but copying glyphs from the atlas. Glyph caches
+ * attached to the font are not used.
+ */
+void ttr_draw_text_from_atlas(ttr_context_t* ctx, ttr_atlas_t* atlas, hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels);
+void ttr_run_draw_from_atlas(ttr_context_t* ctx, ttr_atlas_t* atlas, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels);
+
+/**
+ * Glyphs rasterized ahead of time by the `tiny-text-renderer-pack` tool, for targets that can't afford decoding and
+ * rasterizing outlines. The pack data is used in place, so it can live in flash or a mapped file, must be aligned to
+ * 4 bytes, and must outlive the pack. Returns NULL if the data isn't a valid pack.
+ */
+typedef struct ttr_pack_t ttr_pack_t;
+
+ttr_pack_t* ttr_open_pack(const void* data, size_t size);
+void ttr_destroy_pack(ttr_pack_t* pack);
+
+/**
+ * Draw text of `size` pixels from a pack. Strings shaped by the tool are drawn from the glyphs and positions stored
+ * with them, without shaping. Other text is shaped with `font` when it isn't NULL, and glyphs missing from the pack
+ * are rasterized from it; without a font, codepoints are mapped to glyphs of the pack one by one and placed by their
+ * advance, skipping the ones missing. Glyphs drawn from the pack are positioned on whole pixels.
+ */
+void ttr_pack_draw_text_with_span_callback(ttr_context_t* ctx, const ttr_pack_t* pack, hb_font_t* font, unsigned int size, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data), void* user_data);
+void ttr_pack_draw_text_on_buffer(ttr_context_t* ctx, const ttr_pack_t* pack, hb_font_t* font, unsigned int size, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, uint8_t* pixels);
+
+/**
+ * Keep the decoded outline of each glyph drawn with fonts of this face, in font units, so that drawing it again
+ * at any size or position only has to transform it. Memory grows with the number of distinct glyphs drawn and is
+ * released with the face. Not used by fonts with variations set.
+ */
+void ttr_face_enable_outline_cache(hb_face_t* face);
+
+/**
+ * Keep the extents of each glyph measured or drawn with this font, at its scale, so that laying out the same
+ * glyphs again reads them from a table rather than asking HarfBuzz. Advances still come from shaping. The table
+ * is filled as glyphs are used, all at once for fonts with few glyphs and a page of 256 glyphs at a time for larger
+ * ones, and released with the font. Ignored once the font changes, such as its scale, variations or synthetic bold and slant.
+ */
+void ttr_font_enable_metrics_table(hb_font_t* font);
+
+/**
+ * Keep a signed distance field of each glyph drawn with `ttr_draw_text_sdf_*` with fonts of this face, generated
+ * once from its outline at `base_size` pixels, with distances encoded up to `spread` pixels of that size on either
+ * side of the edge. Text of any size is then drawn by resampling the field rather than rasterizing the outline.
+ * Larger base sizes keep thinner features and sharper corners, and a larger spread allows softer edges when drawing
+ * far below the base size, both at the cost of memory, which grows with the number of distinct glyphs drawn and is
+ * released with the face. Fields are generated with floating point arithmetic, but sampled with integers only.
+ * Not used by fonts with variations set.
+ */
+void ttr_face_enable_sdf(hb_face_t* face, unsigned int base_size, unsigned int spread);
+
+/**
+ * Draw text by sampling the distance fields of its glyphs, scaled from the base size to the size of the font, with
+ * edges `softness` 64ths of a pixel wide: 64 is close to rasterized text, more blurs edges and less sharpens them.
+ * Glyphs are placed with subpixel precision. Falls back on rasterizing glyphs, glyph caches included, when the face
+ * of the font has no fields enabled with `ttr_face_enable_sdf`.
+ */
+void ttr_draw_text_sdf_with_span_callback(ttr_context_t* ctx, hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, unsigned int softness, void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data), void* user_data);
+void ttr_draw_text_sdf_on_buffer(ttr_context_t* ctx, hb_font_t* font, const char *text, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, unsigned int softness, uint8_t* pixels);
+void ttr_run_draw_sdf_with_span_callback(ttr_context_t* ctx, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, unsigned int softness, void (*draw_span)(unsigned int y, unsigned int x_start, unsigned int len, const uint8_t* coverage, void* user_data), void* user_data);
+void ttr_run_draw_sdf_on_buffer(ttr_context_t* ctx, const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, unsigned int width, unsigned int height, const ttr_rect_t* clip, unsigned int softness, uint8_t* pixels);
+
+/**
+ * Counters and cumulative time per stage, for all threads, since the start or the last `ttr_reset_stats`.
+ * Only collected when the library is built with `TTR_ENABLE_STATS`, otherwise always zero.
+ */
+typedef struct ttr_stats_t {
+    unsigned long long shape_calls;
+    unsigned long long glyphs_drawn;
+    // Points and lines of the outlines rasterized, after curves have been flattened.
+    unsigned long long outline_points;
+    unsigned long long outline_lines;
+    unsigned long long raster_cells_touched;
+    unsigned long long raster_bytes_allocated;
+    // Glyphs rasterized with a list of cells per row rather than a cell per pixel.
+    unsigned long long raster_sparse_glyphs;
+    unsigned long long glyph_cache_hits;
+    unsigned long long glyph_cache_misses;
+    unsigned long long outline_cache_hits;
+    unsigned long long outline_cache_misses;
+    unsigned long long atlas_hits;
+    unsigned long long atlas_misses;
+    unsigned long long sdf_cache_hits;
+    unsigned long long sdf_cache_misses;
+    unsigned long long glyph_metrics_hits;
+    unsigned long long glyph_metrics_misses;
+
+    // Nanoseconds spent in each stage. Composite is the time spent handing coverage over to the destination,
+    // including copies out of glyph caches and atlases, and is not counted in rasterize.
+    unsigned long long shape_ns;
+    unsigned long long extents_ns;
+    unsigned long long outline_decode_ns;
+    unsigned long long rasterize_ns;
+    unsigned long long composite_ns;
+} ttr_stats_t;
+
+void ttr_get_stats(ttr_stats_t* stats);
+void ttr_reset_stats(void);
 
 #ifdef __cplusplus
 }
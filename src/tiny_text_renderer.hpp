@@ -0,0 +1,170 @@
+#ifndef TINY_FONT_RENDERER_HPP
+#define TINY_FONT_RENDERER_HPP 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tiny_text_renderer.h"
+
+/**
+ * Header-only C++11 drawing on top of `ttr_run_glyphs_next`, with compositing templated on a sink so that it is
+ * inlined into the loop over each row of a glyph and compiled with the flags of the including code, rather than
+ * called through a function pointer for each span.
+ *
+ * A sink is any type callable as `sink(x, y, len, coverage)` for `len` pixels of row `y` from `x`, already clipped
+ * to the destination. Unlike span callbacks, rows are handed over whole, pixels with zero coverage included.
+ */
+namespace ttr {
+
+namespace detail {
+
+// x / 255 rounded to nearest, for x up to 255 * 255, like the blending of surfaces.
+inline unsigned int div255(unsigned int x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+}
+
+/**
+ * Add coverage to an 8-bit buffer, saturating, like `ttr_draw_text_on_buffer`.
+ */
+struct Gray8Sink {
+    uint8_t* pixels;
+    // Bytes from the start of a row to the next.
+    unsigned int stride;
+
+    Gray8Sink(uint8_t* pixels, unsigned int stride) : pixels(pixels), stride(stride) {}
+
+    void operator()(unsigned int x, unsigned int y, unsigned int len, const uint8_t* coverage) const {
+        uint8_t* row = pixels + (size_t)y * stride + x;
+        for (unsigned int i = 0; i < len; i++) {
+            unsigned int value = row[i] + coverage[i];
+            row[i] = value > 255 ? 255 : value;
+        }
+    }
+};
+
+/**
+ * Blend a color on an RGB565 buffer, like `ttr_draw_text_on_surface` with `TTR_PIXEL_FORMAT_RGB565`.
+ */
+struct Rgb565Sink {
+    uint8_t* pixels;
+    // Bytes from the start of a row to the next, even.
+    unsigned int stride;
+
+    // Color premultiplied by its alpha.
+    unsigned int red;
+    unsigned int green;
+    unsigned int blue;
+    unsigned int alpha;
+
+    // `color` is 0xAARRGGBB, not premultiplied.
+    Rgb565Sink(uint8_t* pixels, unsigned int stride, uint32_t color)
+        : pixels(pixels),
+          stride(stride),
+          red(detail::div255(((color >> 16) & 0xff) * (color >> 24))),
+          green(detail::div255(((color >> 8) & 0xff) * (color >> 24))),
+          blue(detail::div255((color & 0xff) * (color >> 24))),
+          alpha(color >> 24) {}
+
+    void operator()(unsigned int x, unsigned int y, unsigned int len, const uint8_t* coverage) const {
+        uint16_t* row = (uint16_t*)(pixels + (size_t)y * stride) + x;
+        for (unsigned int i = 0; i < len; i++) {
+            unsigned int c = coverage[i];
+            unsigned int inverse = 255 - detail::div255(alpha * c);
+
+            unsigned int p = row[i];
+            unsigned int r = p >> 11, g = (p >> 5) & 0x3f, b = p & 0x1f;
+            r = (r << 3) | (r >> 2);
+            g = (g << 2) | (g >> 4);
+            b = (b << 3) | (b >> 2);
+
+            r = detail::div255(red * c) + detail::div255(r * inverse);
+            g = detail::div255(green * c) + detail::div255(g * inverse);
+            b = detail::div255(blue * c) + detail::div255(b * inverse);
+
+            row[i] = (detail::div255(r * 31) << 11) | (detail::div255(g * 63) << 5) | detail::div255(b * 31);
+        }
+    }
+};
+
+/**
+ * Draws text on a `width` by `height` destination through a sink, with a context of its own. A width or height of
+ * 0 doesn't limit drawing along that axis. Like a context, a renderer must only be used by one thread at a time.
+ */
+template <typename Sink>
+class Renderer {
+public:
+    Renderer(const Sink& sink, unsigned int width, unsigned int height)
+        : ctx_(ttr_create_context()), sink_(sink), width_(width), height_(height) {}
+
+    ~Renderer() {
+        ttr_destroy_context(ctx_);
+    }
+
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    // False if the context couldn't be created, in which case nothing is drawn.
+    bool valid() const {
+        return ctx_ != NULL;
+    }
+
+    Sink& sink() {
+        return sink_;
+    }
+
+    ttr_context_t* context() const {
+        return ctx_;
+    }
+
+    /**
+     * Draw a run like `ttr_run_draw_on_buffer`. Returns 0 on success, -1 on allocation failure.
+     */
+    int draw(const ttr_run_t* run, unsigned int x_offset, unsigned int y_offset, const ttr_rect_t* clip = NULL) {
+        if (!ctx_) {
+            return -1;
+        }
+
+        ttr_glyph_iterator_t iterator;
+        ttr_run_glyphs_begin(&iterator, ctx_, run, x_offset, y_offset, width_, height_, clip);
+
+        ttr_glyph_bitmap_t bitmap;
+        int result;
+        while ((result = ttr_run_glyphs_next(&iterator, &bitmap)) > 0) {
+            const uint8_t* coverage = bitmap.coverage;
+            for (unsigned int row = 0; row < bitmap.height; row++, coverage += bitmap.stride) {
+                sink_(bitmap.x, bitmap.y + row, bitmap.width, coverage);
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * Shape text into the run of the context and draw it like `ttr_draw_text_on_buffer`.
+     */
+    int draw_text(hb_font_t* font, const char* text, unsigned int x_offset, unsigned int y_offset, const ttr_rect_t* clip = NULL) {
+        if (!ctx_) {
+            return -1;
+        }
+
+        const ttr_run_t* run = ttr_context_shape_text(ctx_, font, text);
+        if (!run) {
+            return -1;
+        }
+
+        return draw(run, x_offset, y_offset, clip);
+    }
+
+private:
+    ttr_context_t* ctx_;
+    Sink sink_;
+    unsigned int width_;
+    unsigned int height_;
+};
+
+}
+
+#endif /* TINY_FONT_RENDERER_HPP */
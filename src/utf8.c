@@ -0,0 +1,38 @@
+#include "utf8.h"
+
+#include <stdint.h>
+
+const char* ttr_decode_utf8(const char* text, hb_codepoint_t* codepoint) {
+    const uint8_t* bytes = (const uint8_t*)text;
+
+    unsigned int length;
+    hb_codepoint_t value;
+    if (bytes[0] < 0x80) {
+        *codepoint = bytes[0];
+        return text + 1;
+    } else if ((bytes[0] & 0xe0) == 0xc0) {
+        length = 2;
+        value = bytes[0] & 0x1f;
+    } else if ((bytes[0] & 0xf0) == 0xe0) {
+        length = 3;
+        value = bytes[0] & 0x0f;
+    } else if ((bytes[0] & 0xf8) == 0xf0) {
+        length = 4;
+        value = bytes[0] & 0x07;
+    } else {
+        *codepoint = 0xfffd;
+        return text + 1;
+    }
+
+    for (unsigned int i = 1; i < length; i++) {
+        if ((bytes[i] & 0xc0) != 0x80) {
+            // Also stops at the null terminator.
+            *codepoint = 0xfffd;
+            return text + i;
+        }
+        value = (value << 6) | (bytes[i] & 0x3f);
+    }
+
+    *codepoint = value;
+    return text + length;
+}
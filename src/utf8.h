@@ -0,0 +1,21 @@
+#ifndef TTR_UTF8_H
+#define TTR_UTF8_H 1
+
+#include <hb.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Decode the codepoint at the start of null-terminated utf-8 text, U+FFFD for invalid bytes.
+ *
+ * @return The text after the codepoint.
+ */
+const char* ttr_decode_utf8(const char* text, hb_codepoint_t* codepoint);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTR_UTF8_H */
@@ -0,0 +1,116 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coverage.h"
+
+// Longest row tested, past the widest vector loop several times over.
+#define MAX_COUNT 300
+// Bytes checked past the end of a row, which must be left alone.
+#define GUARD 64
+
+static float values[8192];
+static unsigned int value_count;
+
+static void add_value(float value) {
+    if (value_count < sizeof(values) / sizeof(values[0])) {
+        values[value_count++] = value;
+    }
+}
+
+static float float_from_bits(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Values where the rounding or the clamping of the conversion changes, either sign, and others out of range.
+static void add_edge_values(void) {
+    add_value(0.0f);
+    add_value(-0.0f);
+    add_value(1.0f);
+    add_value(-1.0f);
+    add_value(nextafterf(1.0f, 2.0f));
+    add_value(nextafterf(1.0f, 0.0f));
+    add_value(2.0f);
+    add_value(-1000.0f);
+    add_value(3.4e38f);
+    add_value(INFINITY);
+    add_value(-INFINITY);
+    add_value(NAN);
+    add_value(-NAN);
+    add_value(float_from_bits(0x00000001));
+    add_value(float_from_bits(0x807fffff));
+    add_value(1e-30f);
+
+    for (unsigned int level = 0; level < 255; level++) {
+        float boundary = (level + 0.5f) / 255.0f;
+        add_value(boundary);
+        add_value(nextafterf(boundary, 0.0f));
+        add_value(nextafterf(boundary, 1.0f));
+        add_value(-boundary);
+    }
+}
+
+static int check_row(const ttr_coverage_kernel_t* kernel, const float* area, unsigned int count) {
+    uint8_t expected[MAX_COUNT + GUARD];
+    uint8_t actual[MAX_COUNT + GUARD];
+    memset(expected, 0xa5, sizeof(expected));
+    memset(actual, 0xa5, sizeof(actual));
+
+    ttr_coverage_from_area_scalar(area, expected, count);
+    kernel->convert(area, actual, count);
+
+    if (memcmp(expected, actual, count + GUARD) == 0) {
+        return 0;
+    }
+
+    for (unsigned int i = 0; i < count + GUARD; i++) {
+        if (expected[i] != actual[i]) {
+            if (i < count) {
+                fprintf(stderr, "%s: pixel %u of %u, area %.9g: got %u, expected %u\n", kernel->name, i, count, area[i], actual[i], expected[i]);
+            } else {
+                fprintf(stderr, "%s: wrote past the end of a row of %u pixels\n", kernel->name, count);
+            }
+            break;
+        }
+    }
+    return 1;
+}
+
+int main(void) {
+    ttr_coverage_kernel_t kernels[4];
+    unsigned int kernel_count = ttr_coverage_get_kernels(kernels);
+
+    add_edge_values();
+    unsigned int edge_count = value_count;
+
+    // Random areas, mostly in range, and random bit patterns.
+    srand(1);
+    while (value_count < sizeof(values) / sizeof(values[0])) {
+        if (rand() % 4 == 0) {
+            add_value(float_from_bits(((uint32_t)rand() << 16) ^ (uint32_t)rand()));
+        } else {
+            add_value((rand() / (float)RAND_MAX) * 3.0f - 1.5f);
+        }
+    }
+
+    int failures = 0;
+    for (unsigned int k = 0; k < kernel_count; k++) {
+        // Every length up to several vectors, at each alignment, from the edge values and then the random ones.
+        for (unsigned int start = 0; start + MAX_COUNT <= value_count; start += start < edge_count ? 29 : 997) {
+            for (unsigned int count = 0; count <= MAX_COUNT; count += count < 80 ? 1 : 37) {
+                for (unsigned int misalign = 0; misalign < 4; misalign++) {
+                    if (start + misalign + count <= value_count) {
+                        failures += check_row(&kernels[k], &values[start + misalign], count);
+                    }
+                }
+            }
+        }
+        printf("%s checked\n", kernels[k].name);
+    }
+
+    return failures ? 1 : 0;
+}
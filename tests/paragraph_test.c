@@ -0,0 +1,249 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <tiny_text_renderer.h>
+
+// Text of each line as start and length in bytes.
+typedef struct expected_line {
+    unsigned int text_start;
+    unsigned int text_length;
+} expected_line;
+
+typedef struct paragraph_case {
+    const char* text;
+    unsigned int line_count;
+    expected_line lines[8];
+} paragraph_case;
+
+// Glyphs of a font without outlines have no advance, so only newlines break lines.
+static const paragraph_case cases[] = {
+    { "", 1, { { 0, 0 } } },
+    { "abc", 1, { { 0, 3 } } },
+    { "abc\n", 2, { { 0, 4 }, { 4, 0 } } },
+    { "a\nb\n", 3, { { 0, 2 }, { 2, 2 }, { 4, 0 } } },
+    { "a\n\n\nb", 4, { { 0, 2 }, { 2, 1 }, { 3, 1 }, { 4, 1 } } },
+    { "\n\n", 3, { { 0, 1 }, { 1, 1 }, { 2, 0 } } },
+    { "ab\n\n", 3, { { 0, 3 }, { 3, 1 }, { 4, 0 } } },
+};
+
+// Metrics of the font wrapping cases are laid out with, in pixels: glyphs are 10 wide and spaces 5, and lines
+// are 20 apart with their baseline 12 below their top.
+#define GLYPH_ADVANCE 10
+#define SPACE_ADVANCE 5
+#define ASCENDER 12
+#define DESCENDER 4
+#define LINE_GAP 4
+
+typedef struct wrap_case {
+    const char* text;
+    unsigned int max_width;
+    unsigned int line_count;
+    ttr_line_t lines[8];
+    unsigned int width;
+    unsigned int height;
+} wrap_case;
+
+static const wrap_case wrap_cases[] = {
+    // Broken after a space, which hangs past the end of the line.
+    { "aaa bbb ccc", 75, 2, {
+        { 0, 7, 0, 8, { 0, 0, 65, 20 }, 12 },
+        { 8, 3, 8, 3, { 0, 20, 30, 20 }, 32 },
+    }, 65, 40 },
+    // Trailing spaces at a break are part of the text of the line but not of its glyphs.
+    { "aa   bb", 30, 2, {
+        { 0, 2, 0, 5, { 0, 0, 20, 20 }, 12 },
+        { 5, 2, 5, 2, { 0, 20, 20, 20 }, 32 },
+    }, 20, 40 },
+    // A word wider than a line is broken at the glyph that overflows.
+    { "abcdefgh", 35, 3, {
+        { 0, 3, 0, 3, { 0, 0, 30, 20 }, 12 },
+        { 3, 3, 3, 3, { 0, 20, 30, 20 }, 32 },
+        { 6, 2, 6, 2, { 0, 40, 20, 20 }, 52 },
+    }, 30, 60 },
+    // Broken after a hyphen, which stays on the line.
+    { "ab-cd", 35, 2, {
+        { 0, 3, 0, 3, { 0, 0, 30, 20 }, 12 },
+        { 3, 2, 3, 2, { 0, 20, 20, 20 }, 32 },
+    }, 30, 40 },
+    // A long word after a break point goes to the next line first, and is broken there.
+    { "xx yyyyyyy z", 40, 4, {
+        { 0, 2, 0, 3, { 0, 0, 20, 20 }, 12 },
+        { 3, 4, 3, 4, { 0, 20, 40, 20 }, 32 },
+        { 7, 3, 7, 4, { 0, 40, 30, 20 }, 52 },
+        { 11, 1, 11, 1, { 0, 60, 10, 20 }, 72 },
+    }, 40, 80 },
+    // Newlines break lines whatever the width, and wrapping starts over after them.
+    { "aa bb\ncc", 30, 3, {
+        { 0, 2, 0, 3, { 0, 0, 20, 20 }, 12 },
+        { 3, 2, 3, 3, { 0, 20, 20, 20 }, 32 },
+        { 6, 2, 6, 2, { 0, 40, 20, 20 }, 52 },
+    }, 20, 60 },
+    // Without a limit, only newlines break lines.
+    { "aaa bbb ccc", 0, 1, {
+        { 0, 11, 0, 11, { 0, 0, 100, 20 }, 12 },
+    }, 100, 20 },
+};
+
+static int check_lines(const paragraph_case* test, const ttr_paragraph_t* paragraph, const char* when) {
+    unsigned int line_count;
+    const ttr_line_t* lines = ttr_paragraph_get_lines(paragraph, &line_count);
+
+    int failed = line_count != test->line_count;
+    for (unsigned int i = 0; !failed && i < line_count; i++) {
+        failed = lines[i].text_start != test->lines[i].text_start || lines[i].text_length != test->lines[i].text_length;
+    }
+    if (!failed) {
+        return 0;
+    }
+
+    fprintf(stderr, "\"");
+    for (const char* c = test->text; *c; c++) {
+        fprintf(stderr, *c == '\n' ? "\\n" : "%c", *c);
+    }
+    fprintf(stderr, "\" %s: got", when);
+    for (unsigned int i = 0; i < line_count; i++) {
+        fprintf(stderr, " [%u,%u]", lines[i].text_start, lines[i].text_length);
+    }
+    fprintf(stderr, ", expected");
+    for (unsigned int i = 0; i < test->line_count; i++) {
+        fprintf(stderr, " [%u,%u]", test->lines[i].text_start, test->lines[i].text_length);
+    }
+    fprintf(stderr, "\n");
+    return 1;
+}
+
+static hb_bool_t get_nominal_glyph(hb_font_t* font, void* font_data, hb_codepoint_t unicode, hb_codepoint_t* glyph, void* user_data) {
+    *glyph = unicode;
+    return true;
+}
+
+static hb_position_t get_glyph_h_advance(hb_font_t* font, void* font_data, hb_codepoint_t glyph, void* user_data) {
+    switch (glyph) {
+    case '\n':
+        return 0;
+    case ' ':
+        return SPACE_ADVANCE * 64;
+    default:
+        return GLYPH_ADVANCE * 64;
+    }
+}
+
+static hb_bool_t get_glyph_extents(hb_font_t* font, void* font_data, hb_codepoint_t glyph, hb_glyph_extents_t* extents, void* user_data) {
+    if (glyph == ' ' || glyph == '\n') {
+        *extents = (hb_glyph_extents_t) { 0 };
+    } else {
+        *extents = (hb_glyph_extents_t) { 0, ASCENDER * 64, GLYPH_ADVANCE * 64, -ASCENDER * 64 };
+    }
+    return true;
+}
+
+static hb_bool_t get_font_h_extents(hb_font_t* font, void* font_data, hb_font_extents_t* extents, void* user_data) {
+    *extents = (hb_font_extents_t) { .ascender = ASCENDER * 64, .descender = -DESCENDER * 64, .line_gap = LINE_GAP * 64 };
+    return true;
+}
+
+// A font without outlines with the metrics above, in 26.6.
+static hb_font_t* create_wrap_font(void) {
+    hb_font_funcs_t* funcs = hb_font_funcs_create();
+    hb_font_funcs_set_nominal_glyph_func(funcs, get_nominal_glyph, NULL, NULL);
+    hb_font_funcs_set_glyph_h_advance_func(funcs, get_glyph_h_advance, NULL, NULL);
+    hb_font_funcs_set_glyph_extents_func(funcs, get_glyph_extents, NULL, NULL);
+    hb_font_funcs_set_font_h_extents_func(funcs, get_font_h_extents, NULL, NULL);
+
+    hb_font_t* font = ttr_create_font("", 0, 16);
+    hb_font_set_funcs(font, funcs, NULL, NULL);
+    hb_font_funcs_destroy(funcs);
+    return font;
+}
+
+static int lines_equal(const ttr_line_t* a, const ttr_line_t* b) {
+    return a->glyph_start == b->glyph_start && a->glyph_count == b->glyph_count
+        && a->text_start == b->text_start && a->text_length == b->text_length
+        && a->bounds.x == b->bounds.x && a->bounds.y == b->bounds.y
+        && a->bounds.width == b->bounds.width && a->bounds.height == b->bounds.height
+        && a->baseline == b->baseline;
+}
+
+static void print_line(const ttr_line_t* line) {
+    fprintf(stderr, " [glyphs %u+%u, text %u+%u, bounds %u,%u %ux%u, baseline %u]", line->glyph_start, line->glyph_count,
+        line->text_start, line->text_length, line->bounds.x, line->bounds.y, line->bounds.width, line->bounds.height, line->baseline);
+}
+
+static int check_wrapped_lines(const wrap_case* test, const ttr_paragraph_t* paragraph, const char* when) {
+    unsigned int line_count;
+    const ttr_line_t* lines = ttr_paragraph_get_lines(paragraph, &line_count);
+    unsigned int width, height;
+    ttr_paragraph_measure(paragraph, &width, &height);
+
+    int failed = line_count != test->line_count || width != test->width || height != test->height;
+    for (unsigned int i = 0; !failed && i < line_count; i++) {
+        failed = !lines_equal(&lines[i], &test->lines[i]);
+    }
+    if (!failed) {
+        return 0;
+    }
+
+    fprintf(stderr, "\"");
+    for (const char* c = test->text; *c; c++) {
+        fprintf(stderr, *c == '\n' ? "\\n" : "%c", *c);
+    }
+    fprintf(stderr, "\" at %u %s: got %ux%u", test->max_width, when, width, height);
+    for (unsigned int i = 0; i < line_count; i++) {
+        print_line(&lines[i]);
+    }
+    fprintf(stderr, ", expected %ux%u", test->width, test->height);
+    for (unsigned int i = 0; i < test->line_count; i++) {
+        print_line(&test->lines[i]);
+    }
+    fprintf(stderr, "\n");
+    return 1;
+}
+
+int main(void) {
+    hb_font_t* font = ttr_create_font("", 0, 16);
+
+    int failures = 0;
+    for (unsigned int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        ttr_paragraph_t* paragraph = ttr_layout_paragraph(font, cases[i].text, 0);
+        if (!paragraph) {
+            fprintf(stderr, "layout failed\n");
+            return 1;
+        }
+
+        failures += check_lines(&cases[i], paragraph, "after layout");
+
+        if (ttr_paragraph_set_max_width(paragraph, 100) != 0) {
+            fprintf(stderr, "relayout failed\n");
+            return 1;
+        }
+        failures += check_lines(&cases[i], paragraph, "after relayout");
+
+        ttr_destroy_paragraph(paragraph);
+    }
+
+    ttr_destroy_font(font);
+
+    font = create_wrap_font();
+    for (unsigned int i = 0; i < sizeof(wrap_cases) / sizeof(wrap_cases[0]); i++) {
+        ttr_paragraph_t* paragraph = ttr_layout_paragraph(font, wrap_cases[i].text, wrap_cases[i].max_width);
+        if (!paragraph) {
+            fprintf(stderr, "layout failed\n");
+            return 1;
+        }
+
+        failures += check_wrapped_lines(&wrap_cases[i], paragraph, "after layout");
+
+        // Lines broken at another width first must come out the same.
+        if (ttr_paragraph_set_max_width(paragraph, 15) != 0 || ttr_paragraph_set_max_width(paragraph, wrap_cases[i].max_width) != 0) {
+            fprintf(stderr, "relayout failed\n");
+            return 1;
+        }
+        failures += check_wrapped_lines(&wrap_cases[i], paragraph, "after relayout");
+
+        ttr_destroy_paragraph(paragraph);
+    }
+    ttr_destroy_font(font);
+
+    return failures ? 1 : 0;
+}
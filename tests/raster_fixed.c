@@ -0,0 +1,6 @@
+#ifndef TTR_FIXED_POINT
+#define TTR_FIXED_POINT
+#endif
+#define RASTER_MODE raster_fixed
+
+#include "raster_mode.h"
@@ -0,0 +1,4 @@
+#undef TTR_FIXED_POINT
+#define RASTER_MODE raster_float
+
+#include "raster_mode.h"
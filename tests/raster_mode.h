@@ -0,0 +1,89 @@
+// Included by raster_float.c and raster_fixed.c. Builds the rasterizer in the mode TTR_FIXED_POINT selects, with
+// its functions prefixed by RASTER_MODE so that both modes link into one test, and renders outlines with it.
+#include "raster_modes.h"
+
+#define RASTER_JOIN(mode, name) mode##_##name
+#define RASTER_NAME(mode, name) RASTER_JOIN(mode, name)
+
+#define sft_init_outline RASTER_NAME(RASTER_MODE, sft_init_outline)
+#define sft_reset_outline RASTER_NAME(RASTER_MODE, sft_reset_outline)
+#define sft_free_outline RASTER_NAME(RASTER_MODE, sft_free_outline)
+#define sft_copy_outline RASTER_NAME(RASTER_MODE, sft_copy_outline)
+#define sft_add_point RASTER_NAME(RASTER_MODE, sft_add_point)
+#define sft_add_curve RASTER_NAME(RASTER_MODE, sft_add_curve)
+#define sft_add_cubic RASTER_NAME(RASTER_MODE, sft_add_cubic)
+#define sft_add_line RASTER_NAME(RASTER_MODE, sft_add_line)
+#define sft_free_scratch RASTER_NAME(RASTER_MODE, sft_free_scratch)
+#define sft_render_outline RASTER_NAME(RASTER_MODE, sft_render_outline)
+
+#include "schrift.c"
+#include "scale.h"
+
+// Same conversion from 26.6 as glyph.c.
+#ifdef TTR_FIXED_POINT
+#define raster_coord(value) ttr_round_float((value) * (SFT_FIXED_ONE / 64))
+#else
+#define raster_coord(value) ttr_scale_down_float(value)
+#endif
+
+static void raster_add_points(SFT_Outline* outline, const float* points, unsigned int count, float scale) {
+    for (unsigned int i = 0; i < count; i++) {
+        sft_add_point(outline, raster_coord(points[2 * i] * scale), raster_coord(points[2 * i + 1] * scale));
+    }
+}
+
+int RASTER_NAME(RASTER_MODE, render)(const raster_command_t* commands, unsigned int command_count, float scale, const raster_box_t* box, uint8_t* pixels) {
+    SFT_Outline outline;
+    if (sft_init_outline(&outline) != 0) {
+        return -1;
+    }
+
+    uint_least16_t start = 0;
+    for (unsigned int i = 0; i < command_count; i++) {
+        const raster_command_t* command = &commands[i];
+        switch (command->op) {
+        case 'M':
+            start = outline.numPoints;
+            raster_add_points(&outline, command->points, 1, scale);
+            break;
+        case 'L':
+            raster_add_points(&outline, command->points, 1, scale);
+            sft_add_line(&outline, outline.numPoints - 2, outline.numPoints - 1);
+            break;
+        case 'Q':
+            raster_add_points(&outline, command->points, 2, scale);
+            sft_add_curve(&outline, outline.numPoints - 3, outline.numPoints - 2, outline.numPoints - 1);
+            break;
+        case 'C':
+            raster_add_points(&outline, command->points, 3, scale);
+            sft_add_cubic(&outline, outline.numPoints - 4, outline.numPoints - 3, outline.numPoints - 2, outline.numPoints - 1);
+            break;
+        case 'Z':
+            sft_add_line(&outline, outline.numPoints - 1, start);
+            break;
+        }
+    }
+
+    SFT_Image image = {
+        .width = box->width,
+        .height = box->height,
+        .rowBeg = 0,
+        .rowEnd = box->height,
+        .pixels = pixels
+    };
+#ifdef TTR_FIXED_POINT
+    SFT_Coord transform[6] = {
+        1 << 16, 0,
+        0, -(1 << 16),
+        (box->offset_x - box->x_bearing) * (SFT_FIXED_ONE / 64), (box->offset_y + box->y_bearing) * (SFT_FIXED_ONE / 64)};
+#else
+    SFT_Coord transform[6] = {
+        1, 0,
+        0, -1,
+        ttr_scale_down(box->offset_x - box->x_bearing), ttr_scale_down(box->offset_y + box->y_bearing)};
+#endif
+
+    int result = sft_render_outline(&outline, transform, image, NULL);
+    sft_free_outline(&outline);
+    return result;
+}
@@ -0,0 +1,36 @@
+#ifndef TTR_RASTER_MODES_H
+#define TTR_RASTER_MODES_H 1
+
+#include <stdint.h>
+
+// A step of a test outline, in font units with y up: 'M' and 'L' take a point, 'Q' a control point and a
+// point, 'C' two control points and a point, and 'Z' closes the contour with a line back to its start.
+typedef struct raster_command_t {
+    char op;
+    float points[6];
+} raster_command_t;
+
+// Where a glyph is drawn, in 26.6 like HarfBuzz's extents, and the size of its bitmap in pixels.
+typedef struct raster_box_t {
+    int x_bearing;
+    int y_bearing;
+    int offset_x;
+    int offset_y;
+    int width;
+    int height;
+} raster_box_t;
+
+/**
+ * Rasterize an outline the way glyph.c does, in floating point or in fixed point.
+ *
+ * @param commands The outline.
+ * @param command_count Number of commands.
+ * @param scale 26.6 units per font unit.
+ * @param box Placement of the glyph.
+ * @param pixels Receives `box->width * box->height` bytes of coverage.
+ * @return 0 on success.
+ */
+int raster_float_render(const raster_command_t* commands, unsigned int command_count, float scale, const raster_box_t* box, uint8_t* pixels);
+int raster_fixed_render(const raster_command_t* commands, unsigned int command_count, float scale, const raster_box_t* box, uint8_t* pixels);
+
+#endif /* TTR_RASTER_MODES_H */
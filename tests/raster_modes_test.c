@@ -0,0 +1,230 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "raster_modes.h"
+
+#define COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+// Font units per em of the outlines below.
+#define UNITS_PER_EM 1000
+
+typedef struct test_glyph_t {
+    const char* name;
+    const raster_command_t* commands;
+    unsigned int command_count;
+} test_glyph_t;
+
+// Ring of cubics with a counter wound the other way.
+static const raster_command_t glyph_o[] = {
+    {'M', {500, -10}},
+    {'C', {666, -10, 800, 151, 800, 350}},
+    {'C', {800, 549, 666, 710, 500, 710}},
+    {'C', {334, 710, 200, 549, 200, 350}},
+    {'C', {200, 151, 334, -10, 500, -10}},
+    {'Z', {0}},
+    {'M', {500, 100}},
+    {'C', {400, 100, 320, 212, 320, 350}},
+    {'C', {320, 488, 400, 600, 500, 600}},
+    {'C', {600, 600, 680, 488, 680, 350}},
+    {'C', {680, 212, 600, 100, 500, 100}},
+    {'Z', {0}},
+};
+
+// Slanted stems with a triangular counter.
+static const raster_command_t glyph_a[] = {
+    {'M', {0, 0}},
+    {'L', {300, 700}},
+    {'L', {400, 700}},
+    {'L', {700, 0}},
+    {'L', {580, 0}},
+    {'L', {510, 180}},
+    {'L', {190, 180}},
+    {'L', {120, 0}},
+    {'Z', {0}},
+    {'M', {230, 280}},
+    {'L', {350, 580}},
+    {'L', {470, 280}},
+    {'Z', {0}},
+};
+
+// Stroke of quadratic curves, as TrueType outlines have.
+static const raster_command_t glyph_s[] = {
+    {'M', {120, 120}},
+    {'Q', {220, -10, 380, -10}},
+    {'Q', {580, -10, 580, 190}},
+    {'Q', {580, 330, 380, 380}},
+    {'Q', {260, 410, 260, 500}},
+    {'Q', {260, 600, 380, 600}},
+    {'Q', {460, 600, 520, 540}},
+    {'L', {570, 610}},
+    {'Q', {490, 700, 380, 700}},
+    {'Q', {150, 700, 150, 500}},
+    {'Q', {150, 360, 350, 310}},
+    {'Q', {470, 280, 470, 190}},
+    {'Q', {470, 90, 380, 90}},
+    {'Q', {260, 90, 190, 190}},
+    {'Z', {0}},
+};
+
+// Stem and a round dot.
+static const raster_command_t glyph_i[] = {
+    {'M', {100, 0}},
+    {'L', {200, 0}},
+    {'L', {200, 500}},
+    {'L', {100, 500}},
+    {'Z', {0}},
+    {'M', {150, 580}},
+    {'Q', {210, 580, 210, 640}},
+    {'Q', {210, 700, 150, 700}},
+    {'Q', {90, 700, 90, 640}},
+    {'Q', {90, 580, 150, 580}},
+    {'Z', {0}},
+};
+
+// Hairlines, thinner than a pixel at small sizes, at several angles.
+static const raster_command_t glyph_hairlines[] = {
+    {'M', {0, 0}},
+    {'L', {20, 0}},
+    {'L', {720, 700}},
+    {'L', {700, 700}},
+    {'Z', {0}},
+    {'M', {0, 340}},
+    {'L', {700, 340}},
+    {'L', {700, 355}},
+    {'L', {0, 355}},
+    {'Z', {0}},
+    {'M', {350, 0}},
+    {'L', {362, 0}},
+    {'L', {362, 700}},
+    {'L', {350, 700}},
+    {'Z', {0}},
+};
+
+// Contours wound the same way overlapping each other, where the coverage saturates.
+static const raster_command_t glyph_overlap[] = {
+    {'M', {0, 0}},
+    {'L', {500, 0}},
+    {'L', {500, 500}},
+    {'L', {0, 500}},
+    {'Z', {0}},
+    {'M', {250, 250}},
+    {'L', {750, 250}},
+    {'L', {750, 750}},
+    {'L', {250, 750}},
+    {'Z', {0}},
+};
+
+static const test_glyph_t glyphs[] = {
+    {"o", glyph_o, COUNT(glyph_o)},
+    {"a", glyph_a, COUNT(glyph_a)},
+    {"s", glyph_s, COUNT(glyph_s)},
+    {"i", glyph_i, COUNT(glyph_i)},
+    {"hairlines", glyph_hairlines, COUNT(glyph_hairlines)},
+    {"overlap", glyph_overlap, COUNT(glyph_overlap)},
+};
+
+// Sizes in pixels per em, from hinting sizes to ones rasterized sparsely.
+static const int sizes[] = {6, 9, 12, 16, 23, 37, 64, 128, 300};
+
+// Subpixel offsets in 26.6.
+static const int offsets[] = {0, 13, 32, 50};
+
+static int points_per_command(char op) {
+    switch (op) {
+    case 'M':
+    case 'L':
+        return 1;
+    case 'Q':
+        return 2;
+    case 'C':
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+// Puts the glyph where glyph.c would, from the box of its points.
+static raster_box_t get_box(const test_glyph_t* glyph, float scale, int offset_x, int offset_y) {
+    float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+    for (unsigned int i = 0; i < glyph->command_count; i++) {
+        const raster_command_t* command = &glyph->commands[i];
+        for (int j = 0; j < points_per_command(command->op); j++) {
+            min_x = fminf(min_x, command->points[2 * j] * scale);
+            max_x = fmaxf(max_x, command->points[2 * j] * scale);
+            min_y = fminf(min_y, command->points[2 * j + 1] * scale);
+            max_y = fmaxf(max_y, command->points[2 * j + 1] * scale);
+        }
+    }
+
+    raster_box_t box;
+    box.x_bearing = (int)floorf(min_x);
+    box.y_bearing = (int)ceilf(max_y);
+    box.offset_x = offset_x;
+    box.offset_y = offset_y;
+    box.width = (offset_x + (int)ceilf(max_x) - box.x_bearing + 63) / 64;
+    box.height = (offset_y + box.y_bearing - (int)floorf(min_y) + 63) / 64;
+    return box;
+}
+
+int main(void) {
+    int failures = 0;
+    unsigned long long float_total = 0, fixed_total = 0;
+
+    for (unsigned int g = 0; g < COUNT(glyphs); g++) {
+        for (unsigned int s = 0; s < COUNT(sizes); s++) {
+            float scale = sizes[s] * 64.0f / UNITS_PER_EM;
+            for (unsigned int ox = 0; ox < COUNT(offsets); ox++) {
+                for (unsigned int oy = 0; oy < COUNT(offsets); oy++) {
+                    raster_box_t box = get_box(&glyphs[g], scale, offsets[ox], offsets[oy]);
+                    size_t size = (size_t)box.width * box.height;
+                    uint8_t* float_pixels = calloc(size, 1);
+                    uint8_t* fixed_pixels = calloc(size, 1);
+                    if (!float_pixels || !fixed_pixels) {
+                        fprintf(stderr, "out of memory\n");
+                        return 1;
+                    }
+
+                    if (raster_float_render(glyphs[g].commands, glyphs[g].command_count, scale, &box, float_pixels) != 0
+                        || raster_fixed_render(glyphs[g].commands, glyphs[g].command_count, scale, &box, fixed_pixels) != 0) {
+                        fprintf(stderr, "%s at %d px: rendering failed\n", glyphs[g].name, sizes[s]);
+                        failures++;
+                    } else {
+                        int max_difference = 0;
+                        size_t worst = 0;
+                        for (size_t i = 0; i < size; i++) {
+                            int difference = abs((int)float_pixels[i] - (int)fixed_pixels[i]);
+                            if (difference > max_difference) {
+                                max_difference = difference;
+                                worst = i;
+                            }
+                            float_total += float_pixels[i];
+                            fixed_total += fixed_pixels[i];
+                        }
+                        if (max_difference > 1) {
+                            fprintf(stderr, "%s at %d px, offset %d,%d: pixel %zu,%zu is %u in floating point and %u in fixed point\n",
+                                glyphs[g].name, sizes[s], offsets[ox], offsets[oy], worst % box.width, worst / box.width,
+                                float_pixels[worst], fixed_pixels[worst]);
+                            failures++;
+                        }
+                    }
+
+                    free(float_pixels);
+                    free(fixed_pixels);
+                }
+            }
+        }
+    }
+
+    // Make sure something was drawn at all.
+    if (float_total == 0 || fixed_total == 0) {
+        fprintf(stderr, "nothing was drawn\n");
+        failures++;
+    }
+
+    if (failures) {
+        fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    return 0;
+}